@@ -68,6 +68,148 @@
     #define TIME_EXPOSE_UCDM                0
 #endif
 
+#if defined EBS_TIME_ENABLE_EPOCH_DEFER
+    #define TIME_ENABLE_EPOCH_DEFER         EBS_TIME_ENABLE_EPOCH_DEFER
+#elif defined APP_ENABLE_TIME_EPOCH_DEFER
+    #define TIME_ENABLE_EPOCH_DEFER         APP_ENABLE_TIME_EPOCH_DEFER
+#else
+    #define TIME_ENABLE_EPOCH_DEFER         0
+#endif
+
+#if defined EBS_TIME_SYNC_FILTER_LEN
+    #define TIME_SYNC_FILTER_LEN            EBS_TIME_SYNC_FILTER_LEN
+#elif defined APP_TIME_SYNC_FILTER_LEN
+    #define TIME_SYNC_FILTER_LEN            APP_TIME_SYNC_FILTER_LEN
+#else
+    #define TIME_SYNC_FILTER_LEN            8
+#endif
+
+#if TIME_SYNC_FILTER_LEN > 32
+#error "Time sync filter length must not exceed 32."
+#endif
+
+#if defined EBS_TIME_ENABLE_SYNC_BLOCK
+    #define TIME_ENABLE_SYNC_BLOCK          EBS_TIME_ENABLE_SYNC_BLOCK
+#elif defined APP_ENABLE_TIME_SYNC_BLOCK
+    #define TIME_ENABLE_SYNC_BLOCK          APP_ENABLE_TIME_SYNC_BLOCK
+#else
+    #define TIME_ENABLE_SYNC_BLOCK          0
+#endif
+
+#if defined EBS_TIME_ENABLE_SYNC_MASTER
+    #define TIME_ENABLE_SYNC_MASTER         EBS_TIME_ENABLE_SYNC_MASTER
+#elif defined APP_ENABLE_TIME_SYNC_MASTER
+    #define TIME_ENABLE_SYNC_MASTER         APP_ENABLE_TIME_SYNC_MASTER
+#else
+    #define TIME_ENABLE_SYNC_MASTER         0
+#endif
+
+#if defined EBS_TIME_ENABLE_SYNC_SERVO
+    #define TIME_ENABLE_SYNC_SERVO          EBS_TIME_ENABLE_SYNC_SERVO
+#elif defined APP_ENABLE_TIME_SYNC_SERVO
+    #define TIME_ENABLE_SYNC_SERVO          APP_ENABLE_TIME_SYNC_SERVO
+#else
+    #define TIME_ENABLE_SYNC_SERVO          0
+#endif
+
+#if TIME_ENABLE_SYNC_SERVO
+    #define TIME_ENABLE_SLEW                1
+#elif defined EBS_TIME_ENABLE_SLEW
+    #define TIME_ENABLE_SLEW                EBS_TIME_ENABLE_SLEW
+#elif defined APP_ENABLE_TIME_SLEW
+    #define TIME_ENABLE_SLEW                APP_ENABLE_TIME_SLEW
+#else
+    #define TIME_ENABLE_SLEW                0
+#endif
+
+#if defined EBS_TIME_SLEW_RATE_PPM
+    #define TIME_SLEW_RATE_PPM              EBS_TIME_SLEW_RATE_PPM
+#elif defined APP_TIME_SLEW_RATE_PPM
+    #define TIME_SLEW_RATE_PPM              APP_TIME_SLEW_RATE_PPM
+#else
+    #define TIME_SLEW_RATE_PPM              500
+#endif
+
+#if defined EBS_TIME_SYNC_STEP_THRESHOLD
+    #define TIME_SYNC_STEP_THRESHOLD        EBS_TIME_SYNC_STEP_THRESHOLD
+#elif defined APP_TIME_SYNC_STEP_THRESHOLD
+    #define TIME_SYNC_STEP_THRESHOLD        APP_TIME_SYNC_STEP_THRESHOLD
+#else
+    #define TIME_SYNC_STEP_THRESHOLD        128
+#endif
+
+#if defined EBS_TIME_SYNC_LOCK_THRESHOLD
+    #define TIME_SYNC_LOCK_THRESHOLD        EBS_TIME_SYNC_LOCK_THRESHOLD
+#elif defined APP_TIME_SYNC_LOCK_THRESHOLD
+    #define TIME_SYNC_LOCK_THRESHOLD        APP_TIME_SYNC_LOCK_THRESHOLD
+#else
+    #define TIME_SYNC_LOCK_THRESHOLD        4
+#endif
+
+#if defined EBS_TIME_SYNC_HOLDOVER_TIMEOUT
+    #define TIME_SYNC_HOLDOVER_TIMEOUT      EBS_TIME_SYNC_HOLDOVER_TIMEOUT
+#elif defined APP_TIME_SYNC_HOLDOVER_TIMEOUT
+    #define TIME_SYNC_HOLDOVER_TIMEOUT      APP_TIME_SYNC_HOLDOVER_TIMEOUT
+#else
+    #define TIME_SYNC_HOLDOVER_TIMEOUT      600
+#endif
+
+#if defined EBS_TIME_SYNC_SELECT_MARGIN
+    #define TIME_SYNC_SELECT_MARGIN         EBS_TIME_SYNC_SELECT_MARGIN
+#elif defined APP_TIME_SYNC_SELECT_MARGIN
+    #define TIME_SYNC_SELECT_MARGIN         APP_TIME_SYNC_SELECT_MARGIN
+#else
+    #define TIME_SYNC_SELECT_MARGIN         1
+#endif
+
+#if defined EBS_TIME_SYNC_SELECT_HOLD
+    #define TIME_SYNC_SELECT_HOLD           EBS_TIME_SYNC_SELECT_HOLD
+#elif defined APP_TIME_SYNC_SELECT_HOLD
+    #define TIME_SYNC_SELECT_HOLD           APP_TIME_SYNC_SELECT_HOLD
+#else
+    #define TIME_SYNC_SELECT_HOLD           8
+#endif
+
+#if TIME_SYNC_SELECT_HOLD < 1 || TIME_SYNC_SELECT_HOLD > 255
+#error "Time sync source selection hold must be between 1 and 255 exchanges."
+#endif
+
+#if defined EBS_TIME_SYNC_SERVO_TAU
+    #define TIME_SYNC_SERVO_TAU             EBS_TIME_SYNC_SERVO_TAU
+#elif defined APP_TIME_SYNC_SERVO_TAU
+    #define TIME_SYNC_SERVO_TAU             APP_TIME_SYNC_SERVO_TAU
+#else
+    #define TIME_SYNC_SERVO_TAU             256
+#endif
+
+#if defined EBS_TIME_SYNC_ERROR_BUDGET
+    #define TIME_SYNC_ERROR_BUDGET          EBS_TIME_SYNC_ERROR_BUDGET
+#elif defined APP_TIME_SYNC_ERROR_BUDGET
+    #define TIME_SYNC_ERROR_BUDGET          APP_TIME_SYNC_ERROR_BUDGET
+#else
+    #define TIME_SYNC_ERROR_BUDGET          0
+#endif
+
+#if defined EBS_TIME_SYNC_INTERVAL_MIN
+    #define TIME_SYNC_INTERVAL_MIN          EBS_TIME_SYNC_INTERVAL_MIN
+#elif defined APP_TIME_SYNC_INTERVAL_MIN
+    #define TIME_SYNC_INTERVAL_MIN          APP_TIME_SYNC_INTERVAL_MIN
+#else
+    #define TIME_SYNC_INTERVAL_MIN          16
+#endif
+
+#if defined EBS_TIME_SYNC_INTERVAL_MAX
+    #define TIME_SYNC_INTERVAL_MAX          EBS_TIME_SYNC_INTERVAL_MAX
+#elif defined APP_TIME_SYNC_INTERVAL_MAX
+    #define TIME_SYNC_INTERVAL_MAX          APP_TIME_SYNC_INTERVAL_MAX
+#else
+    #define TIME_SYNC_INTERVAL_MAX          4096
+#endif
+
+#if TIME_SYNC_INTERVAL_MIN < 1 || TIME_SYNC_INTERVAL_MAX < TIME_SYNC_INTERVAL_MIN
+#error "Time sync request intervals must satisfy 1 <= MIN <= MAX."
+#endif
+
 #if defined APP_ENABLE_RTC
     #define TIME_ENABLE_SYNC_RTC            APP_ENABLE_RTC
 #else
@@ -83,6 +225,148 @@
     #define TIME_ENABLE_CRON                0
 #endif
 
+#if defined EBS_TIME_CRON_ENABLE_SPEC
+    #define TIME_CRON_ENABLE_SPEC           EBS_TIME_CRON_ENABLE_SPEC
+#elif defined APP_ENABLE_TIME_CRON_SPEC
+    #define TIME_CRON_ENABLE_SPEC           APP_ENABLE_TIME_CRON_SPEC
+#else
+    #define TIME_CRON_ENABLE_SPEC           0
+#endif
+
+#if defined EBS_TIME_CRON_ENABLE_POLICIES
+    #define TIME_CRON_ENABLE_POLICIES       EBS_TIME_CRON_ENABLE_POLICIES
+#elif defined APP_ENABLE_TIME_CRON_POLICIES
+    #define TIME_CRON_ENABLE_POLICIES       APP_ENABLE_TIME_CRON_POLICIES
+#else
+    #define TIME_CRON_ENABLE_POLICIES       0
+#endif
+
+#if defined EBS_TIME_CRON_ENABLE_SLACK
+    #define TIME_CRON_ENABLE_SLACK          EBS_TIME_CRON_ENABLE_SLACK
+#elif defined APP_ENABLE_TIME_CRON_SLACK
+    #define TIME_CRON_ENABLE_SLACK          APP_ENABLE_TIME_CRON_SLACK
+#else
+    #define TIME_CRON_ENABLE_SLACK          0
+#endif
+
+#if defined EBS_TIME_CRON_ENABLE_STATS
+    #define TIME_CRON_ENABLE_STATS          EBS_TIME_CRON_ENABLE_STATS
+#elif defined APP_ENABLE_TIME_CRON_STATS
+    #define TIME_CRON_ENABLE_STATS          APP_ENABLE_TIME_CRON_STATS
+#else
+    #define TIME_CRON_ENABLE_STATS          0
+#endif
+
+#ifdef EBS_TIME_CRON_STATS_HIST_BINS
+    #define TIME_CRON_STATS_HIST_BINS       EBS_TIME_CRON_STATS_HIST_BINS
+#else
+    #define TIME_CRON_STATS_HIST_BINS       12
+#endif
+
+#if defined EBS_TIME_CRON_SUBMIT_QUEUE_LEN
+    #define TIME_CRON_SUBMIT_QUEUE_LEN      EBS_TIME_CRON_SUBMIT_QUEUE_LEN
+#elif defined APP_TIME_CRON_SUBMIT_QUEUE_LEN
+    #define TIME_CRON_SUBMIT_QUEUE_LEN      APP_TIME_CRON_SUBMIT_QUEUE_LEN
+#else
+    #define TIME_CRON_SUBMIT_QUEUE_LEN      0
+#endif
+
+#if TIME_CRON_SUBMIT_QUEUE_LEN & (TIME_CRON_SUBMIT_QUEUE_LEN - 1)
+#error "Cron submission queue length must be a power of 2."
+#endif
+
+#if defined EBS_TIME_CRON_ENABLE_PERSIST
+    #define TIME_CRON_ENABLE_PERSIST        EBS_TIME_CRON_ENABLE_PERSIST
+#elif defined APP_ENABLE_TIME_CRON_PERSIST
+    #define TIME_CRON_ENABLE_PERSIST        APP_ENABLE_TIME_CRON_PERSIST
+#else
+    #define TIME_CRON_ENABLE_PERSIST        0
+#endif
+
+#if defined EBS_TIME_CRON_PERSIST_LEN
+    #define TIME_CRON_PERSIST_LEN           EBS_TIME_CRON_PERSIST_LEN
+#elif defined APP_TIME_CRON_PERSIST_LEN
+    #define TIME_CRON_PERSIST_LEN           APP_TIME_CRON_PERSIST_LEN
+#else
+    #define TIME_CRON_PERSIST_LEN           0
+#endif
+
+#if defined EBS_TIME_CRON_ENABLE_TABLES
+    #define TIME_CRON_ENABLE_TABLES         EBS_TIME_CRON_ENABLE_TABLES
+#elif defined APP_ENABLE_TIME_CRON_TABLES
+    #define TIME_CRON_ENABLE_TABLES         APP_ENABLE_TIME_CRON_TABLES
+#else
+    #define TIME_CRON_ENABLE_TABLES         0
+#endif
+
+#if defined EBS_TIME_CRON_ENABLE_GROUPS
+    #define TIME_CRON_ENABLE_GROUPS         EBS_TIME_CRON_ENABLE_GROUPS
+#elif defined APP_ENABLE_TIME_CRON_GROUPS
+    #define TIME_CRON_ENABLE_GROUPS         APP_ENABLE_TIME_CRON_GROUPS
+#else
+    #define TIME_CRON_ENABLE_GROUPS         0
+#endif
+
+#if defined EBS_TIME_CRON_ENABLE_EDF
+    #define TIME_CRON_ENABLE_EDF            EBS_TIME_CRON_ENABLE_EDF
+#elif defined APP_ENABLE_TIME_CRON_EDF
+    #define TIME_CRON_ENABLE_EDF            APP_ENABLE_TIME_CRON_EDF
+#else
+    #define TIME_CRON_ENABLE_EDF            0
+#endif
+
+#if defined EBS_TIME_CRON_ENABLE_BLACKOUT
+    #define TIME_CRON_ENABLE_BLACKOUT       EBS_TIME_CRON_ENABLE_BLACKOUT
+#elif defined APP_ENABLE_TIME_CRON_BLACKOUT
+    #define TIME_CRON_ENABLE_BLACKOUT       APP_ENABLE_TIME_CRON_BLACKOUT
+#else
+    #define TIME_CRON_ENABLE_BLACKOUT       0
+#endif
+
+#if defined EBS_TIME_CRON_ENABLE_COMPACT
+    #define TIME_CRON_ENABLE_COMPACT        EBS_TIME_CRON_ENABLE_COMPACT
+#elif defined APP_ENABLE_TIME_CRON_COMPACT
+    #define TIME_CRON_ENABLE_COMPACT        APP_ENABLE_TIME_CRON_COMPACT
+#else
+    #define TIME_CRON_ENABLE_COMPACT        0
+#endif
+
+#if defined EBS_TIME_CRON_ENABLE_POOL
+    #define TIME_CRON_ENABLE_POOL           EBS_TIME_CRON_ENABLE_POOL
+#elif defined APP_ENABLE_TIME_CRON_POOL
+    #define TIME_CRON_ENABLE_POOL           APP_ENABLE_TIME_CRON_POOL
+#else
+    #define TIME_CRON_ENABLE_POOL           0
+#endif
+
+#if TIME_CRON_ENABLE_POOL && !defined PIO_NATIVE
+#error "The cron worker pool is only available on hosted (native) builds."
+#endif
+
+#if TIME_CRON_ENABLE_POOL && !TIME_CRON_ENABLE_POLICIES
+#error "The cron worker pool requires TIME_CRON_ENABLE_POLICIES."
+#endif
+
+#ifdef EBS_TIME_CRON_POOL_MAX_WORKERS
+    #define TIME_CRON_POOL_MAX_WORKERS      EBS_TIME_CRON_POOL_MAX_WORKERS
+#else
+    #define TIME_CRON_POOL_MAX_WORKERS      8
+#endif
+
+#ifdef EBS_TIME_CRON_POOL_DEQUE_LEN
+    #define TIME_CRON_POOL_DEQUE_LEN        EBS_TIME_CRON_POOL_DEQUE_LEN
+#else
+    #define TIME_CRON_POOL_DEQUE_LEN        64
+#endif
+
+#if defined EBS_TIME_CRON_PERSIST_FILE
+    #define TIME_CRON_PERSIST_FILE          EBS_TIME_CRON_PERSIST_FILE
+#elif defined APP_TIME_CRON_PERSIST_FILE
+    #define TIME_CRON_PERSIST_FILE          APP_TIME_CRON_PERSIST_FILE
+#else
+    #define TIME_CRON_PERSIST_FILE          "cron_persist.bin"
+#endif
+
 
 #ifndef APP_ENABLE_SYSTICK
 #define APP_ENABLE_SYSTICK                  1
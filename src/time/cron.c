@@ -30,85 +30,363 @@
  */
 
 #include "cron.h"
+#include "cron_stats.h"
+#include "cron_pool.h"
+#include "cron_table.h"
 
-cron_job_t * cron_nextjob_p = NULL;
+tm_cron_sched_t tm_cron_default;
 
-tm_epochchange_handler_t cron_change_handler = {NULL, 3, &tm_cron_epoch_change_handler};
+
+void tm_cron_sched_init(tm_cron_sched_t * sched_p){
+    sched_p->nextjob_p = NULL;
+    sched_p->epoch_offset = 0;
+    sched_p->wakeups = 0;
+    sched_p->wakeups_saved = 0;
+    sched_p->wake_valid = 0;
+    #if TIME_CRON_ENABLE_GROUPS
+    sched_p->paused = 0;
+    #endif
+    #if TIME_CRON_ENABLE_EDF
+    sched_p->deadline_misses = 0;
+    #endif
+    #if TIME_CRON_ENABLE_BLACKOUT
+    sched_p->deferrals = 0;
+    #endif
+    sched_p->change_handler.next = NULL;
+    sched_p->change_handler.priority = 3;
+    sched_p->change_handler.func = NULL;
+    sched_p->change_handler.func_ctx = &tm_cron_sched_epoch_change_handler;
+    sched_p->change_handler.ctx = sched_p;
+    #if TIME_ENABLE_EPOCH_DEFER
+    // Only the instance itself follows changes, from its own context.
+    sched_p->change_handler.owned = 1;
+    #endif
+    tm_register_epoch_change_handler(&(sched_p->change_handler));
+    #if TIME_CRON_ENABLE_POOL
+    sched_p->pool_p = NULL;
+    #endif
+    #if TIME_CRON_ENABLE_TABLES
+    sched_p->tables_p = NULL;
+    #endif
+    #if TIME_CRON_SUBMIT_QUEUE_LEN
+    tm_cron_sched_submit_init(sched_p);
+    #endif
+}
 
 
 void tm_cron_init(void){
-    tm_register_epoch_change_handler(&cron_change_handler);
+    tm_cron_sched_init(&tm_cron_default);
 }
 
 
-void tm_cron_clear_job(cron_job_t * job_p){
-    tm_cron_cancel_job(job_p);
+static void tm_cron_sched_release_job(tm_cron_sched_t * sched_p, 
+                                      cron_job_t * job_p);
+
+static void tm_cron_sched_release_job(tm_cron_sched_t * sched_p, 
+                                      cron_job_t * job_p){
+    // Runs still pending with a worker pool are dropped under the pool 
+    // lock, which the workers hold while they count runs down.
+    #if TIME_CRON_ENABLE_POOL
+    if (sched_p->pool_p){
+        tm_cron_pool_release(sched_p->pool_p, job_p);
+        return;
+    }
+    job_p->pending = 0;
+    job_p->pool_state = 0;
+    #else
+    (void)sched_p;
+    (void)job_p;
+    #endif
+}
+
+
+void tm_cron_sched_clear_job(tm_cron_sched_t * sched_p, cron_job_t * job_p){
+    tm_cron_sched_cancel_job(sched_p, job_p);
     job_p->handler = NULL;
     job_p->nextjob = NULL;
     job_p->prevjob = NULL;
     job_p->tafter_p = NULL;
     job_p->texec = 0;
     job_p->active = 0;
+    #if TIME_CRON_ENABLE_SPEC
+    job_p->spec_p = NULL;
+    #endif
+    #if TIME_CRON_ENABLE_POLICIES
+    job_p->flags = 0;
+    job_p->missed = 0;
+    #endif
+    #if TIME_CRON_ENABLE_SLACK
+    job_p->slack = 0;
+    #endif
+    #if TIME_CRON_ENABLE_GROUPS
+    job_p->group = 0;
+    #endif
+    #if TIME_CRON_ENABLE_EDF
+    job_p->prio = TM_CRON_PRIO_DEFAULT;
+    job_p->deadline = 0;
+    #endif
+    #if TIME_CRON_ENABLE_BLACKOUT
+    job_p->blackout_p = NULL;
+    #endif
+    #if TIME_CRON_ENABLE_STATS
+    job_p->stats_p = NULL;
+    #endif
+    tm_cron_sched_release_job(sched_p, job_p);
 }
 
 
-void tm_cron_create_job_abs(cron_job_t * job_p, void handler(void), 
-                         tm_system_t * texec_p, tm_sdelta_t * tafter_p){
+static void tm_cron_init_job(cron_job_t * job_p, void handler(void), 
+                             tm_sdelta_t * tafter_p);
+
+static void tm_cron_init_job(cron_job_t * job_p, void handler(void), 
+                             tm_sdelta_t * tafter_p){
+    job_p->active = 0;
     job_p->handler = handler;
     job_p->tafter_p = tafter_p;
-    job_p->texec = *texec_p;
-    tm_cron_insert_job(job_p);
+    #if TIME_CRON_ENABLE_SPEC
+    job_p->spec_p = NULL;
+    #endif
+    #if TIME_CRON_ENABLE_POLICIES
+    job_p->flags = 0;
+    job_p->missed = 0;
+    #endif
+    #if TIME_CRON_ENABLE_SLACK
+    job_p->slack = 0;
+    #endif
+    #if TIME_CRON_ENABLE_GROUPS
+    job_p->group = 0;
+    #endif
+    #if TIME_CRON_ENABLE_EDF
+    job_p->prio = TM_CRON_PRIO_DEFAULT;
+    job_p->deadline = 0;
+    #endif
+    #if TIME_CRON_ENABLE_BLACKOUT
+    job_p->blackout_p = NULL;
+    #endif
+    #if TIME_CRON_ENABLE_STATS
+    job_p->stats_p = NULL;
+    #endif
+}
+
+
+void tm_cron_setup_job(cron_job_t * job_p, void handler(void), 
+                       tm_sdelta_t * tafter_p){
+    tm_cron_init_job(job_p, handler, tafter_p);
+    #if TIME_CRON_ENABLE_POOL
+    job_p->pending = 0;
+    job_p->pool_state = 0;
+    #endif
+}
+
+
+void tm_cron_sched_setup_job(tm_cron_sched_t * sched_p, 
+                             cron_job_t * job_p, void handler(void), 
+                             tm_sdelta_t * tafter_p){
+    tm_cron_init_job(job_p, handler, tafter_p);
+    tm_cron_sched_release_job(sched_p, job_p);
+}
+
+
+void tm_cron_sched_create_job_abs(tm_cron_sched_t * sched_p, 
+                                  cron_job_t * job_p, void handler(void), 
+                                  tm_system_t * texec_p, 
+                                  tm_sdelta_t * tafter_p){
+    tm_cron_sched_follow_epoch(sched_p);
+    tm_cron_sched_setup_job(sched_p, job_p, handler, tafter_p);
+    job_p->texec = *texec_p - sched_p->epoch_offset;
+    tm_cron_sched_insert_job(sched_p, job_p);
     return;
 }
 
 
-void tm_cron_create_job_rel(cron_job_t * job_p, void handler(void), 
-                         tm_sdelta_t * trelexec_p, tm_sdelta_t * tafter_p){
-    job_p->handler = handler;
-    job_p->tafter_p = tafter_p;
+void tm_cron_sched_create_job_rel(tm_cron_sched_t * sched_p, 
+                                  cron_job_t * job_p, void handler(void), 
+                                  tm_sdelta_t * trelexec_p, 
+                                  tm_sdelta_t * tafter_p){
+    tm_cron_sched_follow_epoch(sched_p);
+    tm_cron_sched_setup_job(sched_p, job_p, handler, tafter_p);
     tm_current_time(&(job_p->texec));
     tm_apply_sdelta(&(job_p->texec), trelexec_p);
-    tm_cron_insert_job(job_p);
+    job_p->texec -= sched_p->epoch_offset;
+    tm_cron_sched_insert_job(sched_p, job_p);
     return;
 }
 
 
-void tm_cron_insert_job(cron_job_t * job_p){
-    cron_job_t * walker = cron_nextjob_p;
-    critical_enter();
-    job_p->active = 1;
-    if(walker == NULL){
-        cron_nextjob_p = job_p;
-        job_p->prevjob = NULL;
-        job_p->nextjob = NULL;
+#if TIME_CRON_ENABLE_SPEC
+
+void tm_cron_sched_create_job_spec(tm_cron_sched_t * sched_p, 
+                                   cron_job_t * job_p, void handler(void), 
+                                   const tm_cron_spec_t * spec_p){
+    tm_system_t current;
+    tm_cron_sched_follow_epoch(sched_p);
+    tm_cron_sched_setup_job(sched_p, job_p, handler, NULL);
+    job_p->spec_p = spec_p;
+    tm_current_time(&current);
+    if (tm_cron_spec_next(spec_p, &current, &(job_p->texec))){
+        job_p->active = 0;
         return;
     }
-    while(walker){
-        if (tm_cmp_stime(&(walker->texec), &(job_p->texec)) == 1){
-            job_p->nextjob = walker;
-            job_p->prevjob = walker->prevjob;
-            if(walker->prevjob){
-                walker->prevjob->nextjob = job_p;
-            }
-            else{
-                cron_nextjob_p = job_p;
-            }
-            walker->prevjob = job_p;
-            return;
+    job_p->texec -= sched_p->epoch_offset;
+    tm_cron_sched_insert_job(sched_p, job_p);
+    return;
+}
+
+#endif
+
+
+#if TIME_CRON_ENABLE_SLACK
+
+void tm_cron_sched_set_slack(tm_cron_sched_t * sched_p, cron_job_t * job_p, 
+                             uint16_t slack){
+    job_p->slack = slack;
+    sched_p->wake_valid = 0;
+}
+
+#endif
+
+
+#if TIME_CRON_ENABLE_GROUPS
+
+void tm_cron_sched_set_group(tm_cron_sched_t * sched_p, cron_job_t * job_p, 
+                             uint8_t group){
+    job_p->group = group & (TM_CRON_GROUPS - 1);
+    sched_p->wake_valid = 0;
+}
+
+
+void tm_cron_sched_pause_group(tm_cron_sched_t * sched_p, uint8_t group){
+    sched_p->paused |= (1UL << (group & (TM_CRON_GROUPS - 1)));
+    sched_p->wake_valid = 0;
+}
+
+
+void tm_cron_sched_resume_group(tm_cron_sched_t * sched_p, uint8_t group){
+    sched_p->paused &= ~(1UL << (group & (TM_CRON_GROUPS - 1)));
+    sched_p->wake_valid = 0;
+}
+
+#endif
+
+
+#if TIME_CRON_ENABLE_POLICIES
+
+void tm_cron_set_missed_handler(cron_job_t * job_p, 
+                                tm_cron_missed_handler_t handler){
+    job_p->handler = (void (*)(void))handler;
+    job_p->flags |= TM_CRON_FLAG_MISSED_ARG;
+}
+
+#endif
+
+
+#if TIME_CRON_ENABLE_BLACKOUT
+
+/**
+ * @brief Move the texec of a job to the end of the blackout window 
+ *        containing the given time, if there is one.
+ * 
+ * @return 1 if the job was deferred, 0 otherwise.
+ */
+static uint8_t tm_cron_sched_defer(tm_cron_sched_t * sched_p, 
+                                   cron_job_t * job_p, tm_system_t * time_p);
+
+static uint8_t tm_cron_sched_defer(tm_cron_sched_t * sched_p, 
+                                   cron_job_t * job_p, tm_system_t * time_p){
+    const tm_interval_t * window_p;
+    if (!job_p->blackout_p){
+        return 0;
+    }
+    window_p = tm_interval_set_find(job_p->blackout_p, time_p);
+    if (!window_p){
+        return 0;
+    }
+    // Windows in a set are disjoint and never touch, so the end of a 
+    // window is never inside another.
+    job_p->texec = window_p->end - sched_p->epoch_offset;
+    sched_p->deferrals ++;
+    return 1;
+}
+
+
+void tm_cron_sched_set_blackout(tm_cron_sched_t * sched_p, cron_job_t * job_p, 
+                                const tm_interval_set_t * set_p){
+    job_p->blackout_p = set_p;
+    if (job_p->active){
+        tm_cron_sched_replace_job(sched_p, job_p);
+    }
+}
+
+#endif
+
+
+void tm_cron_sched_insert_job(tm_cron_sched_t * sched_p, cron_job_t * job_p){
+    cron_job_t * walker;
+    cron_job_t * prev = NULL;
+    #if TIME_CRON_ENABLE_BLACKOUT
+    tm_system_t texec = job_p->texec + sched_p->epoch_offset;
+    tm_cron_sched_defer(sched_p, job_p, &texec);
+    #endif
+    critical_enter();
+    walker = sched_p->nextjob_p;
+    // Jobs with equal texec run in the order in which they were inserted.
+    while (walker && tm_cmp_stime(&(walker->texec), &(job_p->texec)) <= 0){
+        prev = walker;
+        walker = walker->nextjob;
+    }
+    job_p->prevjob = prev;
+    job_p->nextjob = walker;
+    if (prev){
+        prev->nextjob = job_p;
+    }
+    else{
+        sched_p->nextjob_p = job_p;
+    }
+    if (walker){
+        walker->prevjob = job_p;
+    }
+    job_p->active = 1;
+    sched_p->wake_valid = 0;
+    critical_exit();
+}
+
+
+void tm_cron_sched_insert_chain(tm_cron_sched_t * sched_p, cron_job_t * chain_p){
+    cron_job_t * job_p;
+    cron_job_t * walker;
+    cron_job_t * prev = NULL;
+    critical_enter();
+    walker = sched_p->nextjob_p;
+    while (chain_p){
+        job_p = chain_p;
+        chain_p = chain_p->nextjob;
+        // The chain is sorted, so the walk resumes from the last insertion.
+        while (walker && tm_cmp_stime(&(walker->texec), &(job_p->texec)) <= 0){
+            prev = walker;
+            walker = walker->nextjob;
         }
-        if (!(walker->nextjob)){
-            walker->nextjob = job_p;
-            job_p->prevjob = walker;
-            job_p->nextjob = NULL;
-            return;
+        job_p->prevjob = prev;
+        job_p->nextjob = walker;
+        if (prev){
+            prev->nextjob = job_p;
         }
-        walker = walker->nextjob;
-    };
+        else{
+            sched_p->nextjob_p = job_p;
+        }
+        if (walker){
+            walker->prevjob = job_p;
+        }
+        job_p->active = 1;
+        prev = job_p;
+    }
+    sched_p->wake_valid = 0;
     critical_exit();
 }
 
 
-void tm_cron_cancel_job(cron_job_t * job_p){
+static void tm_cron_sched_unlink(tm_cron_sched_t * sched_p, cron_job_t * job_p);
+
+static void tm_cron_sched_unlink(tm_cron_sched_t * sched_p, cron_job_t * job_p){
     if (job_p->nextjob){
         job_p->nextjob->prevjob = job_p->prevjob;
     }
@@ -116,40 +394,371 @@ void tm_cron_cancel_job(cron_job_t * job_p){
         job_p->prevjob->nextjob = job_p->nextjob;
     }
     else{
-        cron_nextjob_p = job_p->nextjob;
-        cron_nextjob_p->prevjob = NULL;
+        sched_p->nextjob_p = job_p->nextjob;
     }
+    job_p->nextjob = NULL;
+    job_p->prevjob = NULL;
     job_p->active = 0;
 }
 
 
-void tm_cron_poll(void){
-    if (!cron_nextjob_p){
+void tm_cron_sched_cancel_job(tm_cron_sched_t * sched_p, cron_job_t * job_p){
+    if (!job_p->active){
         return;
     }
-    tm_system_t current;
-    tm_current_time(&current);
+    critical_enter();
+    tm_cron_sched_unlink(sched_p, job_p);
+    sched_p->wake_valid = 0;
+    critical_exit();
+}
+
+
+#if TIME_CRON_ENABLE_GROUPS
+
+void tm_cron_sched_cancel_group(tm_cron_sched_t * sched_p, uint8_t group){
+    cron_job_t * walker;
+    cron_job_t * next;
+    group &= TM_CRON_GROUPS - 1;
+    critical_enter();
+    walker = sched_p->nextjob_p;
+    while (walker){
+        next = walker->nextjob;
+        if (walker->group == group){
+            tm_cron_sched_unlink(sched_p, walker);
+        }
+        walker = next;
+    }
+    sched_p->wake_valid = 0;
+    critical_exit();
+}
+
+#endif
+
+
+static inline uint8_t tm_cron_sched_is_paused(tm_cron_sched_t * sched_p, 
+                                              cron_job_t * job_p);
+
+static inline uint8_t tm_cron_sched_is_paused(tm_cron_sched_t * sched_p, 
+                                              cron_job_t * job_p){
+    #if TIME_CRON_ENABLE_GROUPS
+    return (sched_p->paused & (1UL << job_p->group)) != 0;
+    #else
+    (void)sched_p;
+    (void)job_p;
+    return 0;
+    #endif
+}
+
+
+static inline cron_job_t * tm_cron_sched_first(tm_cron_sched_t * sched_p);
+
+static inline cron_job_t * tm_cron_sched_first(tm_cron_sched_t * sched_p){
+    cron_job_t * walker = sched_p->nextjob_p;
+    // Paused jobs stay in the queue, and are stepped over.
+    while (walker && tm_cron_sched_is_paused(sched_p, walker)){
+        walker = walker->nextjob;
+    }
+    return walker;
+}
+
+
+#if TIME_CRON_ENABLE_EDF
+
+static inline tm_system_t tm_cron_edf_deadline(cron_job_t * job_p);
+
+static inline tm_system_t tm_cron_edf_deadline(cron_job_t * job_p){
+    if (!job_p->deadline){
+        return INT64_MAX;
+    }
+    return job_p->texec + job_p->deadline;
+}
+
+#endif
+
+
+static cron_job_t * tm_cron_sched_next_due(tm_cron_sched_t * sched_p, 
+                                           tm_system_t * limit);
+
+static cron_job_t * tm_cron_sched_next_due(tm_cron_sched_t * sched_p, 
+                                           tm_system_t * limit){
+    cron_job_t * job_p = tm_cron_sched_first(sched_p);
+    #if TIME_CRON_ENABLE_EDF
+    cron_job_t * walker;
+    tm_system_t deadline;
+    #endif
     
-    if (tm_cmp_stime(&(cron_nextjob_p->texec), &current) <= 0){
-        if (cron_nextjob_p->handler) {
-            cron_nextjob_p->handler();
+    if (!job_p || tm_cmp_stime(&(job_p->texec), limit) > 0){
+        return NULL;
+    }
+    #if TIME_CRON_ENABLE_EDF
+    // Select from all the due jobs, by class and then by deadline. Ties 
+    // go to the job earlier in the queue.
+    deadline = tm_cron_edf_deadline(job_p);
+    walker = job_p->nextjob;
+    while (walker && tm_cmp_stime(&(walker->texec), limit) <= 0){
+        if (!tm_cron_sched_is_paused(sched_p, walker) && 
+                (walker->prio < job_p->prio || 
+                 (walker->prio == job_p->prio && 
+                  tm_cron_edf_deadline(walker) < deadline))){
+            job_p = walker;
+            deadline = tm_cron_edf_deadline(job_p);
         }
-        if (cron_nextjob_p->tafter_p){
-            tm_apply_sdelta(&(cron_nextjob_p->texec), cron_nextjob_p->tafter_p);
-            tm_cron_replace_job(cron_nextjob_p);
+        walker = walker->nextjob;
+    }
+    #endif
+    return job_p;
+}
+
+
+static inline void tm_cron_run_job(tm_cron_sched_t * sched_p, 
+                                   cron_job_t * job_p, tm_system_t * now);
+
+static inline void tm_cron_run_job(tm_cron_sched_t * sched_p, 
+                                   cron_job_t * job_p, tm_system_t * now){
+    #if TIME_CRON_ENABLE_POLICIES
+    uint16_t missed = job_p->missed;
+    #endif
+    #if TIME_CRON_ENABLE_EDF
+    tm_system_t finish;
+    #endif
+    #if TIME_CRON_ENABLE_STATS
+    tm_system_t start, done;
+    tm_sdelta_t late, exec;
+    tm_get_sdelta(&(job_p->texec), now, &late);
+    tm_current_time(&start);
+    #else
+    (void)now;
+    #endif
+    #if !TIME_CRON_ENABLE_EDF
+    (void)sched_p;
+    #endif
+    
+    #if TIME_CRON_ENABLE_POLICIES
+    job_p->missed = 0;
+    if (job_p->handler && (job_p->flags & TM_CRON_FLAG_MISSED_ARG)){
+        ((tm_cron_missed_handler_t)(job_p->handler))(missed);
+    }
+    else
+    #endif
+    if (job_p->handler){
+        job_p->handler();
+    }
+    
+    #if TIME_CRON_ENABLE_EDF
+    if (job_p->deadline){
+        tm_current_time(&finish);
+        if (finish - sched_p->epoch_offset > job_p->texec + job_p->deadline){
+            sched_p->deadline_misses ++;
         }
-        else{
-            cron_nextjob_p->active = 0;
-            cron_nextjob_p = cron_nextjob_p->nextjob;
-            cron_nextjob_p->prevjob = NULL;
+    }
+    #endif
+    
+    #if TIME_CRON_ENABLE_STATS
+    tm_current_time(&done);
+    tm_get_sdelta(&start, &done, &exec);
+    tm_cron_stats_record(job_p, late, exec);
+    #endif
+}
+
+
+static void tm_cron_dispatch_job(tm_cron_sched_t * sched_p, cron_job_t * job_p, 
+                                 tm_system_t * current, tm_system_t * now);
+
+static void tm_cron_dispatch_job(tm_cron_sched_t * sched_p, cron_job_t * job_p, 
+                                 tm_system_t * current, tm_system_t * now){
+    tm_sdelta_t slots = 1;
+    #if TIME_CRON_ENABLE_POLICIES
+    tm_sdelta_t late;
+    uint8_t policy;
+    #endif
+
+    #if !TIME_CRON_ENABLE_SPEC && !TIME_CRON_ENABLE_BLACKOUT
+    (void)current;
+    #endif
+
+    #if TIME_CRON_ENABLE_BLACKOUT
+    // Windows may have been added since the job was inserted.
+    if (tm_cron_sched_defer(sched_p, job_p, current)){
+        tm_cron_sched_replace_job(sched_p, job_p);
+        return;
+    }
+    #endif
+
+    #if TIME_CRON_ENABLE_POLICIES
+    policy = job_p->flags & TM_CRON_POLICY_MASK;
+    if (tm_cron_job_periodic(job_p) && policy != TM_CRON_POLICY_CATCHUP && 
+            *(job_p->tafter_p) > 0){
+        tm_get_sdelta(&(job_p->texec), now, &late);
+        if (late >= *(job_p->tafter_p)){
+            // Number of slots up to and including the current time, 
+            // all of which are handled by this poll. 
+            slots = late / *(job_p->tafter_p) + 1;
         }
     }
+
+    #if TIME_CRON_ENABLE_POOL
+    if (sched_p->pool_p){
+        tm_cron_pool_dispatch(sched_p->pool_p, job_p, 
+                              job_p->texec + sched_p->epoch_offset, 
+                              slots, policy);
+    }
+    else
+    #endif
+    if (policy == TM_CRON_POLICY_SKIP && slots > 1){
+        tm_cron_add_missed(job_p, slots);
+    }
+    else{
+        tm_cron_add_missed(job_p, slots - 1);
+        tm_cron_run_job(sched_p, job_p, now);
+    }
+    #else
+    tm_cron_run_job(sched_p, job_p, now);
+    #endif
+
+    #if TIME_CRON_ENABLE_SPEC
+    if (job_p->spec_p && 
+            !tm_cron_spec_next(job_p->spec_p, current, &(job_p->texec))){
+        job_p->texec -= sched_p->epoch_offset;
+        tm_cron_sched_replace_job(sched_p, job_p);
+    }
+    else
+    #endif
+    if (job_p->tafter_p){
+        job_p->texec += *(job_p->tafter_p) * slots;
+        tm_cron_sched_replace_job(sched_p, job_p);
+    }
+    else{
+        tm_cron_sched_cancel_job(sched_p, job_p);
+    }
 }
 
-void tm_cron_epoch_change_handler(tm_sdelta_t * offset){
-    cron_job_t * walker = cron_nextjob_p;
-    while (walker){
-        tm_apply_sdelta(&(walker->texec), offset);
+
+static void tm_cron_update_wake(tm_cron_sched_t * sched_p);
+
+static void tm_cron_update_wake(tm_cron_sched_t * sched_p){
+    cron_job_t * walker = tm_cron_sched_first(sched_p);
+    tm_system_t wake, last;
+    uint8_t count = 1;
+    uint8_t distinct = 1;
+
+    sched_p->wake_valid = 1;
+    if (!walker){
+        // Every job in the queue is paused.
+        sched_p->wake_count = 0;
+        return;
+    }
+    wake = walker->texec + tm_cron_job_slack(walker);
+    last = walker->texec;
+    walker = walker->nextjob;
+    while (walker && walker->texec <= wake && count < 0xFF){
+        if (tm_cron_sched_is_paused(sched_p, walker)){
+            walker = walker->nextjob;
+            continue;
+        }
+        if (walker->texec + tm_cron_job_slack(walker) < wake){
+            wake = walker->texec + tm_cron_job_slack(walker);
+        }
+        if (walker->texec != last){
+            last = walker->texec;
+            distinct ++;
+        }
+        count ++;
         walker = walker->nextjob;
     }
+    sched_p->wake = wake;
+    sched_p->wake_count = count;
+    sched_p->wake_saved = distinct - 1;
+}
+
+
+uint8_t tm_cron_sched_next_wake(tm_cron_sched_t * sched_p, 
+                                tm_system_t * wake_p){
+    tm_system_t wake;
+    uint8_t rval = 1;
+    #if TIME_CRON_ENABLE_TABLES
+    tm_system_t due;
+    #endif
+
+    tm_cron_sched_follow_epoch(sched_p);
+    if (sched_p->nextjob_p){
+        if (!sched_p->wake_valid){
+            tm_cron_update_wake(sched_p);
+        }
+        if (sched_p->wake_count){
+            wake = sched_p->wake;
+            rval = 0;
+        }
+    }
+    #if TIME_CRON_ENABLE_TABLES
+    if (tm_cron_table_next(sched_p, &due) && (rval || due < wake)){
+        wake = due;
+        rval = 0;
+    }
+    #endif
+    if (!rval){
+        *wake_p = wake + sched_p->epoch_offset;
+    }
+    return rval;
+}
+
+
+void tm_cron_sched_poll(tm_cron_sched_t * sched_p){
+    tm_system_t current;
+    tm_system_t now;
+    cron_job_t * job_p;
+    uint8_t count = 0;
+    #if TIME_CRON_ENABLE_TABLES
+    tm_cron_table_t * table_p;
+    tm_system_t due;
+    #endif
+
+    tm_cron_sched_follow_epoch(sched_p);
+
+    #if TIME_CRON_SUBMIT_QUEUE_LEN
+    tm_cron_sched_submit_drain(sched_p);
+    #endif
+
+    #if TIME_CRON_ENABLE_TABLES
+    if (!sched_p->nextjob_p && !sched_p->tables_p){
+        return;
+    }
+    #else
+    if (!sched_p->nextjob_p){
+        return;
+    }
+    #endif
+    tm_current_time(&current);
+    now = current - sched_p->epoch_offset;
+
+    if (sched_p->nextjob_p){
+        if (!sched_p->wake_valid){
+            tm_cron_update_wake(sched_p);
+        }
+        if (sched_p->wake_count && now >= sched_p->wake){
+            sched_p->wakeups ++;
+            sched_p->wakeups_saved += sched_p->wake_saved;
+            count = sched_p->wake_count;
+        }
+    }
+
+    #if TIME_CRON_ENABLE_TABLES
+    // Merge due table entries with the due jobs, in time order.
+    while ((table_p = tm_cron_table_next(sched_p, &due)) && due <= now){
+        while (count && (job_p = tm_cron_sched_next_due(sched_p, &due))){
+            tm_cron_dispatch_job(sched_p, job_p, &current, &now);
+            count --;
+        }
+        tm_cron_table_run(table_p, &now);
+    }
+    #endif
+
+    while (count-- && (job_p = tm_cron_sched_next_due(sched_p, &now))){
+        tm_cron_dispatch_job(sched_p, job_p, &current, &now);
+    }
+}
+
+void tm_cron_sched_epoch_change_handler(void * sched_p, tm_sdelta_t * offset){
+    // Every deadline in the queue shifts by the same offset, so neither 
+    // the jobs nor their order need to be touched.
+    ((tm_cron_sched_t *)sched_p)->epoch_offset += *offset;
 }
@@ -40,44 +40,842 @@
 
 #include "stddef.h"
 #include "time.h"
+#include "cron_spec.h"
+#include "interval.h"
 
+/**
+ * @name Periodic Job Catch-up Policies
+ * 
+ * These policies determine what happens when a periodic job is polled 
+ * after one or more of its following runs are also already due, ie, when 
+ * the job is late by at least one full period. This would typically 
+ * happen if the main loop was blocked for a while.
+ * 
+ *  - CATCHUP  : Every missed run is executed, back to back, until the 
+ *               job catches up. This was the only available behaviour 
+ *               earlier and remains the default.
+ *  - COALESCE : The job is run once, and is then rescheduled to the next 
+ *               slot after the current time. 
+ *  - SKIP     : The late run is dropped altogether, and the job is 
+ *               rescheduled to the next slot after the current time. 
+ *               Late by less than one period is not considered missed.
+ * 
+ * With all policies, slots remain aligned to the original texec of the 
+ * job. The number of slots after the original texec is determined by 
+ * a single division, and not by repeated addition of the period. 
+ * 
+ * These policies apply only to jobs with a fixed period, ie, with 
+ * `tafter_p` set. Jobs using calendar specifications are always 
+ * rescheduled relative to the time at which they run. 
+ * 
+ * Per-job policies and missed run counts are only available when 
+ * TIME_CRON_ENABLE_POLICIES is set. Otherwise, every job uses CATCHUP. 
+ */
+/**@{*/ 
+
+#define TM_CRON_POLICY_CATCHUP      0x00
+#define TM_CRON_POLICY_COALESCE     0x01
+#define TM_CRON_POLICY_SKIP         0x02
+#define TM_CRON_POLICY_MASK         0x03
+
+/**@}*/ 
+
+#define TM_CRON_FLAG_MISSED_ARG     0x04
+
+/**
+ * @brief Handler type for jobs which want to know about missed runs.
+ * 
+ * The argument is the number of runs of the job which were not (and 
+ * will not be) executed since the previous call to the handler. It 
+ * saturates at 0xFFFF.
+ */
+typedef void (* tm_cron_missed_handler_t)(uint16_t missed);
+
+struct TM_CRON_STATS_t;
+struct TM_CRON_POOL_t;
+struct TM_CRON_TABLE_t;
 
 typedef struct CRON_JOB_t{
     tm_system_t   texec;
     uint8_t       active;
+#if TIME_CRON_ENABLE_POLICIES
+    uint8_t       flags;
+    uint16_t      missed;
+#endif
+#if TIME_CRON_ENABLE_SLACK
+    uint16_t      slack;
+#endif
+#if TIME_CRON_ENABLE_GROUPS
+    uint8_t       group;
+#endif
+#if TIME_CRON_ENABLE_EDF
+    uint8_t       prio;
+    uint16_t      deadline;
+#endif
     tm_sdelta_t * tafter_p;
+#if TIME_CRON_ENABLE_BLACKOUT
+    const tm_interval_set_t * blackout_p;
+#endif
+#if TIME_CRON_ENABLE_SPEC
+    const tm_cron_spec_t * spec_p;
+#endif
     struct CRON_JOB_t * nextjob;
     struct CRON_JOB_t * prevjob;
     void (* handler)(void);
+#if TIME_CRON_ENABLE_STATS
+    struct TM_CRON_STATS_t * stats_p;
+#endif
+#if TIME_CRON_ENABLE_POOL
+    uint16_t      pending;
+    uint8_t       pool_state;
+    tm_system_t   tdue;
+#endif
 }cron_job_t;
 
-extern cron_job_t * cron_nextjob_p;
+#if TIME_CRON_SUBMIT_QUEUE_LEN
+typedef struct TM_CRON_SUBMIT_SLOT_t{
+    unsigned int seq;
+    uint8_t op;
+    cron_job_t * job_p;
+    tm_system_t texec;
+} tm_cron_submit_slot_t;
+#endif
+
+/**
+ * @brief Cron Scheduler Instance Type
+ * 
+ * Each instance has its own queue, epoch offset and wake state, and 
+ * registers its own epoch change handler. Instances are independent of 
+ * each other, and may be polled at different rates or from different 
+ * tasks, so long as each instance is only ever used from one of them. 
+ * A job belongs to a single instance at a time. All functions operating 
+ * on the queue have a `tm_cron_sched_` form which takes the instance. 
+ * The `tm_cron_` forms operate on the default instance, 
+ * `tm_cron_default`, which is initialized by `tm_init()`.
+ * 
+ * Initialize using `tm_cron_sched_init()`. Members should be treated as 
+ * read-only by the application. 
+ */
+typedef struct TM_CRON_SCHED_t{
+    cron_job_t * nextjob_p;
+    tm_sdelta_t epoch_offset;
+    uint32_t wakeups;
+    uint32_t wakeups_saved;
+    tm_system_t wake;
+    uint8_t wake_count;
+    uint8_t wake_saved;
+    uint8_t wake_valid;
+#if TIME_CRON_ENABLE_GROUPS
+    uint32_t paused;
+#endif
+#if TIME_CRON_ENABLE_EDF
+    uint32_t deadline_misses;
+#endif
+#if TIME_CRON_ENABLE_BLACKOUT
+    uint32_t deferrals;
+#endif
+    tm_epochchange_handler_t change_handler;
+#if TIME_CRON_SUBMIT_QUEUE_LEN
+    tm_cron_submit_slot_t submit_ring[TIME_CRON_SUBMIT_QUEUE_LEN];
+    unsigned int submit_head;
+    unsigned int submit_tail;
+#endif
+#if TIME_CRON_ENABLE_POOL
+    struct TM_CRON_POOL_t * pool_p;
+#endif
+#if TIME_CRON_ENABLE_TABLES
+    struct TM_CRON_TABLE_t * tables_p;
+#endif
+}tm_cron_sched_t;
+
+extern tm_cron_sched_t tm_cron_default;
+
+#define cron_nextjob_p              (tm_cron_default.nextjob_p)
+#define cron_epoch_offset           (tm_cron_default.epoch_offset)
+#define cron_wakeups                (tm_cron_default.wakeups)
+#define cron_wakeups_saved          (tm_cron_default.wakeups_saved)
+
+/**
+ * @brief Initialize a scheduler instance.
+ * 
+ * Clears the instance and registers its epoch change handler. An 
+ * instance should only be initialized once.
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ */
+void tm_cron_sched_init(tm_cron_sched_t * sched_p);
+
+void tm_cron_sched_clear_job(tm_cron_sched_t * sched_p, cron_job_t * job_p);
+
+/**
+ * @brief Prepare a job without inserting it into the queue.
+ * 
+ * Sets the handler and period of the job, resets its policy and detaches
+ * its statistics container, if any. This is what the tm_cron_create_job_ functions do before
+ * they insert the job, and is useful for jobs which are later scheduled 
+ * using `tm_cron_submit_job()`. The job must not already be active, 
+ * or have runs pending with a worker pool. The tm_cron_create_job_ 
+ * functions drop any such runs safely.
+ * 
+ * @param job_p Pointer to the job to prepare.
+ * @param handler The job handler function.
+ * @param tafter_p Pointer to the job period, or NULL for one-shot jobs.
+ */
+void tm_cron_setup_job(cron_job_t * job_p, void handler(void), 
+                       tm_sdelta_t * tafter_p);
+
+/**
+ * @brief Prepare a job of a scheduler instance without inserting it.
+ * 
+ * As `tm_cron_setup_job()`, but also drops any runs of the job still 
+ * pending with the worker pool of the instance. Used by the 
+ * tm_cron_create_job_ functions and by the persistence restore.
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ * @param job_p Pointer to the job to prepare.
+ * @param handler The job handler function.
+ * @param tafter_p Pointer to the job period, or NULL for one-shot jobs.
+ */
+void tm_cron_sched_setup_job(tm_cron_sched_t * sched_p, 
+                             cron_job_t * job_p, void handler(void), 
+                             tm_sdelta_t * tafter_p);
+
+void tm_cron_sched_create_job_abs(tm_cron_sched_t * sched_p, 
+                                  cron_job_t * job_p, void handler(void), 
+                                  tm_system_t * texec_p, 
+                                  tm_sdelta_t * tafter_p);
+
+void tm_cron_sched_create_job_rel(tm_cron_sched_t * sched_p, 
+                                  cron_job_t * job_p, void handler(void), 
+                                  tm_sdelta_t * trelexec_p, 
+                                  tm_sdelta_t * tafter_p);
+
+#if TIME_CRON_ENABLE_SPEC
+
+/**
+ * @brief Create a job which runs according to a calendar specification.
+ * 
+ * The job is first scheduled at the earliest time matching the 
+ * specification after the current time. Each time the job runs, it is 
+ * rescheduled to the next matching time after the time at which it was 
+ * run. If no matching time can be found, the job is left inactive. 
+ * 
+ * The specification is not copied, and must remain valid for as long as 
+ * the job is in use. Only available when TIME_CRON_ENABLE_SPEC is set.
+ * 
+ * @see cron_spec.h
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ * @param job_p Pointer to the job to create.
+ * @param handler The job handler function.
+ * @param spec_p Pointer to the calendar specification for the job.
+ */
+void tm_cron_sched_create_job_spec(tm_cron_sched_t * sched_p, 
+                                   cron_job_t * job_p, void handler(void), 
+                                   const tm_cron_spec_t * spec_p);
+
+#endif
+
+#if TIME_CRON_ENABLE_POLICIES
+
+/**
+ * @brief Set the catch-up policy of a periodic job.
+ * 
+ * Job creation resets the policy to TM_CRON_POLICY_CATCHUP, so this 
+ * should be called after the job is created. 
+ * 
+ * @param job_p Pointer to the job.
+ * @param policy One of the TM_CRON_POLICY_ definitions.
+ */
+static inline void tm_cron_set_policy(cron_job_t * job_p, uint8_t policy);
+
+static inline void tm_cron_set_policy(cron_job_t * job_p, uint8_t policy){
+    job_p->flags = (job_p->flags & ~TM_CRON_POLICY_MASK) | 
+                   (policy & TM_CRON_POLICY_MASK);
+}
+
+#endif
+
+#if TIME_CRON_ENABLE_SLACK
+
+/**
+ * @brief Set the slack window of a job.
+ * 
+ * A job with a slack (tolerance) window may be run up to `slack` ms after 
+ * its texec. The scheduler uses these windows to batch jobs into a 
+ * single wake. Starting from the first job in the queue, the wake time 
+ * is the earliest end of the windows of all jobs which are due by that 
+ * wake time. All of these jobs are then dispatched together by a single 
+ * poll. With no slack, the wake is at the texec of the first job. The 
+ * number of wakes, and the number of wakes which were saved by batching 
+ * jobs with distinct execution times, are counted in the `wakeups` and 
+ * `wakeups_saved` of the instance.
+ * 
+ * Job creation resets the slack to 0, so this should be called after the 
+ * job is created.
+ * 
+ * @param sched_p Pointer to the scheduler instance holding the job.
+ * @param job_p Pointer to the job.
+ * @param slack Maximum acceptable delay of the job, in ms.
+ */
+void tm_cron_sched_set_slack(tm_cron_sched_t * sched_p, cron_job_t * job_p, 
+                             uint16_t slack);
+
+#endif
+
+#if TIME_CRON_ENABLE_GROUPS
+
+/**
+ * @name Job Groups
+ * 
+ * When TIME_CRON_ENABLE_GROUPS is set, each job belongs to one of 
+ * TM_CRON_GROUPS groups (group 0 by default), which can be paused, 
+ * resumed or cancelled together. Pausing or resuming a group is O(1). 
+ * Jobs of paused groups stay in the queue, are stepped over by the poll, 
+ * and do not contribute to the wake time. When the group is resumed, 
+ * jobs which came due while it was paused are handled according to 
+ * their catch-up policies. Cancelling a group unlinks all its jobs in a 
+ * single pass over the queue, within one critical section.
+ */
+/**@{*/ 
+
+#define TM_CRON_GROUPS              32
+
+/**
+ * @brief Set the group of a job.
+ * 
+ * Job creation resets the group to 0, so this should be called after the
+ * job is created.
+ * 
+ * @param sched_p Pointer to the scheduler instance holding the job.
+ * @param job_p Pointer to the job.
+ * @param group Group of the job, less than TM_CRON_GROUPS.
+ */
+void tm_cron_sched_set_group(tm_cron_sched_t * sched_p, cron_job_t * job_p, 
+                             uint8_t group);
+
+/**
+ * @brief Stop running the jobs of a group, without removing them.
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ * @param group The group to pause.
+ */
+void tm_cron_sched_pause_group(tm_cron_sched_t * sched_p, uint8_t group);
+
+/**
+ * @brief Resume running the jobs of a paused group.
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ * @param group The group to resume.
+ */
+void tm_cron_sched_resume_group(tm_cron_sched_t * sched_p, uint8_t group);
+
+/**
+ * @brief Remove every job of a group from the queue.
+ * 
+ * The pause state of the group is left unchanged.
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ * @param group The group to cancel.
+ */
+void tm_cron_sched_cancel_group(tm_cron_sched_t * sched_p, uint8_t group);
+
+/**@}*/ 
+
+#endif
+
+#if TIME_CRON_ENABLE_EDF
+
+/**
+ * @name Priority Classes and Deadlines
+ * 
+ * When TIME_CRON_ENABLE_EDF is set, jobs also carry a priority class and 
+ * an optional completion deadline, relative to their texec. When more 
+ * than one job is due in a poll, they are dispatched in order of class 
+ * (lower first), and within a class in order of absolute deadline 
+ * (earliest first). Jobs without a deadline follow those with one, in 
+ * queue order. Selecting each job walks the due jobs, so a poll with k 
+ * due jobs costs O(k^2) comparisons. Jobs which are not yet due are 
+ * never run early. Runs which complete after their deadline are counted 
+ * in the `deadline_misses` of the instance. Runs handed to a worker pool 
+ * are ordered, but are not checked against their deadlines.
+ */
+/**@{*/ 
+
+#define TM_CRON_PRIO_CLASSES        4
+#define TM_CRON_PRIO_DEFAULT        2
+
+/**
+ * @brief Set the priority class of a job.
+ * 
+ * Job creation resets the class to TM_CRON_PRIO_DEFAULT, so this should 
+ * be called after the job is created.
+ * 
+ * @param job_p Pointer to the job.
+ * @param prio Priority class, from 0 (highest) to TM_CRON_PRIO_CLASSES - 1.
+ */
+static inline void tm_cron_set_priority(cron_job_t * job_p, uint8_t prio);
+
+static inline void tm_cron_set_priority(cron_job_t * job_p, uint8_t prio){
+    job_p->prio = (prio < TM_CRON_PRIO_CLASSES) ? prio : (TM_CRON_PRIO_CLASSES - 1);
+}
+
+/**
+ * @brief Set the completion deadline of a job.
+ * 
+ * Job creation clears the deadline, so this should be called after the 
+ * job is created.
+ * 
+ * @param job_p Pointer to the job.
+ * @param deadline Time after texec by which each run should complete, in 
+ *                 ms, or 0 for none.
+ */
+static inline void tm_cron_set_deadline(cron_job_t * job_p, uint16_t deadline);
+
+static inline void tm_cron_set_deadline(cron_job_t * job_p, uint16_t deadline){
+    job_p->deadline = deadline;
+}
+
+/**@}*/ 
+
+#endif
+
+#if TIME_CRON_ENABLE_BLACKOUT
+
+/**
+ * @brief Set the blackout windows of a job.
+ * 
+ * The job must not run during any of the windows (see `interval.h`). A 
+ * job whose texec falls inside a window when it is inserted, or which 
+ * is polled while the current time is inside one, has its texec moved 
+ * to the end of the window, and does not wake or run until then. Each 
+ * check is a single O(log n) lookup. Periodic jobs continue from the end 
+ * of the window, so their slots are realigned to it. Deferrals are 
+ * counted in the `deferrals` of the instance.
+ * 
+ * Job creation clears the blackout windows. If the job is active, it is 
+ * deferred at once if its texec is inside one of the windows. The set 
+ * is not copied, and must remain valid for as long as the job uses it. 
+ * Windows added to the set later take effect when the job is polled.
+ * 
+ * @param sched_p Pointer to the scheduler instance holding the job.
+ * @param job_p Pointer to the job.
+ * @param set_p Pointer to the interval set of windows, or NULL.
+ */
+void tm_cron_sched_set_blackout(tm_cron_sched_t * sched_p, cron_job_t * job_p, 
+                                const tm_interval_set_t * set_p);
+
+#endif
+
+#if TIME_CRON_ENABLE_POLICIES
+
+/**
+ * @brief Replace the handler of a job with one which is provided the 
+ *        number of missed runs.
+ * 
+ * Job creation resets the handler, so this should be called after the 
+ * job is created. 
+ * 
+ * @param job_p Pointer to the job.
+ * @param handler The job handler function.
+ */
+void tm_cron_set_missed_handler(cron_job_t * job_p, 
+                                tm_cron_missed_handler_t handler);
+
+/**
+ * @brief Add to the missed run count of a job, saturating at 0xFFFF.
+ * 
+ * Used internally by the scheduler.
+ */
+static inline void tm_cron_add_missed(cron_job_t * job_p, tm_sdelta_t count);
+
+static inline void tm_cron_add_missed(cron_job_t * job_p, tm_sdelta_t count){
+    if (count >= (tm_sdelta_t)(0xFFFF - job_p->missed)){
+        job_p->missed = 0xFFFF;
+    }
+    else{
+        job_p->missed += count;
+    }
+}
+
+#endif
+
+/**
+ * @brief Check whether a job has a fixed period, rather than a calendar 
+ *        specification or none at all. 
+ * 
+ * Used internally by the scheduler.
+ */
+static inline uint8_t tm_cron_job_periodic(const cron_job_t * job_p);
+
+static inline uint8_t tm_cron_job_periodic(const cron_job_t * job_p){
+    #if TIME_CRON_ENABLE_SPEC
+    if (job_p->spec_p){
+        return 0;
+    }
+    #endif
+    return (job_p->tafter_p != NULL);
+}
+
+/**
+ * @brief Get the slack window of a job, which is 0 unless 
+ *        TIME_CRON_ENABLE_SLACK is set.
+ * 
+ * Used internally by the scheduler.
+ */
+static inline uint16_t tm_cron_job_slack(const cron_job_t * job_p);
+
+static inline uint16_t tm_cron_job_slack(const cron_job_t * job_p){
+    #if TIME_CRON_ENABLE_SLACK
+    return job_p->slack;
+    #else
+    (void)job_p;
+    return 0;
+    #endif
+}
+
+/**
+ * @brief Apply the epoch changes posted since the instance last saw them.
+ * 
+ * With TIME_ENABLE_EPOCH_DEFER, the system time moves to the new epoch 
+ * as soon as a change is posted, but the epoch offset of the instance 
+ * only follows when the change is dispatched to it. This is done before 
+ * every poll, and before every conversion between absolute times and 
+ * stored job times, so that jobs created in between are not shifted 
+ * twice. Only the handler of this instance is dispatched, so instances 
+ * polled from different tasks do not touch each other. Used internally 
+ * by the scheduler. Does nothing otherwise.
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ */
+static inline void tm_cron_sched_follow_epoch(tm_cron_sched_t * sched_p);
+
+static inline void tm_cron_sched_follow_epoch(tm_cron_sched_t * sched_p){
+    #if TIME_ENABLE_EPOCH_DEFER
+    tm_epoch_change_dispatch_handler(&(sched_p->change_handler));
+    #else
+    (void)sched_p;
+    #endif
+}
+
+/**
+ * @brief Get the execution time of a job against the epoch.
+ * 
+ * Job execution times (`texec`) are not stored against the epoch, but 
+ * against the queue base, which is offset from the epoch by the 
+ * `epoch_offset` of the instance. When the epoch changes or time is 
+ * synchronized, every deadline in the queue shifts by the same amount. 
+ * This is handled by updating the offset alone, in O(1), leaving the 
+ * jobs and their order untouched. Absolute times provided to and 
+ * obtained from the public functions are always against the epoch. 
+ * Applications should use this function rather than reading `texec` 
+ * directly.
+ * 
+ * @param sched_p Pointer to the scheduler instance holding the job.
+ * @param job_p Pointer to the job.
+ * @param texec_p Pointer to the tm_system_t in which to store the result.
+ */
+static inline void tm_cron_sched_get_texec(tm_cron_sched_t * sched_p, 
+                                           cron_job_t * job_p, 
+                                           tm_system_t * texec_p);
+
+static inline void tm_cron_sched_get_texec(tm_cron_sched_t * sched_p, 
+                                           cron_job_t * job_p, 
+                                           tm_system_t * texec_p){
+    tm_cron_sched_follow_epoch(sched_p);
+    *texec_p = job_p->texec + sched_p->epoch_offset;
+}
+
+/**
+ * @brief Insert a prepared job into the queue.
+ * 
+ * Jobs with the same execution time run in the order in which they 
+ * were inserted. The job must not already be active. This walks the 
+ * queue with interrupts disabled, and must not be called from interrupt 
+ * context. See `tm_cron_submit_job()` instead.
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ * @param job_p Pointer to the job to insert.
+ */
+void tm_cron_sched_insert_job(tm_cron_sched_t * sched_p, cron_job_t * job_p);
+
+/**
+ * @brief Insert a chain of prepared jobs into the queue in one pass.
+ * 
+ * The jobs must be linked through their `nextjob` pointers and already 
+ * be sorted by texec. The chain is merged into the queue with a single 
+ * walk, rather than one walk per job. Among jobs with the same execution 
+ * time, jobs already in the queue run first. None of the jobs may 
+ * already be active.
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ * @param chain_p Pointer to the first job of the chain.
+ */
+void tm_cron_sched_insert_chain(tm_cron_sched_t * sched_p, cron_job_t * chain_p);
+
+/**
+ * @brief Remove a job from the queue. 
+ * 
+ * Does nothing if the job is not active. 
+ * 
+ * @param sched_p Pointer to the scheduler instance holding the job.
+ * @param job_p Pointer to the job to cancel.
+ */
+void tm_cron_sched_cancel_job(tm_cron_sched_t * sched_p, cron_job_t * job_p);
+
+static inline void tm_cron_sched_replace_job(tm_cron_sched_t * sched_p, 
+                                             cron_job_t * job_p);
+
+static inline void tm_cron_sched_replace_job(tm_cron_sched_t * sched_p, 
+                                             cron_job_t * job_p){
+    if (job_p->active){
+        tm_cron_sched_cancel_job(sched_p, job_p);
+    }
+    tm_cron_sched_insert_job(sched_p, job_p);
+}
+
+#if TIME_CRON_SUBMIT_QUEUE_LEN
+
+/**
+ * @name Interrupt Context Job Submission
+ * 
+ * `tm_cron_insert_job()` walks the job queue with interrupts disabled, 
+ * and must not be used from interrupt handlers. Interrupt handlers should 
+ * instead submit requests to schedule or cancel jobs to the submission 
+ * queue, which is drained by `tm_cron_poll()` in the main loop. 
+ * 
+ * Submission is O(1) and lock-free on platforms with a native word-sized 
+ * compare-and-swap. Elsewhere, it uses a short critical section instead. 
+ * Any number of interrupt handlers (and the main loop) may submit 
+ * concurrently. Requests are applied in the order in which submission 
+ * slots were reserved.
+ * 
+ * Only the execution time is carried by the request. The handler and 
+ * period of the job must already be set, see `tm_cron_setup_job()`, and 
+ * should not be changed while the job is active. The execution time is 
+ * interpreted against the epoch in effect when the request is drained.
+ * 
+ * Each scheduler instance has its own submission queue, drained when 
+ * that instance is polled. The queue length is set by 
+ * TIME_CRON_SUBMIT_QUEUE_LEN, and must be a power of 2. Submission 
+ * functions return non-zero if the queue is full.
+ */
+/**@{*/ 
+
+#define TM_CRON_SUBMIT_SCHEDULE     1
+#define TM_CRON_SUBMIT_CANCEL       2
+
+/**
+ * @brief Request a job to be (re)scheduled at the given time.
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ * @param job_p Pointer to the (prepared) job.
+ * @param texec_p Pointer to the absolute execution time of the job.
+ * @return 0 on success, 1 if the submission queue is full.
+ */
+uint8_t tm_cron_sched_submit_job(tm_cron_sched_t * sched_p, 
+                                 cron_job_t * job_p, tm_system_t * texec_p);
+
+/**
+ * @brief Request a job to be cancelled.
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ * @param job_p Pointer to the job.
+ * @return 0 on success, 1 if the submission queue is full.
+ */
+uint8_t tm_cron_sched_submit_cancel(tm_cron_sched_t * sched_p, 
+                                    cron_job_t * job_p);
+
+void tm_cron_sched_submit_init(tm_cron_sched_t * sched_p);
+
+void tm_cron_sched_submit_drain(tm_cron_sched_t * sched_p);
+
+/**@}*/ 
+
+#endif
+
+/**
+ * @brief Get the time at which `tm_cron_sched_poll()` next needs to be 
+ *        called.
+ * 
+ * This includes the entries of any attached constant tables, and takes 
+ * the slack windows of the jobs into account. Tickless applications 
+ * should sleep until this time.
+ * 
+ * @param sched_p Pointer to the scheduler instance.
+ * @param wake_p Pointer to the tm_system_t in which to store the result.
+ * @return 0 on success, 1 if there are no jobs in the queue.
+ */
+uint8_t tm_cron_sched_next_wake(tm_cron_sched_t * sched_p, 
+                                tm_system_t * wake_p);
+
+void tm_cron_sched_poll(tm_cron_sched_t * sched_p);
+
+void tm_cron_sched_epoch_change_handler(void * sched_p, tm_sdelta_t * offset);
+
+/**
+ * @name Default Instance Functions
+ * 
+ * These operate on `tm_cron_default`.
+ */
+/**@{*/ 
 
 void tm_cron_init(void);
 
-void tm_cron_clear_job(cron_job_t* job_p);
+static inline void tm_cron_clear_job(cron_job_t * job_p);
+
+static inline void tm_cron_clear_job(cron_job_t * job_p){
+    tm_cron_sched_clear_job(&tm_cron_default, job_p);
+}
+
+static inline void tm_cron_create_job_abs(cron_job_t * job_p, void handler(void), 
+                                          tm_system_t * texec_p, 
+                                          tm_sdelta_t * tafter_p);
+
+static inline void tm_cron_create_job_abs(cron_job_t * job_p, void handler(void), 
+                                          tm_system_t * texec_p, 
+                                          tm_sdelta_t * tafter_p){
+    tm_cron_sched_create_job_abs(&tm_cron_default, job_p, handler, 
+                                 texec_p, tafter_p);
+}
+
+static inline void tm_cron_create_job_rel(cron_job_t * job_p, void handler(void), 
+                                          tm_sdelta_t * trelexec_p, 
+                                          tm_sdelta_t * tafter_p);
+
+static inline void tm_cron_create_job_rel(cron_job_t * job_p, void handler(void), 
+                                          tm_sdelta_t * trelexec_p, 
+                                          tm_sdelta_t * tafter_p){
+    tm_cron_sched_create_job_rel(&tm_cron_default, job_p, handler, 
+                                 trelexec_p, tafter_p);
+}
+
+#if TIME_CRON_ENABLE_SPEC
+
+static inline void tm_cron_create_job_spec(cron_job_t * job_p, void handler(void), 
+                                           const tm_cron_spec_t * spec_p);
+
+static inline void tm_cron_create_job_spec(cron_job_t * job_p, void handler(void), 
+                                           const tm_cron_spec_t * spec_p){
+    tm_cron_sched_create_job_spec(&tm_cron_default, job_p, handler, spec_p);
+}
+
+#endif
+
+#if TIME_CRON_ENABLE_SLACK
+
+static inline void tm_cron_set_slack(cron_job_t * job_p, uint16_t slack);
+
+static inline void tm_cron_set_slack(cron_job_t * job_p, uint16_t slack){
+    tm_cron_sched_set_slack(&tm_cron_default, job_p, slack);
+}
+
+#endif
+
+#if TIME_CRON_ENABLE_GROUPS
+
+static inline void tm_cron_set_group(cron_job_t * job_p, uint8_t group);
+
+static inline void tm_cron_set_group(cron_job_t * job_p, uint8_t group){
+    tm_cron_sched_set_group(&tm_cron_default, job_p, group);
+}
+
+static inline void tm_cron_pause_group(uint8_t group);
+
+static inline void tm_cron_pause_group(uint8_t group){
+    tm_cron_sched_pause_group(&tm_cron_default, group);
+}
+
+static inline void tm_cron_resume_group(uint8_t group);
+
+static inline void tm_cron_resume_group(uint8_t group){
+    tm_cron_sched_resume_group(&tm_cron_default, group);
+}
+
+static inline void tm_cron_cancel_group(uint8_t group);
+
+static inline void tm_cron_cancel_group(uint8_t group){
+    tm_cron_sched_cancel_group(&tm_cron_default, group);
+}
+
+#endif
+
+#if TIME_CRON_ENABLE_BLACKOUT
 
-void tm_cron_create_job_abs(cron_job_t * job_p, void handler(void), 
-                            tm_system_t * texec_p, tm_sdelta_t * tafter_p);
+static inline void tm_cron_set_blackout(cron_job_t * job_p, 
+                                        const tm_interval_set_t * set_p);
 
-void tm_cron_create_job_rel(cron_job_t * job_p, void handler(void), 
-                            tm_sdelta_t * trelexec_p, tm_sdelta_t * tafter_p);
+static inline void tm_cron_set_blackout(cron_job_t * job_p, 
+                                        const tm_interval_set_t * set_p){
+    tm_cron_sched_set_blackout(&tm_cron_default, job_p, set_p);
+}
 
-void tm_cron_insert_job(cron_job_t * job_p);
+#endif
 
-void tm_cron_cancel_job(cron_job_t * job_p);
+static inline void tm_cron_get_texec(cron_job_t * job_p, tm_system_t * texec_p);
+
+static inline void tm_cron_get_texec(cron_job_t * job_p, tm_system_t * texec_p){
+    tm_cron_sched_get_texec(&tm_cron_default, job_p, texec_p);
+}
+
+static inline void tm_cron_insert_job(cron_job_t * job_p);
+
+static inline void tm_cron_insert_job(cron_job_t * job_p){
+    tm_cron_sched_insert_job(&tm_cron_default, job_p);
+}
+
+static inline void tm_cron_insert_chain(cron_job_t * chain_p);
+
+static inline void tm_cron_insert_chain(cron_job_t * chain_p){
+    tm_cron_sched_insert_chain(&tm_cron_default, chain_p);
+}
+
+static inline void tm_cron_cancel_job(cron_job_t * job_p);
+
+static inline void tm_cron_cancel_job(cron_job_t * job_p){
+    tm_cron_sched_cancel_job(&tm_cron_default, job_p);
+}
 
 static inline void tm_cron_replace_job(cron_job_t * job_p);
 
 static inline void tm_cron_replace_job(cron_job_t * job_p){
-    if (job_p->active){
-        tm_cron_cancel_job(job_p);
-    }
-    tm_cron_insert_job(job_p);
+    tm_cron_sched_replace_job(&tm_cron_default, job_p);
+}
+
+#if TIME_CRON_SUBMIT_QUEUE_LEN
+
+static inline uint8_t tm_cron_submit_job(cron_job_t * job_p, tm_system_t * texec_p);
+
+static inline uint8_t tm_cron_submit_job(cron_job_t * job_p, tm_system_t * texec_p){
+    return tm_cron_sched_submit_job(&tm_cron_default, job_p, texec_p);
 }
 
-void tm_cron_poll(void);
+static inline uint8_t tm_cron_submit_cancel(cron_job_t * job_p);
+
+static inline uint8_t tm_cron_submit_cancel(cron_job_t * job_p){
+    return tm_cron_sched_submit_cancel(&tm_cron_default, job_p);
+}
+
+#endif
+
+static inline uint8_t tm_cron_next_wake(tm_system_t * wake_p);
+
+static inline uint8_t tm_cron_next_wake(tm_system_t * wake_p){
+    return tm_cron_sched_next_wake(&tm_cron_default, wake_p);
+}
+
+static inline void tm_cron_poll(void);
+
+static inline void tm_cron_poll(void){
+    tm_cron_sched_poll(&tm_cron_default);
+}
+
+static inline void tm_cron_epoch_change_handler(tm_sdelta_t * offset);
+
+static inline void tm_cron_epoch_change_handler(tm_sdelta_t * offset){
+    tm_cron_sched_epoch_change_handler(&tm_cron_default, offset);
+}
 
-void tm_cron_epoch_change_handler(tm_sdelta_t * offset);
+/**@}*/ 
 
 #endif
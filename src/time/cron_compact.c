@@ -0,0 +1,307 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_compact.c
+ * @brief Compact cron scheduler implementations.
+ *
+ * Execution times are unsigned offsets from `base`, which is against the
+ * queue base of the instance. The first job in the queue has the lowest
+ * offset, so moving the base forward to it never underflows any job.
+ * The base is moved when polling, so that the first job stays within
+ * one horizon of it. Provided the instance is polled at least once per
+ * horizon, no offset then exceeds three horizons.
+ *
+ * @see cron_compact.h
+ */
+
+#include "cron_compact.h"
+
+#if TIME_CRON_ENABLE_COMPACT
+
+#define TM_CRON_COMPACT_LIMIT       (3 * TM_CRON_COMPACT_HORIZON)
+
+static void tm_cron_compact_rebase(tm_cron_compact_t * sched_p);
+
+static void tm_cron_compact_rebase(tm_cron_compact_t * sched_p){
+    uint32_t shift;
+    if (sched_p->head == TM_CRON_COMPACT_NONE ||
+            sched_p->jobs[sched_p->head].texec < TM_CRON_COMPACT_HORIZON){
+        return;
+    }
+    critical_enter();
+    shift = sched_p->jobs[sched_p->head].texec;
+    for (uint16_t i=0; i < sched_p->count; i++){
+        if (sched_p->jobs[i].flags & TM_CRON_COMPACT_FLAG_ACTIVE){
+            sched_p->jobs[i].texec -= shift;
+        }
+    }
+    sched_p->base += shift;
+    critical_exit();
+}
+
+
+static void tm_cron_compact_insert(tm_cron_compact_t * sched_p, uint16_t index);
+
+static void tm_cron_compact_insert(tm_cron_compact_t * sched_p, uint16_t index){
+    tm_cron_cjob_t * jobs = sched_p->jobs;
+    tm_cron_cjob_t * job_p = &(jobs[index]);
+    uint32_t texec = job_p->texec;
+    uint16_t walker;
+    uint16_t prev = TM_CRON_COMPACT_NONE;
+    critical_enter();
+    walker = sched_p->head;
+    // The walk can start from the last job inserted, if it is not later.
+    if (sched_p->finger != TM_CRON_COMPACT_NONE &&
+            jobs[sched_p->finger].texec <= texec){
+        prev = sched_p->finger;
+        walker = jobs[prev].next;
+    }
+    // Jobs with equal texec run in the order in which they were inserted.
+    while (walker != TM_CRON_COMPACT_NONE && jobs[walker].texec <= texec){
+        prev = walker;
+        walker = jobs[walker].next;
+    }
+    job_p->next = walker;
+    if (prev != TM_CRON_COMPACT_NONE){
+        sched_p->jobs[prev].next = index;
+    }
+    else{
+        sched_p->head = index;
+    }
+    job_p->flags |= TM_CRON_COMPACT_FLAG_ACTIVE;
+    sched_p->finger = index;
+    critical_exit();
+}
+
+
+void tm_cron_compact_init(tm_cron_compact_t * sched_p,
+                          tm_cron_cjob_t * jobs, uint16_t count){
+    sched_p->jobs = jobs;
+    sched_p->count = count;
+    sched_p->head = TM_CRON_COMPACT_NONE;
+    sched_p->finger = TM_CRON_COMPACT_NONE;
+    sched_p->base = 0;
+    sched_p->epoch_offset = 0;
+    for (uint16_t i=0; i < count; i++){
+        jobs[i].texec = 0;
+        jobs[i].period = 0;
+        jobs[i].next = TM_CRON_COMPACT_NONE;
+        jobs[i].flags = 0;
+        jobs[i].missed = 0;
+        jobs[i].handler = NULL;
+    }
+    sched_p->change_handler.next = NULL;
+    sched_p->change_handler.priority = 3;
+    sched_p->change_handler.func = NULL;
+    sched_p->change_handler.func_ctx = &tm_cron_compact_epoch_change_handler;
+    sched_p->change_handler.ctx = sched_p;
+    #if TIME_ENABLE_EPOCH_DEFER
+    sched_p->change_handler.owned = 1;
+    #endif
+    tm_register_epoch_change_handler(&(sched_p->change_handler));
+}
+
+
+uint8_t tm_cron_compact_create_job(tm_cron_compact_t * sched_p,
+                                   uint16_t index, void handler(void),
+                                   tm_system_t * texec_p, uint32_t period){
+    tm_cron_cjob_t * job_p;
+    tm_system_t current, base;
+    tm_sdelta_t now, rel;
+
+    if (index >= sched_p->count){
+        return TM_CRON_COMPACT_E_INDEX;
+    }
+    job_p = &(sched_p->jobs[index]);
+    if (period >= TM_CRON_COMPACT_HORIZON){
+        return TM_CRON_COMPACT_E_RANGE;
+    }
+
+    // The job is validated against the base it will be inserted with, 
+    // so that a job which is rejected is left as it was.
+    tm_cron_compact_follow_epoch(sched_p);
+    tm_current_time(&current);
+    tm_cron_compact_rebase(sched_p);
+    if (sched_p->head == TM_CRON_COMPACT_NONE ||
+            (sched_p->head == index && job_p->next == TM_CRON_COMPACT_NONE)){
+        base = current - sched_p->epoch_offset;
+    }
+    else{
+        base = sched_p->base;
+    }
+    now = current - sched_p->epoch_offset - base;
+    rel = *texec_p - sched_p->epoch_offset - base;
+    if (rel - now >= (tm_sdelta_t)TM_CRON_COMPACT_HORIZON ||
+            rel >= (tm_sdelta_t)TM_CRON_COMPACT_LIMIT){
+        return TM_CRON_COMPACT_E_RANGE;
+    }
+    if (rel < 0){
+        rel = 0;
+    }
+
+    tm_cron_compact_cancel_job(sched_p, index);
+    sched_p->base = base;
+    job_p->texec = (uint32_t)rel;
+    job_p->period = period;
+    job_p->flags = 0;
+    job_p->missed = 0;
+    job_p->handler = handler;
+    tm_cron_compact_insert(sched_p, index);
+    return 0;
+}
+
+
+void tm_cron_compact_cancel_job(tm_cron_compact_t * sched_p, uint16_t index){
+    tm_cron_cjob_t * job_p = &(sched_p->jobs[index]);
+    uint16_t walker;
+    uint16_t prev = TM_CRON_COMPACT_NONE;
+    // A job cancelled by its own handler is not rescheduled.
+    job_p->flags &= ~TM_CRON_COMPACT_FLAG_RUNNING;
+    if (!(job_p->flags & TM_CRON_COMPACT_FLAG_ACTIVE)){
+        return;
+    }
+    critical_enter();
+    walker = sched_p->head;
+    while (walker != index){
+        prev = walker;
+        walker = sched_p->jobs[walker].next;
+    }
+    if (prev != TM_CRON_COMPACT_NONE){
+        sched_p->jobs[prev].next = job_p->next;
+    }
+    else{
+        sched_p->head = job_p->next;
+    }
+    job_p->next = TM_CRON_COMPACT_NONE;
+    job_p->flags &= ~TM_CRON_COMPACT_FLAG_ACTIVE;
+    if (sched_p->finger == index){
+        sched_p->finger = TM_CRON_COMPACT_NONE;
+    }
+    critical_exit();
+}
+
+
+uint8_t tm_cron_compact_next_wake(tm_cron_compact_t * sched_p,
+                                  tm_system_t * wake_p){
+    if (sched_p->head == TM_CRON_COMPACT_NONE){
+        return 1;
+    }
+    tm_cron_compact_get_texec(sched_p, sched_p->head, wake_p);
+    return 0;
+}
+
+
+static void tm_cron_compact_add_missed(tm_cron_cjob_t * job_p, tm_sdelta_t count);
+
+static void tm_cron_compact_add_missed(tm_cron_cjob_t * job_p, tm_sdelta_t count){
+    if (count >= (tm_sdelta_t)(0xFF - job_p->missed)){
+        job_p->missed = 0xFF;
+    }
+    else{
+        job_p->missed += count;
+    }
+}
+
+
+static void tm_cron_compact_dispatch(tm_cron_compact_t * sched_p,
+                                     uint16_t index, tm_sdelta_t now);
+
+static void tm_cron_compact_dispatch(tm_cron_compact_t * sched_p,
+                                     uint16_t index, tm_sdelta_t now){
+    tm_cron_cjob_t * job_p = &(sched_p->jobs[index]);
+    tm_sdelta_t late = now - job_p->texec;
+    tm_sdelta_t slots = 1;
+    uint8_t policy = job_p->flags & TM_CRON_POLICY_MASK;
+    uint8_t missed;
+
+    // The job is popped before it runs, so that the handler may recreate
+    // or cancel it.
+    critical_enter();
+    sched_p->head = job_p->next;
+    job_p->next = TM_CRON_COMPACT_NONE;
+    job_p->flags &= ~TM_CRON_COMPACT_FLAG_ACTIVE;
+    job_p->flags |= TM_CRON_COMPACT_FLAG_RUNNING;
+    if (sched_p->finger == index){
+        sched_p->finger = TM_CRON_COMPACT_NONE;
+    }
+    critical_exit();
+
+    if (job_p->period && policy != TM_CRON_POLICY_CATCHUP &&
+            late >= (tm_sdelta_t)job_p->period){
+        slots = late / job_p->period + 1;
+    }
+
+    if (policy == TM_CRON_POLICY_SKIP && slots > 1){
+        tm_cron_compact_add_missed(job_p, slots);
+    }
+    else{
+        tm_cron_compact_add_missed(job_p, slots - 1);
+        missed = job_p->missed;
+        job_p->missed = 0;
+        if (job_p->handler){
+            if (job_p->flags & TM_CRON_FLAG_MISSED_ARG){
+                ((tm_cron_missed_handler_t)(job_p->handler))(missed);
+            }
+            else{
+                job_p->handler();
+            }
+        }
+    }
+
+    // Handlers which recreate or cancel the job clear the running flag.
+    if (job_p->period && (job_p->flags & TM_CRON_COMPACT_FLAG_RUNNING)){
+        job_p->texec += job_p->period * (uint32_t)slots;
+        tm_cron_compact_insert(sched_p, index);
+    }
+    job_p->flags &= ~TM_CRON_COMPACT_FLAG_RUNNING;
+}
+
+
+void tm_cron_compact_poll(tm_cron_compact_t * sched_p){
+    tm_system_t current;
+    tm_sdelta_t now;
+    uint16_t count = sched_p->count;
+
+    tm_cron_compact_follow_epoch(sched_p);
+    if (sched_p->head == TM_CRON_COMPACT_NONE){
+        return;
+    }
+    tm_cron_compact_rebase(sched_p);
+    tm_current_time(&current);
+    now = current - sched_p->epoch_offset - sched_p->base;
+
+    // Runs per poll are bounded by the size of the array, so that a
+    // CATCHUP job far behind catches up over several polls.
+    while (count-- && sched_p->head != TM_CRON_COMPACT_NONE &&
+            (tm_sdelta_t)sched_p->jobs[sched_p->head].texec <= now){
+        tm_cron_compact_dispatch(sched_p, sched_p->head, now);
+    }
+}
+
+
+void tm_cron_compact_epoch_change_handler(void * sched_p, tm_sdelta_t * offset){
+    ((tm_cron_compact_t *)sched_p)->epoch_offset += *offset;
+}
+
+#endif
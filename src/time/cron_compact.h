@@ -0,0 +1,226 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published
+ *    by the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_compact.h
+ * @brief Compact cron scheduler for large numbers of simple jobs.
+ *
+ * Applications enabling this functionality must ensure
+ * TIME_CRON_ENABLE_COMPACT is defined and non-zero, usually by defining
+ * APP_ENABLE_TIME_CRON_COMPACT in application.h.
+ *
+ * `cron_job_t` carries a 64-bit execution time, a pointer to a separately
+ * held 64-bit period, two link pointers and a handler, and takes 32 bytes
+ * per job on 32-bit targets (plus the period) before any of its optional
+ * features are enabled. The compact scheduler instead holds its jobs in
+ * an array provided by the application, and uses :
+ *
+ *   - 32-bit execution times, against a base held by the instance.
+ *   - 32-bit periods, held in the job itself.
+ *   - A single 16-bit link, which is the index of the next job.
+ *   - Packed flags and an 8-bit missed run count.
+ *
+ * A job is 16 bytes on 32-bit targets. Jobs are identified by their index
+ * in the array.
+ *
+ * Only one-shot and fixed period jobs are supported, with the catch-up
+ * policies and missed run handlers of `cron.h`. Missed run counts
+ * saturate at 0xFF. Calendar specifications, slack, statistics, the
+ * submission queue, the worker pool and persistence are not supported.
+ *
+ * Periods, and the time from the current time to the first execution of
+ * a job, must be less than TM_CRON_COMPACT_HORIZON (about 12 days). When
+ * the first job in the queue is later than this against the base, the
+ * base is moved forward to it. This touches every active job, but only
+ * happens once per horizon. Jobs created in the past are due at once.
+ *
+ * The queue is singly linked, so cancelling a job walks the queue to
+ * find its predecessor. Insertion walks the queue, as it does in
+ * `cron.c`, but starts from the job last inserted when that job is not
+ * later than the one being inserted. Periodic jobs rescheduled by a poll
+ * mostly land close to each other, so this shortens most walks. The
+ * instance follows epoch changes in O(1) through its own handler, in the
+ * same way as `tm_cron_sched_t`.
+ *
+ * @see cron_compact.c
+ */
+
+#ifndef TIME_CRON_COMPACT_H
+#define TIME_CRON_COMPACT_H
+
+#include "cron.h"
+
+#if TIME_CRON_ENABLE_COMPACT
+
+#define TM_CRON_COMPACT_NONE        0xFFFF
+#define TM_CRON_COMPACT_HORIZON     0x40000000UL
+
+#define TM_CRON_COMPACT_FLAG_ACTIVE 0x80
+#define TM_CRON_COMPACT_FLAG_RUNNING 0x40
+
+#define TM_CRON_COMPACT_E_INDEX     1
+#define TM_CRON_COMPACT_E_RANGE     2
+
+/**
+ * @brief Compact Job Type
+ *
+ * Members should be treated as read-only by the application.
+ */
+typedef struct TM_CRON_CJOB_t{
+    uint32_t texec;
+    uint32_t period;
+    uint16_t next;
+    uint8_t flags;
+    uint8_t missed;
+    void (* handler)(void);
+} tm_cron_cjob_t;
+
+/**
+ * @brief Compact Scheduler Instance Type
+ *
+ * Initialize using `tm_cron_compact_init()`. Members should be treated
+ * as read-only by the application.
+ */
+typedef struct TM_CRON_COMPACT_t{
+    tm_cron_cjob_t * jobs;
+    uint16_t count;
+    uint16_t head;
+    uint16_t finger;
+    tm_system_t base;
+    tm_sdelta_t epoch_offset;
+    tm_epochchange_handler_t change_handler;
+} tm_cron_compact_t;
+
+/**
+ * @brief Initialize a compact scheduler instance.
+ *
+ * Clears all the jobs and registers the epoch change handler of the
+ * instance. An instance should only be initialized once.
+ *
+ * @param sched_p Pointer to the instance.
+ * @param jobs Array of jobs to be used by the instance.
+ * @param count Number of jobs in the array, less than TM_CRON_COMPACT_NONE.
+ */
+void tm_cron_compact_init(tm_cron_compact_t * sched_p,
+                          tm_cron_cjob_t * jobs, uint16_t count);
+
+/**
+ * @brief Create a job, replacing the job at the index if it is active.
+ *
+ * The policy is reset to TM_CRON_POLICY_CATCHUP.
+ *
+ * @param sched_p Pointer to the instance.
+ * @param index Index of the job.
+ * @param handler The job handler function.
+ * @param texec_p Pointer to the absolute execution time of the job.
+ * @param period Period of the job in ms, or 0 for one-shot jobs.
+ * @return 0 on success, or one of the TM_CRON_COMPACT_E_ definitions.
+ */
+uint8_t tm_cron_compact_create_job(tm_cron_compact_t * sched_p,
+                                   uint16_t index, void handler(void),
+                                   tm_system_t * texec_p, uint32_t period);
+
+/**
+ * @brief Remove a job from the queue.
+ *
+ * Does nothing if the job is not active.
+ *
+ * @param sched_p Pointer to the instance.
+ * @param index Index of the job.
+ */
+void tm_cron_compact_cancel_job(tm_cron_compact_t * sched_p, uint16_t index);
+
+/**
+ * @brief Set the catch-up policy of a job. See `tm_cron_set_policy()`.
+ */
+static inline void tm_cron_compact_set_policy(tm_cron_compact_t * sched_p,
+                                              uint16_t index, uint8_t policy);
+
+static inline void tm_cron_compact_set_policy(tm_cron_compact_t * sched_p,
+                                              uint16_t index, uint8_t policy){
+    tm_cron_cjob_t * job_p = &(sched_p->jobs[index]);
+    job_p->flags = (job_p->flags & ~TM_CRON_POLICY_MASK) |
+                   (policy & TM_CRON_POLICY_MASK);
+}
+
+/**
+ * @brief Replace the handler of a job with one which is provided the
+ *        number of missed runs. See `tm_cron_set_missed_handler()`.
+ */
+static inline void tm_cron_compact_set_missed_handler(tm_cron_compact_t * sched_p,
+                                                      uint16_t index,
+                                                      tm_cron_missed_handler_t handler);
+
+static inline void tm_cron_compact_set_missed_handler(tm_cron_compact_t * sched_p,
+                                                      uint16_t index,
+                                                      tm_cron_missed_handler_t handler){
+    sched_p->jobs[index].handler = (void (*)(void))handler;
+    sched_p->jobs[index].flags |= TM_CRON_FLAG_MISSED_ARG;
+}
+
+/**
+ * @brief Apply the epoch changes posted since the instance last saw them.
+ * See `tm_cron_sched_follow_epoch()`.
+ */
+static inline void tm_cron_compact_follow_epoch(tm_cron_compact_t * sched_p);
+
+static inline void tm_cron_compact_follow_epoch(tm_cron_compact_t * sched_p){
+    #if TIME_ENABLE_EPOCH_DEFER
+    tm_epoch_change_dispatch_handler(&(sched_p->change_handler));
+    #else
+    (void)sched_p;
+    #endif
+}
+
+/**
+ * @brief Get the execution time of a job against the epoch.
+ */
+static inline void tm_cron_compact_get_texec(tm_cron_compact_t * sched_p,
+                                             uint16_t index,
+                                             tm_system_t * texec_p);
+
+static inline void tm_cron_compact_get_texec(tm_cron_compact_t * sched_p,
+                                             uint16_t index,
+                                             tm_system_t * texec_p){
+    tm_cron_compact_follow_epoch(sched_p);
+    *texec_p = sched_p->base + sched_p->jobs[index].texec +
+               sched_p->epoch_offset;
+}
+
+/**
+ * @brief Get the time at which `tm_cron_compact_poll()` next needs to be
+ *        called.
+ *
+ * @param sched_p Pointer to the instance.
+ * @param wake_p Pointer to the tm_system_t in which to store the result.
+ * @return 0 on success, 1 if there are no jobs in the queue.
+ */
+uint8_t tm_cron_compact_next_wake(tm_cron_compact_t * sched_p,
+                                  tm_system_t * wake_p);
+
+void tm_cron_compact_poll(tm_cron_compact_t * sched_p);
+
+void tm_cron_compact_epoch_change_handler(void * sched_p, tm_sdelta_t * offset);
+
+#endif
+#endif
@@ -0,0 +1,384 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_persist.c
+ * @brief Cron schedule persistence implementations.
+ *
+ * Image layout, all multi-byte fields little-endian :
+ *
+ * | Offset | Length | Content                                  |
+ * |--------|--------|------------------------------------------|
+ * | 0      | 2      | Magic, TM_CRON_PERSIST_MAGIC             |
+ * | 2      | 1      | Version, TM_CRON_PERSIST_VERSION         |
+ * | 3      | 1      | Number of entries                        |
+ * | 4      | 2      | Fletcher-16 of bytes 0-3 and the entries |
+ * | 6      | 18 * n | Entries, in queue order                  |
+ *
+ * Entry layout :
+ *
+ * | Offset | Length | Content                                  |
+ * |--------|--------|------------------------------------------|
+ * | 0      | 1      | Job ID (index into the descriptor table) |
+ * | 1      | 1      | Job flags (policy)                       |
+ * | 2      | 2      | Slack                                    |
+ * | 4      | 2      | Missed run count                         |
+ * | 6      | 4      | Period, 0 if none                        |
+ * | 10     | 8      | Execution time against the epoch         |
+ *
+ * @see cron_persist.h
+ */
+
+#include <platform/sections.h>
+#include "cron_persist.h"
+
+#if TIME_CRON_ENABLE_PERSIST
+
+#if TIME_CRON_PERSIST_LEN && defined PIO_NATIVE
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#define TM_CRON_PERSIST_MAGIC    0x5143
+
+
+static inline void tm_cron_persist_put(uint8_t * buffer, uint64_t value, uint8_t len);
+
+static inline void tm_cron_persist_put(uint8_t * buffer, uint64_t value, uint8_t len){
+    for (uint8_t i=0; i < len; i++){
+        buffer[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static inline uint64_t tm_cron_persist_get(const uint8_t * buffer, uint8_t len);
+
+static inline uint64_t tm_cron_persist_get(const uint8_t * buffer, uint8_t len){
+    uint64_t value = 0;
+    for (uint8_t i=0; i < len; i++){
+        value |= (uint64_t)buffer[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint16_t tm_cron_persist_check(const uint8_t * buffer, uint16_t len);
+
+static uint16_t tm_cron_persist_check(const uint8_t * buffer, uint16_t len){
+    uint16_t sum1 = 0, sum2 = 0;
+    for (uint16_t i=0; i < len; i++){
+        if (i == 4 || i == 5){
+            // The checksum itself.
+            continue;
+        }
+        sum1 = (sum1 + buffer[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    return (sum2 << 8) | sum1;
+}
+
+static int16_t tm_cron_persist_find(cron_job_t * job_p,
+                                    const tm_cron_persist_desc_t * table,
+                                    uint8_t count);
+
+static int16_t tm_cron_persist_find(cron_job_t * job_p,
+                                    const tm_cron_persist_desc_t * table,
+                                    uint8_t count){
+    for (uint8_t i=0; i < count; i++){
+        if (table[i].job_p == job_p){
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+uint16_t tm_cron_sched_persist_save(tm_cron_sched_t * sched_p,
+                                    uint8_t * buffer, uint16_t len,
+                                    const tm_cron_persist_desc_t * table,
+                                    uint8_t count){
+    cron_job_t * walker = sched_p->nextjob_p;
+    uint8_t * entry_p = buffer + TM_CRON_PERSIST_HEADER_LEN;
+    uint8_t entries = 0;
+    uint16_t size = TM_CRON_PERSIST_HEADER_LEN;
+    tm_sdelta_t period;
+    tm_system_t texec;
+    int16_t id;
+
+    if (len < TM_CRON_PERSIST_HEADER_LEN){
+        return 0;
+    }
+    while (walker){
+        id = tm_cron_persist_find(walker, table, count);
+        if (id < 0){
+            walker = walker->nextjob;
+            continue;
+        }
+        size += TM_CRON_PERSIST_ENTRY_LEN;
+        if (size > len){
+            return 0;
+        }
+        period = walker->tafter_p ? *(walker->tafter_p) : 0;
+        if (period < 0 || period > (tm_sdelta_t)UINT32_MAX){
+            return 0;
+        }
+        tm_cron_sched_get_texec(sched_p, walker, &texec);
+        entry_p[0] = (uint8_t)id;
+        #if TIME_CRON_ENABLE_POLICIES
+        entry_p[1] = walker->flags;
+        tm_cron_persist_put(&entry_p[4], walker->missed, 2);
+        #else
+        entry_p[1] = 0;
+        tm_cron_persist_put(&entry_p[4], 0, 2);
+        #endif
+        tm_cron_persist_put(&entry_p[2], tm_cron_job_slack(walker), 2);
+        tm_cron_persist_put(&entry_p[6], (uint64_t)period, 4);
+        tm_cron_persist_put(&entry_p[10], (uint64_t)texec, 8);
+        entry_p += TM_CRON_PERSIST_ENTRY_LEN;
+        entries ++;
+        walker = walker->nextjob;
+    }
+    tm_cron_persist_put(&buffer[0], TM_CRON_PERSIST_MAGIC, 2);
+    buffer[2] = TM_CRON_PERSIST_VERSION;
+    buffer[3] = entries;
+    tm_cron_persist_put(&buffer[4], tm_cron_persist_check(buffer, size), 2);
+    return size;
+}
+
+
+static uint8_t tm_cron_persist_validate(const uint8_t * buffer, uint16_t len,
+                                        const tm_cron_persist_desc_t * table,
+                                        uint8_t count);
+
+static uint8_t tm_cron_persist_validate(const uint8_t * buffer, uint16_t len,
+                                        const tm_cron_persist_desc_t * table,
+                                        uint8_t count){
+    const uint8_t * entry_p = buffer + TM_CRON_PERSIST_HEADER_LEN;
+    uint8_t entries;
+    uint16_t size;
+    tm_system_t texec, last = 0;
+
+    if (len < TM_CRON_PERSIST_HEADER_LEN ||
+            tm_cron_persist_get(&buffer[0], 2) != TM_CRON_PERSIST_MAGIC ||
+            buffer[2] != TM_CRON_PERSIST_VERSION){
+        return TM_CRON_PERSIST_E_FORMAT;
+    }
+    entries = buffer[3];
+    size = TM_CRON_PERSIST_SIZE(entries);
+    if (size > len){
+        return TM_CRON_PERSIST_E_FORMAT;
+    }
+    if (tm_cron_persist_get(&buffer[4], 2) != tm_cron_persist_check(buffer, size)){
+        return TM_CRON_PERSIST_E_CHECK;
+    }
+    for (uint8_t i=0; i < entries; i++, entry_p += TM_CRON_PERSIST_ENTRY_LEN){
+        if (entry_p[0] >= count){
+            return TM_CRON_PERSIST_E_ID;
+        }
+        for (uint8_t j=0; j < i; j++){
+            if (buffer[TM_CRON_PERSIST_SIZE(j)] == entry_p[0]){
+                return TM_CRON_PERSIST_E_ID;
+            }
+        }
+        if (table[entry_p[0]].job_p->active){
+            return TM_CRON_PERSIST_E_ACTIVE;
+        }
+        texec = (tm_system_t)tm_cron_persist_get(&entry_p[10], 8);
+        if (i && texec < last){
+            return TM_CRON_PERSIST_E_ORDER;
+        }
+        last = texec;
+    }
+    return 0;
+}
+
+
+uint8_t tm_cron_sched_persist_restore(tm_cron_sched_t * sched_p,
+                                      const uint8_t * buffer, uint16_t len,
+                                      const tm_cron_persist_desc_t * table,
+                                      uint8_t count){
+    const uint8_t * entry_p = buffer + TM_CRON_PERSIST_HEADER_LEN;
+    const tm_cron_persist_desc_t * desc_p;
+    cron_job_t * chain_p = NULL;
+    cron_job_t * tail_p = NULL;
+    cron_job_t * job_p;
+    uint8_t rval;
+    #if TIME_CRON_ENABLE_GROUPS
+    uint8_t group;
+    #endif
+    #if TIME_CRON_ENABLE_EDF
+    uint8_t prio;
+    uint16_t deadline;
+    #endif
+    #if TIME_CRON_ENABLE_BLACKOUT
+    const tm_interval_set_t * blackout_p;
+    #endif
+    #if TIME_CRON_ENABLE_STATS
+    struct TM_CRON_STATS_t * stats_p;
+    #endif
+
+    rval = tm_cron_persist_validate(buffer, len, table, count);
+    if (rval){
+        return rval;
+    }
+    tm_cron_sched_follow_epoch(sched_p);
+    for (uint8_t i=0; i < buffer[3]; i++, entry_p += TM_CRON_PERSIST_ENTRY_LEN){
+        desc_p = &table[entry_p[0]];
+        job_p = desc_p->job_p;
+        // Jobs are prepared as the creation functions would. Statistics 
+        // containers, groups, priority classes, deadlines and blackout 
+        // windows set before the restore are retained.
+        #if TIME_CRON_ENABLE_GROUPS
+        group = job_p->group;
+        #endif
+        #if TIME_CRON_ENABLE_EDF
+        prio = job_p->prio;
+        deadline = job_p->deadline;
+        #endif
+        #if TIME_CRON_ENABLE_BLACKOUT
+        blackout_p = job_p->blackout_p;
+        #endif
+        #if TIME_CRON_ENABLE_STATS
+        stats_p = job_p->stats_p;
+        #endif
+        tm_cron_sched_setup_job(sched_p, job_p, desc_p->handler, 
+                                desc_p->tafter_p);
+        #if TIME_CRON_ENABLE_GROUPS
+        job_p->group = group;
+        #endif
+        #if TIME_CRON_ENABLE_EDF
+        job_p->prio = prio;
+        job_p->deadline = deadline;
+        #endif
+        #if TIME_CRON_ENABLE_BLACKOUT
+        job_p->blackout_p = blackout_p;
+        #endif
+        #if TIME_CRON_ENABLE_STATS
+        job_p->stats_p = stats_p;
+        #endif
+        #if TIME_CRON_ENABLE_SPEC
+        job_p->spec_p = desc_p->spec_p;
+        #endif
+        #if TIME_CRON_ENABLE_POLICIES
+        job_p->flags = entry_p[1];
+        job_p->missed = (uint16_t)tm_cron_persist_get(&entry_p[4], 2);
+        #endif
+        #if TIME_CRON_ENABLE_SLACK
+        job_p->slack = (uint16_t)tm_cron_persist_get(&entry_p[2], 2);
+        #endif
+        if (job_p->tafter_p){
+            *(job_p->tafter_p) = (tm_sdelta_t)tm_cron_persist_get(&entry_p[6], 4);
+        }
+        job_p->texec = (tm_system_t)tm_cron_persist_get(&entry_p[10], 8) -
+                       sched_p->epoch_offset;
+        job_p->nextjob = NULL;
+        if (tail_p){
+            tail_p->nextjob = job_p;
+        }
+        else{
+            chain_p = job_p;
+        }
+        tail_p = job_p;
+    }
+    tm_cron_sched_insert_chain(sched_p, chain_p);
+    return 0;
+}
+
+
+#if TIME_CRON_PERSIST_LEN
+
+#if TIME_CRON_PERSIST_LEN < TM_CRON_PERSIST_HEADER_LEN || TIME_CRON_PERSIST_LEN > 0xFFFF
+#error "Cron persistence store length is out of range."
+#endif
+
+static uint8_t * tm_cron_persist_store(void);
+
+#ifdef PIO_NATIVE
+
+static uint8_t * tm_cron_persist_map = NULL;
+
+static uint8_t * tm_cron_persist_store(void){
+    int fd;
+    void * map;
+    if (tm_cron_persist_map){
+        return tm_cron_persist_map;
+    }
+    fd = open(TIME_CRON_PERSIST_FILE, O_RDWR | O_CREAT, 0644);
+    if (fd < 0){
+        return NULL;
+    }
+    if (ftruncate(fd, TIME_CRON_PERSIST_LEN)){
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, TIME_CRON_PERSIST_LEN, PROT_READ | PROT_WRITE,
+               MAP_SHARED, fd, 0);
+    // The mapping remains valid after the descriptor is closed.
+    close(fd);
+    if (map == MAP_FAILED){
+        return NULL;
+    }
+    tm_cron_persist_map = (uint8_t *)map;
+    return tm_cron_persist_map;
+}
+
+#else
+
+static uint8_t tm_cron_persist_ram[TIME_CRON_PERSIST_LEN] NOINIT;
+
+static uint8_t * tm_cron_persist_store(void){
+    return tm_cron_persist_ram;
+}
+
+#endif
+
+
+uint8_t tm_cron_persist_checkpoint(const tm_cron_persist_desc_t * table,
+                                   uint8_t count){
+    uint8_t * store = tm_cron_persist_store();
+    if (!store ||
+            !tm_cron_persist_save(store, TIME_CRON_PERSIST_LEN, table, count)){
+        return TM_CRON_PERSIST_E_STORE;
+    }
+    return 0;
+}
+
+
+uint8_t tm_cron_persist_recover(const tm_cron_persist_desc_t * table,
+                                uint8_t count){
+    uint8_t * store = tm_cron_persist_store();
+    if (!store){
+        return TM_CRON_PERSIST_E_STORE;
+    }
+    return tm_cron_persist_restore(store, TIME_CRON_PERSIST_LEN, table, count);
+}
+
+
+void tm_cron_persist_discard(void){
+    uint8_t * store = tm_cron_persist_store();
+    if (store){
+        memset(store, 0, TM_CRON_PERSIST_HEADER_LEN);
+    }
+}
+
+#endif
+#endif
@@ -0,0 +1,195 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published
+ *    by the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_persist.h
+ * @brief Cron schedule persistence across warm restarts.
+ *
+ * Applications enabling this functionality must ensure
+ * TIME_CRON_ENABLE_PERSIST is defined and non-zero, usually by defining
+ * APP_ENABLE_TIME_CRON_PERSIST in application.h.
+ *
+ * Jobs which should survive a restart are described by a constant table
+ * of `tm_cron_persist_desc_t`, provided by the application. The index of
+ * a job in this table is its ID. Only the state which changes at runtime
+ * is saved : the ID, the execution time (against the epoch), the period,
+ * the slack, the policy and the missed run count. The job handler and
+ * the cron spec, if any, are taken from the table at restore. Fields of 
+ * job features which are not enabled are saved as 0, and are ignored at 
+ * restore, so the image format does not depend on the configuration.
+ *
+ * The image is a little-endian byte stream, and can be written to any
+ * byte buffer regardless of alignment. It carries a checksum, so that
+ * an image left in uninitialized memory after a cold start is rejected.
+ * Jobs are saved in queue order, which allows the restore to merge them
+ * into the queue with a single walk.
+ *
+ * Execution times are saved against the epoch. The epoch should be
+ * re-established before the schedule is restored.
+ *
+ * The group, priority class and deadline of a job, and its statistics 
+ * container and blackout windows, are not saved. They are configuration 
+ * rather than state, and the container and windows are pointers, which 
+ * need not be valid across a restart. They are retained from the job as 
+ * it is before the restore. After a cold start, they should be set 
+ * before the schedule is restored, as the application would set them 
+ * after creating the job. Restored jobs due inside a blackout window 
+ * are deferred when they are polled.
+ *
+ * If TIME_CRON_PERSIST_LEN is non-zero, the library additionally provides
+ * a backing store of that many bytes, used by `tm_cron_persist_checkpoint()`
+ * and `tm_cron_persist_recover()`. On hardware, this is a buffer in the
+ * NOINIT section. On native builds, it is a memory-mapped file named by
+ * TIME_CRON_PERSIST_FILE.
+ *
+ * @see cron_persist.c
+ */
+
+#ifndef TIME_CRON_PERSIST_H
+#define TIME_CRON_PERSIST_H
+
+#include "cron.h"
+
+#if TIME_CRON_ENABLE_PERSIST
+
+#define TM_CRON_PERSIST_VERSION         1
+#define TM_CRON_PERSIST_HEADER_LEN      6
+#define TM_CRON_PERSIST_ENTRY_LEN       18
+
+/** Size of the image of n jobs, in bytes. */
+#define TM_CRON_PERSIST_SIZE(n)  \
+    (TM_CRON_PERSIST_HEADER_LEN + (n) * TM_CRON_PERSIST_ENTRY_LEN)
+
+#define TM_CRON_PERSIST_E_FORMAT        1
+#define TM_CRON_PERSIST_E_CHECK         2
+#define TM_CRON_PERSIST_E_ID            3
+#define TM_CRON_PERSIST_E_ORDER         4
+#define TM_CRON_PERSIST_E_ACTIVE        5
+#define TM_CRON_PERSIST_E_STORE         6
+
+/**
+ * @brief Persistent Job Descriptor Type
+ *
+ * Describes a job which can be restored. Handlers expecting the missed
+ * run count (see `tm_cron_set_missed_handler()`) should be cast to
+ * `void (*)(void)`. The period and spec pointers are as they would be
+ * provided to the job creation functions, and may be NULL.
+ */
+typedef struct TM_CRON_PERSIST_DESC_t{
+    cron_job_t * job_p;
+    void (* handler)(void);
+    tm_sdelta_t * tafter_p;
+    const tm_cron_spec_t * spec_p;
+} tm_cron_persist_desc_t;
+
+/**
+ * @brief Save the active jobs described by a table to a buffer.
+ *
+ * Active jobs not found in the table are not saved.
+ *
+ * @param sched_p Pointer to the scheduler instance.
+ * @param buffer Pointer to the buffer.
+ * @param len Length of the buffer.
+ * @param table Pointer to the job descriptor table.
+ * @param count Number of entries in the table.
+ * @return Length of the image, or 0 if it did not fit in the buffer or a
+ *         job period could not be represented.
+ */
+uint16_t tm_cron_sched_persist_save(tm_cron_sched_t * sched_p,
+                                    uint8_t * buffer, uint16_t len,
+                                    const tm_cron_persist_desc_t * table,
+                                    uint8_t count);
+
+/**
+ * @brief Restore the jobs contained in an image.
+ *
+ * The image is validated completely before any job is touched, so a
+ * failed restore leaves the queue unchanged. Restored jobs are prepared
+ * from the table and merged into the queue in a single pass. Jobs which
+ * are already in the queue are left in place. Restored jobs whose
+ * execution times have passed are handled by the next poll according
+ * to their policy. The image need not have been saved from the same
+ * scheduler instance.
+ *
+ * @param sched_p Pointer to the scheduler instance.
+ * @param buffer Pointer to the image.
+ * @param len Length of the buffer containing the image.
+ * @param table Pointer to the job descriptor table.
+ * @param count Number of entries in the table.
+ * @return 0 on success, or one of the TM_CRON_PERSIST_E_ definitions.
+ */
+uint8_t tm_cron_sched_persist_restore(tm_cron_sched_t * sched_p,
+                                      const uint8_t * buffer, uint16_t len,
+                                      const tm_cron_persist_desc_t * table,
+                                      uint8_t count);
+
+static inline uint16_t tm_cron_persist_save(uint8_t * buffer, uint16_t len,
+                                            const tm_cron_persist_desc_t * table,
+                                            uint8_t count);
+
+static inline uint16_t tm_cron_persist_save(uint8_t * buffer, uint16_t len,
+                                            const tm_cron_persist_desc_t * table,
+                                            uint8_t count){
+    return tm_cron_sched_persist_save(&tm_cron_default, buffer, len,
+                                      table, count);
+}
+
+static inline uint8_t tm_cron_persist_restore(const uint8_t * buffer, uint16_t len,
+                                              const tm_cron_persist_desc_t * table,
+                                              uint8_t count);
+
+static inline uint8_t tm_cron_persist_restore(const uint8_t * buffer, uint16_t len,
+                                              const tm_cron_persist_desc_t * table,
+                                              uint8_t count){
+    return tm_cron_sched_persist_restore(&tm_cron_default, buffer, len,
+                                         table, count);
+}
+
+#if TIME_CRON_PERSIST_LEN
+
+/**
+ * @brief Save the schedule of the default instance to the library
+ *        backing store.
+ *
+ * @return 0 on success, or one of the TM_CRON_PERSIST_E_ definitions.
+ */
+uint8_t tm_cron_persist_checkpoint(const tm_cron_persist_desc_t * table,
+                                   uint8_t count);
+
+/**
+ * @brief Restore the schedule of the default instance from the library
+ *        backing store.
+ *
+ * @return 0 on success, or one of the TM_CRON_PERSIST_E_ definitions.
+ */
+uint8_t tm_cron_persist_recover(const tm_cron_persist_desc_t * table,
+                                uint8_t count);
+
+/**
+ * @brief Invalidate the image in the library backing store.
+ */
+void tm_cron_persist_discard(void);
+
+#endif
+#endif
+#endif
@@ -0,0 +1,329 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_pool.c
+ * @brief Parallel cron job dispatch implementations.
+ *
+ * The pool lock protects the run accounting of jobs (`pending`, 
+ * `pool_state`, `tdue` and `missed`), and the pool counters. The 
+ * statistics are shared with other instances, and have their own lock. `pending` counts the runs of a job which are queued or 
+ * executing, including the current one. A job is only pushed to a deque 
+ * when it is neither queued nor running, so that a single worker owns 
+ * all of its runs at a time. Each deque has
+ * its own lock. `queued` counts runs which are in a deque and have not
+ * yet been claimed by a worker. A worker claims a run by decrementing it
+ * under the pool lock, after which a run is guaranteed to be available
+ * in one of the deques.
+ *
+ * @see cron_pool.h
+ */
+
+#include <sched.h>
+#include "cron_pool.h"
+#include "cron_stats.h"
+
+#if TIME_CRON_ENABLE_POOL
+
+static void tm_cron_pool_execute(tm_cron_pool_t * pool_p, cron_job_t * job_p);
+
+static void tm_cron_pool_execute(tm_cron_pool_t * pool_p, cron_job_t * job_p){
+    uint16_t missed;
+    uint8_t more;
+    tm_system_t tdue, start, done;
+
+    do{
+        pthread_mutex_lock(&(pool_p->lock));
+        job_p->pool_state &= ~TM_CRON_POOL_QUEUED;
+        if (!job_p->pending){
+            // The runs were dropped when the job was re-created or 
+            // cleared, and nothing has come due since.
+            pthread_mutex_unlock(&(pool_p->lock));
+            return;
+        }
+        job_p->pool_state |= TM_CRON_POOL_RUNNING;
+        missed = job_p->missed;
+        job_p->missed = 0;
+        tdue = job_p->tdue;
+        pthread_mutex_unlock(&(pool_p->lock));
+
+        tm_current_time(&start);
+        if (job_p->handler){
+            if (job_p->flags & TM_CRON_FLAG_MISSED_ARG){
+                ((tm_cron_missed_handler_t)(job_p->handler))(missed);
+            }
+            else{
+                job_p->handler();
+            }
+        }
+        tm_current_time(&done);
+        #if TIME_CRON_ENABLE_STATS
+        tm_cron_stats_record(job_p, start - tdue, done - start);
+        #endif
+
+        pthread_mutex_lock(&(pool_p->lock));
+        pool_p->runs ++;
+        if (job_p->pending){
+            job_p->pending --;
+        }
+        if (job_p->pool_state & TM_CRON_POOL_RELEASED){
+            // The next run, if any, is the first of the re-created job, 
+            // and its tdue was set when it was dispatched.
+            job_p->pool_state &= ~TM_CRON_POOL_RELEASED;
+        }
+        else if (job_p->pending && tm_cron_job_periodic(job_p)){
+            // Pending runs of CATCHUP jobs are for consecutive slots.
+            job_p->tdue += *(job_p->tafter_p);
+        }
+        more = (job_p->pending != 0);
+        if (!more){
+            job_p->pool_state &= ~TM_CRON_POOL_RUNNING;
+        }
+        pthread_mutex_unlock(&(pool_p->lock));
+    } while (more);
+}
+
+
+static uint8_t tm_cron_pool_push(tm_cron_pool_t * pool_p, cron_job_t * job_p);
+
+static uint8_t tm_cron_pool_push(tm_cron_pool_t * pool_p, cron_job_t * job_p){
+    tm_cron_pool_deque_t * deque_p;
+    unsigned int index;
+    for (uint8_t i=0; i < pool_p->workers; i++){
+        index = (pool_p->next + i) % pool_p->workers;
+        deque_p = &(pool_p->deques[index]);
+        pthread_mutex_lock(&(deque_p->lock));
+        if (deque_p->count < TIME_CRON_POOL_DEQUE_LEN){
+            deque_p->runs[(deque_p->head + deque_p->count) % TIME_CRON_POOL_DEQUE_LEN] = job_p;
+            deque_p->count ++;
+            pthread_mutex_unlock(&(deque_p->lock));
+            pool_p->next = (index + 1) % pool_p->workers;
+            pthread_mutex_lock(&(pool_p->lock));
+            pool_p->queued ++;
+            pthread_cond_signal(&(pool_p->work_cv));
+            pthread_mutex_unlock(&(pool_p->lock));
+            return 0;
+        }
+        pthread_mutex_unlock(&(deque_p->lock));
+    }
+    return 1;
+}
+
+
+static cron_job_t * tm_cron_pool_take(tm_cron_pool_t * pool_p, uint8_t self);
+
+static cron_job_t * tm_cron_pool_take(tm_cron_pool_t * pool_p, uint8_t self){
+    tm_cron_pool_deque_t * deque_p = &(pool_p->deques[self]);
+    cron_job_t * job_p = NULL;
+
+    // Own deque, from the front.
+    pthread_mutex_lock(&(deque_p->lock));
+    if (deque_p->count){
+        job_p = deque_p->runs[deque_p->head];
+        deque_p->head = (deque_p->head + 1) % TIME_CRON_POOL_DEQUE_LEN;
+        deque_p->count --;
+    }
+    pthread_mutex_unlock(&(deque_p->lock));
+    if (job_p){
+        return job_p;
+    }
+
+    // Steal from the back of the others.
+    for (uint8_t i=1; i < pool_p->workers; i++){
+        deque_p = &(pool_p->deques[(self + i) % pool_p->workers]);
+        pthread_mutex_lock(&(deque_p->lock));
+        if (deque_p->count){
+            deque_p->count --;
+            job_p = deque_p->runs[(deque_p->head + deque_p->count) % TIME_CRON_POOL_DEQUE_LEN];
+        }
+        pthread_mutex_unlock(&(deque_p->lock));
+        if (job_p){
+            __atomic_fetch_add(&(pool_p->steals), 1, __ATOMIC_RELAXED);
+            return job_p;
+        }
+    }
+    return NULL;
+}
+
+
+static void * tm_cron_pool_worker(void * arg);
+
+static void * tm_cron_pool_worker(void * arg){
+    tm_cron_pool_deque_t * own_p = (tm_cron_pool_deque_t *)arg;
+    tm_cron_pool_t * pool_p = own_p->pool_p;
+    uint8_t self = (uint8_t)(own_p - pool_p->deques);
+    cron_job_t * job_p;
+
+    pthread_mutex_lock(&(pool_p->lock));
+    while (1){
+        while (!pool_p->queued && !pool_p->stop){
+            pthread_cond_wait(&(pool_p->work_cv), &(pool_p->lock));
+        }
+        if (!pool_p->queued){
+            break;
+        }
+        pool_p->queued --;
+        pool_p->busy ++;
+        pthread_mutex_unlock(&(pool_p->lock));
+
+        // The claimed run may still be in flight between the deque and
+        // another worker which is scanning it.
+        while (!(job_p = tm_cron_pool_take(pool_p, self))){
+            sched_yield();
+        }
+        tm_cron_pool_execute(pool_p, job_p);
+
+        pthread_mutex_lock(&(pool_p->lock));
+        pool_p->busy --;
+        if (!pool_p->queued && !pool_p->busy){
+            pthread_cond_broadcast(&(pool_p->idle_cv));
+        }
+    }
+    pthread_mutex_unlock(&(pool_p->lock));
+    return NULL;
+}
+
+
+uint8_t tm_cron_pool_start(tm_cron_pool_t * pool_p, uint8_t workers){
+    if (!workers || workers > TIME_CRON_POOL_MAX_WORKERS){
+        return 1;
+    }
+    pool_p->workers = 0;
+    pool_p->stop = 0;
+    pool_p->next = 0;
+    pool_p->queued = 0;
+    pool_p->busy = 0;
+    pool_p->runs = 0;
+    pool_p->steals = 0;
+    pool_p->inline_runs = 0;
+    pthread_mutex_init(&(pool_p->lock), NULL);
+    pthread_cond_init(&(pool_p->work_cv), NULL);
+    pthread_cond_init(&(pool_p->idle_cv), NULL);
+    for (uint8_t i=0; i < workers; i++){
+        pthread_mutex_init(&(pool_p->deques[i].lock), NULL);
+        pool_p->deques[i].pool_p = pool_p;
+        pool_p->deques[i].head = 0;
+        pool_p->deques[i].count = 0;
+    }
+    // Workers only look at deques below pool_p->workers, so it is only
+    // set once all of them exist.
+    for (uint8_t i=0; i < workers; i++){
+        if (pthread_create(&(pool_p->threads[i]), NULL,
+                           &tm_cron_pool_worker, &(pool_p->deques[i]))){
+            pool_p->workers = i;
+            tm_cron_pool_stop(pool_p);
+            return 1;
+        }
+    }
+    pthread_mutex_lock(&(pool_p->lock));
+    pool_p->workers = workers;
+    pthread_mutex_unlock(&(pool_p->lock));
+    return 0;
+}
+
+
+void tm_cron_pool_wait(tm_cron_pool_t * pool_p){
+    pthread_mutex_lock(&(pool_p->lock));
+    while (pool_p->queued || pool_p->busy){
+        pthread_cond_wait(&(pool_p->idle_cv), &(pool_p->lock));
+    }
+    pthread_mutex_unlock(&(pool_p->lock));
+}
+
+
+void tm_cron_pool_stop(tm_cron_pool_t * pool_p){
+    uint8_t workers;
+    tm_cron_pool_wait(pool_p);
+    pthread_mutex_lock(&(pool_p->lock));
+    pool_p->stop = 1;
+    workers = pool_p->workers;
+    pthread_cond_broadcast(&(pool_p->work_cv));
+    pthread_mutex_unlock(&(pool_p->lock));
+    for (uint8_t i=0; i < workers; i++){
+        pthread_join(pool_p->threads[i], NULL);
+    }
+    pool_p->workers = 0;
+}
+
+
+void tm_cron_pool_release(tm_cron_pool_t * pool_p, cron_job_t * job_p){
+    pthread_mutex_lock(&(pool_p->lock));
+    if (job_p->pool_state & TM_CRON_POOL_RUNNING){
+        // The executing run stays accounted for until it returns, so 
+        // that the worker keeps ownership of the job.
+        job_p->pending = 1;
+        job_p->pool_state |= TM_CRON_POOL_RELEASED;
+    }
+    else{
+        job_p->pending = 0;
+    }
+    pthread_mutex_unlock(&(pool_p->lock));
+}
+
+
+void tm_cron_pool_dispatch(tm_cron_pool_t * pool_p, cron_job_t * job_p,
+                           tm_system_t tdue, tm_sdelta_t slots,
+                           uint8_t policy){
+    pthread_mutex_lock(&(pool_p->lock));
+    if (policy == TM_CRON_POLICY_SKIP && slots > 1){
+        tm_cron_add_missed(job_p, slots);
+        pthread_mutex_unlock(&(pool_p->lock));
+        return;
+    }
+    tm_cron_add_missed(job_p, slots - 1);
+    if (job_p->pending == 1 && (job_p->pool_state & TM_CRON_POOL_RELEASED)){
+        // The first run of a job re-created while its previous run is 
+        // executing follows it on the same worker.
+        job_p->pending = 2;
+        job_p->tdue = tdue;
+        pthread_mutex_unlock(&(pool_p->lock));
+        return;
+    }
+    if (job_p->pending){
+        if (policy == TM_CRON_POLICY_CATCHUP && job_p->pending < 0xFFFF){
+            job_p->pending ++;
+        }
+        else{
+            tm_cron_add_missed(job_p, 1);
+        }
+        pthread_mutex_unlock(&(pool_p->lock));
+        return;
+    }
+    job_p->pending = 1;
+    job_p->tdue = tdue;
+    if (job_p->pool_state & TM_CRON_POOL_QUEUED){
+        // A deque entry left over from before the job was re-created 
+        // picks this run up.
+        pthread_mutex_unlock(&(pool_p->lock));
+        return;
+    }
+    job_p->pool_state |= TM_CRON_POOL_QUEUED;
+    pthread_mutex_unlock(&(pool_p->lock));
+
+    if (tm_cron_pool_push(pool_p, job_p)){
+        pool_p->inline_runs ++;
+        tm_cron_pool_execute(pool_p, job_p);
+    }
+}
+
+#endif
@@ -0,0 +1,191 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published
+ *    by the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_pool.h
+ * @brief Parallel cron job dispatch for hosted builds.
+ *
+ * Applications enabling this functionality must ensure
+ * TIME_CRON_ENABLE_POOL is defined and non-zero, usually by defining
+ * APP_ENABLE_TIME_CRON_POOL in application.h. It is only available on
+ * native (hosted) builds, and uses POSIX threads.
+ *
+ * When a pool is attached to a scheduler instance, `tm_cron_sched_poll()`
+ * still pops due jobs and reschedules them, but hands the handler runs
+ * to the worker threads of the pool instead of running them inline.
+ * Each worker has its own deque of runs. Runs are distributed across
+ * the deques round robin. Workers take runs from the front of their own
+ * deque, and idle workers steal from the back of the others.
+ *
+ * A job never runs concurrently with itself. Each job has at most one 
+ * deque entry or executing worker at a time. A job which comes due while 
+ * a previous run is queued or executing gets no second run of its own.
+ * Instead :
+ *
+ *   - CATCHUP  : The run is counted as pending, and is executed by the
+ *                same worker, back to back, once the current run returns.
+ *   - COALESCE : The run is merged into the queued or executing run, and
+ *                is reported as missed.
+ *   - SKIP     : As with COALESCE.
+ *
+ * Handlers therefore need not be reentrant, but handlers of different
+ * jobs may run concurrently with each other and with the polling thread,
+ * and must synchronize any state they share. The pool does not protect
+ * the job queue itself. Jobs must still only be created, cancelled or
+ * replaced from the polling thread (or through the submission queue).
+ *
+ * If all deques are full, the run is executed inline by the polling
+ * thread, and counted in `inline_runs`.
+ *
+ * @see cron_pool.c
+ */
+
+#ifndef TIME_CRON_POOL_H
+#define TIME_CRON_POOL_H
+
+#include "cron.h"
+
+#if TIME_CRON_ENABLE_POOL
+
+#include <pthread.h>
+
+/**
+ * @name Job Pool States
+ * 
+ * Held in the `pool_state` of a job, under the pool lock.
+ * 
+ *  - QUEUED   : The job has an entry in one of the deques.
+ *  - RUNNING  : A worker is executing the runs of the job.
+ *  - RELEASED : The job was re-created or cleared while running, and 
+ *               the run being executed belongs to the previous job.
+ */
+/**@{*/ 
+
+#define TM_CRON_POOL_QUEUED         0x01
+#define TM_CRON_POOL_RUNNING        0x02
+#define TM_CRON_POOL_RELEASED       0x04
+
+/**@}*/ 
+
+typedef struct TM_CRON_POOL_DEQUE_t{
+    struct TM_CRON_POOL_t * pool_p;
+    pthread_mutex_t lock;
+    cron_job_t * runs[TIME_CRON_POOL_DEQUE_LEN];
+    unsigned int head;
+    unsigned int count;
+} tm_cron_pool_deque_t;
+
+/**
+ * @brief Worker Pool Type
+ *
+ * Start using `tm_cron_pool_start()`. Members should be treated as
+ * read-only by the application.
+ */
+typedef struct TM_CRON_POOL_t{
+    pthread_t threads[TIME_CRON_POOL_MAX_WORKERS];
+    tm_cron_pool_deque_t deques[TIME_CRON_POOL_MAX_WORKERS];
+    uint8_t workers;
+    uint8_t stop;
+    unsigned int next;
+    unsigned int queued;
+    unsigned int busy;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cv;
+    pthread_cond_t idle_cv;
+    uint32_t runs;
+    uint32_t steals;
+    uint32_t inline_runs;
+} tm_cron_pool_t;
+
+/**
+ * @brief Start the worker threads of a pool.
+ *
+ * @param pool_p Pointer to the pool.
+ * @param workers Number of worker threads, up to TIME_CRON_POOL_MAX_WORKERS.
+ * @return 0 on success, 1 if the workers could not be started.
+ */
+uint8_t tm_cron_pool_start(tm_cron_pool_t * pool_p, uint8_t workers);
+
+/**
+ * @brief Wait for all queued runs to complete and stop the workers.
+ *
+ * The pool must first be detached from any scheduler instances.
+ *
+ * @param pool_p Pointer to the pool.
+ */
+void tm_cron_pool_stop(tm_cron_pool_t * pool_p);
+
+/**
+ * @brief Wait until no runs are queued or executing.
+ *
+ * @param pool_p Pointer to the pool.
+ */
+void tm_cron_pool_wait(tm_cron_pool_t * pool_p);
+
+/**
+ * @brief Drop the pending runs of a job. Used internally by the scheduler
+ * when a job is re-created or cleared.
+ *
+ * A run which is already executing completes, but is not followed by 
+ * any runs which were pending behind it. The first run of the 
+ * re-created job which comes due before the executing run returns is 
+ * executed by the same worker once it does, regardless of the policy 
+ * of the job. A deque entry of the job which has not yet been taken is 
+ * kept, and is used by the next run of the re-created job.
+ *
+ * @param pool_p Pointer to the pool.
+ * @param job_p Pointer to the job.
+ */
+void tm_cron_pool_release(tm_cron_pool_t * pool_p, cron_job_t * job_p);
+
+/**
+ * @brief Hand a due job to the pool. Used internally by the scheduler.
+ *
+ * @param pool_p Pointer to the pool.
+ * @param job_p Pointer to the due job.
+ * @param tdue Execution time of the job against the epoch.
+ * @param slots Number of slots of the job handled by this dispatch.
+ * @param policy Catch-up policy of the job.
+ */
+void tm_cron_pool_dispatch(tm_cron_pool_t * pool_p, cron_job_t * job_p,
+                           tm_system_t tdue, tm_sdelta_t slots,
+                           uint8_t policy);
+
+/**
+ * @brief Attach a pool to a scheduler instance, or detach it with NULL.
+ *
+ * Several instances may share a pool.
+ *
+ * @param sched_p Pointer to the scheduler instance.
+ * @param pool_p Pointer to the (started) pool, or NULL.
+ */
+static inline void tm_cron_sched_attach_pool(tm_cron_sched_t * sched_p,
+                                             tm_cron_pool_t * pool_p);
+
+static inline void tm_cron_sched_attach_pool(tm_cron_sched_t * sched_p,
+                                             tm_cron_pool_t * pool_p){
+    sched_p->pool_p = pool_p;
+}
+
+#endif
+#endif
@@ -0,0 +1,316 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_spec.c
+ * @brief Calendar (crontab-style) schedule specification implementations.
+ *
+ * The next fire calculation keeps a calendar cursor and steps it forward
+ * one field at a time. A field which does not match either jumps directly
+ * to the next matching value of that field (hours and minutes), or rolls
+ * the cursor over to the start of the next day or month. The day of week
+ * is calculated once for the starting date and then tracked along with
+ * the date, so the only expensive operations are the two conversions
+ * between system and real time at either end.
+ *
+ * @see cron_spec.h
+ */
+
+#include "cron_spec.h"
+
+#define TM_CRON_SPEC_SEARCH_YEARS    8
+
+typedef struct TM_CRON_CURSOR_t{
+    uint16_t year;
+    uint8_t month;
+    uint8_t date;
+    uint8_t hours;
+    uint8_t minutes;
+    uint8_t dow;
+    uint8_t dim;
+} tm_cron_cursor_t;
+
+static const uint8_t tm_cron_spec_dim[] =
+    {0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+static uint8_t tm_cron_spec_days_in_month(uint16_t year, uint8_t month);
+
+static uint8_t tm_cron_spec_days_in_month(uint16_t year, uint8_t month){
+    if (month == 2 && ((!(year % 4) && (year % 100)) || !(year % 400))){
+        return 29;
+    }
+    return tm_cron_spec_dim[month];
+}
+
+static uint8_t tm_cron_spec_weekday(uint16_t year, uint8_t month, uint8_t date);
+
+static uint8_t tm_cron_spec_weekday(uint16_t year, uint8_t month, uint8_t date){
+    // Sakamoto's method. Returns 0 for Sunday.
+    static const uint8_t offsets[] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+    if (month < 3){
+        year --;
+    }
+    return (year + year / 4 - year / 100 + year / 400 +
+            offsets[month - 1] + date) % 7;
+}
+
+static int8_t tm_cron_spec_nextbit(uint64_t mask, uint8_t from, uint8_t limit);
+
+static int8_t tm_cron_spec_nextbit(uint64_t mask, uint8_t from, uint8_t limit){
+    if (from >= limit){
+        return -1;
+    }
+    mask >>= from;
+    while (mask && from < limit){
+        if (mask & 1){
+            return from;
+        }
+        mask >>= 1;
+        from ++;
+    }
+    return -1;
+}
+
+static uint8_t tm_cron_spec_match_day(const tm_cron_spec_t * spec,
+                                      tm_cron_cursor_t * cursor);
+
+static uint8_t tm_cron_spec_match_day(const tm_cron_spec_t * spec,
+                                      tm_cron_cursor_t * cursor){
+    uint8_t dom_match = (spec->dom >> cursor->date) & 1;
+    uint8_t dow_match = (spec->dow >> cursor->dow) & 1;
+    if ((spec->dom & TM_CRON_SPEC_ALL_DOM) == TM_CRON_SPEC_ALL_DOM ||
+        (spec->dow & TM_CRON_SPEC_ALL_DOW) == TM_CRON_SPEC_ALL_DOW){
+        return dom_match && dow_match;
+    }
+    return dom_match || dow_match;
+}
+
+static void tm_cron_spec_next_month(tm_cron_cursor_t * cursor);
+
+static void tm_cron_spec_next_month(tm_cron_cursor_t * cursor){
+    cursor->dow = (cursor->dow + cursor->dim - cursor->date + 1) % 7;
+    cursor->date = 1;
+    cursor->hours = 0;
+    cursor->minutes = 0;
+    if (++(cursor->month) > 12){
+        cursor->month = 1;
+        cursor->year ++;
+    }
+    cursor->dim = tm_cron_spec_days_in_month(cursor->year, cursor->month);
+}
+
+static void tm_cron_spec_next_day(tm_cron_cursor_t * cursor);
+
+static void tm_cron_spec_next_day(tm_cron_cursor_t * cursor){
+    if (cursor->date >= cursor->dim){
+        tm_cron_spec_next_month(cursor);
+        return;
+    }
+    cursor->dow = (cursor->dow + 1) % 7;
+    cursor->date ++;
+    cursor->hours = 0;
+    cursor->minutes = 0;
+}
+
+uint8_t tm_cron_spec_next(const tm_cron_spec_t * spec, tm_system_t * after,
+                          tm_system_t * next){
+    tm_real_t rtime;
+    tm_cron_cursor_t cursor;
+    uint16_t limit;
+    int8_t bit;
+
+    tm_rtime_from_stime(after, &rtime);
+    cursor.year = (uint16_t)(rtime.century) * 100 + rtime.year;
+    cursor.month = rtime.month;
+    cursor.date = rtime.date;
+    cursor.hours = rtime.hours;
+    // Results are always strictly after the provided time.
+    cursor.minutes = rtime.minutes + 1;
+    cursor.dim = tm_cron_spec_days_in_month(cursor.year, cursor.month);
+    cursor.dow = tm_cron_spec_weekday(cursor.year, cursor.month, cursor.date);
+    limit = cursor.year + TM_CRON_SPEC_SEARCH_YEARS;
+
+    while (cursor.year < limit){
+        if (!((spec->months >> cursor.month) & 1)){
+            tm_cron_spec_next_month(&cursor);
+            continue;
+        }
+        if (!tm_cron_spec_match_day(spec, &cursor)){
+            tm_cron_spec_next_day(&cursor);
+            continue;
+        }
+        bit = tm_cron_spec_nextbit(spec->hours, cursor.hours, 24);
+        if (bit < 0){
+            tm_cron_spec_next_day(&cursor);
+            continue;
+        }
+        if (bit != cursor.hours){
+            cursor.hours = bit;
+            cursor.minutes = 0;
+        }
+        bit = tm_cron_spec_nextbit(spec->minutes, cursor.minutes, 60);
+        if (bit < 0){
+            cursor.hours ++;
+            cursor.minutes = 0;
+            continue;
+        }
+        cursor.minutes = bit;
+
+        rtime.century = cursor.year / 100;
+        rtime.year = cursor.year % 100;
+        rtime.month = cursor.month;
+        rtime.date = cursor.date;
+        rtime.hours = cursor.hours;
+        rtime.minutes = cursor.minutes;
+        rtime.seconds = 0;
+        rtime.millis = 0;
+        tm_stime_from_rtime(&rtime, next);
+        return 0;
+    }
+    return 1;
+}
+
+static const char * tm_cron_spec_number(const char * p, uint8_t * value);
+
+static const char * tm_cron_spec_number(const char * p, uint8_t * value){
+    uint16_t result = 0;
+    if (*p < '0' || *p > '9'){
+        return NULL;
+    }
+    while (*p >= '0' && *p <= '9'){
+        result = result * 10 + (*p - '0');
+        if (result > 255){
+            return NULL;
+        }
+        p ++;
+    }
+    *value = (uint8_t)result;
+    return p;
+}
+
+static const char * tm_cron_spec_field(const char * p, uint8_t lo,
+                                       uint8_t hi, uint64_t * mask);
+
+static const char * tm_cron_spec_field(const char * p, uint8_t lo,
+                                       uint8_t hi, uint64_t * mask){
+    uint8_t first, last, step, ranged;
+
+    *mask = 0;
+    while (*p == ' ' || *p == '\t'){
+        p ++;
+    }
+    while (1){
+        ranged = 1;
+        if (*p == '*'){
+            first = lo;
+            last = hi;
+            p ++;
+        }
+        else{
+            p = tm_cron_spec_number(p, &first);
+            if (!p){
+                return NULL;
+            }
+            last = first;
+            ranged = 0;
+            if (*p == '-'){
+                ranged = 1;
+                p = tm_cron_spec_number(p + 1, &last);
+                if (!p){
+                    return NULL;
+                }
+            }
+        }
+        step = 1;
+        if (*p == '/'){
+            p = tm_cron_spec_number(p + 1, &step);
+            if (!p || !step){
+                return NULL;
+            }
+            if (!ranged){
+                // 'a/n' is shorthand for 'a-hi/n'
+                last = hi;
+            }
+        }
+        if (first < lo || last > hi || first > last){
+            return NULL;
+        }
+        for (uint16_t i = first; i <= last; i += step){
+            *mask |= (1ULL << i);
+        }
+        if (*p != ','){
+            break;
+        }
+        p ++;
+    }
+    if (*p && *p != ' ' && *p != '\t'){
+        return NULL;
+    }
+    return p;
+}
+
+uint8_t tm_cron_spec_compile(const char * expr, tm_cron_spec_t * spec){
+    uint64_t mask;
+
+    expr = tm_cron_spec_field(expr, 0, 59, &mask);
+    if (!expr){
+        return 1;
+    }
+    spec->minutes = mask;
+
+    expr = tm_cron_spec_field(expr, 0, 23, &mask);
+    if (!expr){
+        return 2;
+    }
+    spec->hours = (uint32_t)mask;
+
+    expr = tm_cron_spec_field(expr, 1, 31, &mask);
+    if (!expr){
+        return 3;
+    }
+    spec->dom = (uint32_t)mask;
+
+    expr = tm_cron_spec_field(expr, 1, 12, &mask);
+    if (!expr){
+        return 4;
+    }
+    spec->months = (uint16_t)mask;
+
+    expr = tm_cron_spec_field(expr, 0, 7, &mask);
+    if (!expr){
+        return 5;
+    }
+    // Both 0 and 7 are Sunday
+    if (mask & (1 << 7)){
+        mask |= 1;
+    }
+    spec->dow = (uint8_t)(mask & TM_CRON_SPEC_ALL_DOW);
+
+    while (*expr == ' ' || *expr == '\t'){
+        expr ++;
+    }
+    if (*expr){
+        return 6;
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published
+ *    by the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_spec.h
+ * @brief Calendar (crontab-style) schedule specifications for cron jobs.
+ *
+ * A calendar specification describes the set of wall-clock minutes at
+ * which a job should run, in the same way as a line of a crontab. Each
+ * field is stored as a bitmask, so a complete specification fits in
+ * 20 bytes and can be placed in flash as a const.
+ *
+ * Field    | Bits used | Notes
+ * ---------|-----------|----------------------------------
+ * minutes  | 0 - 59    |
+ * hours    | 0 - 23    |
+ * dom      | 1 - 31    | Day of month. Bit 0 is unused.
+ * months   | 1 - 12    | Bit 0 is unused.
+ * dow      | 0 - 6     | Day of week, 0 is Sunday.
+ *
+ * As with cron, if both the day of month and the day of week fields are
+ * restricted (ie, not all bits set), a day matches if either of them
+ * matches. Otherwise, both must match.
+ *
+ * All times are interpreted as UTC against the current epoch. This
+ * requires the epoch to be set, see `tm_rtime_from_stime()`.
+ *
+ * The next fire time is calculated by converting the start time to real
+ * time once, stepping the calendar fields forward until all of them
+ * match, and converting back once. Jobs using a specification therefore
+ * only pay for the real time conversion when they run, and not on every
+ * poll.
+ *
+ * @see cron_spec.c
+ * @see cron.h
+ */
+
+#ifndef TIME_CRON_SPEC_H
+#define TIME_CRON_SPEC_H
+
+#include "time.h"
+
+/**
+ * @name Calendar Specification Field Masks
+ *
+ * Masks for fields matching every possible value.
+ */
+/**@{*/
+
+#define TM_CRON_SPEC_ALL_MINUTES     0x0FFFFFFFFFFFFFFFULL
+#define TM_CRON_SPEC_ALL_HOURS       0x00FFFFFFUL
+#define TM_CRON_SPEC_ALL_DOM         0xFFFFFFFEUL
+#define TM_CRON_SPEC_ALL_MONTHS      0x1FFE
+#define TM_CRON_SPEC_ALL_DOW         0x7F
+
+/**@}*/
+
+/**
+ * @brief Calendar Specification Type
+ *
+ * Stores a crontab-style calendar specification as field bitmasks.
+ * See cron_spec.h for the interpretation of the fields. This type can
+ * be initialized directly, or compiled from a crontab-style string using
+ * `tm_cron_spec_compile()`.
+ */
+typedef struct TM_CRON_SPEC_t{
+    uint64_t minutes;
+    uint32_t hours;
+    uint32_t dom;
+    uint16_t months;
+    uint8_t  dow;
+} tm_cron_spec_t;
+
+/**
+ * @brief Compile a crontab-style expression into a calendar specification.
+ *
+ * The expression must contain five whitespace separated fields, in the
+ * order minute, hour, day of month, month and day of week. Each field
+ * is a comma separated list of `*`, single values or ranges (`a-b`),
+ * each optionally followed by a step (`/n`). Names for months and days
+ * are not supported. Day of week 7 is accepted as Sunday.
+ *
+ * Returns 0 on success, or the (1-indexed) number of the field which
+ * could not be parsed. The contents of spec are undefined on failure.
+ *
+ * @param expr Null terminated crontab-style expression.
+ * @param spec Pointer to the tm_cron_spec_t in which to store the result.
+ */
+uint8_t tm_cron_spec_compile(const char * expr, tm_cron_spec_t * spec);
+
+/**
+ * @brief Find the first time matching a specification after a given time.
+ *
+ * The result is always strictly after the provided time and falls on a
+ * whole minute.
+ *
+ * Returns 0 on success, non-zero if the specification does not match any
+ * time within the next 8 years (for instance, 30th February).
+ *
+ * @param spec Pointer to the calendar specification.
+ * @param after Pointer to the system time to search from.
+ * @param next Pointer to the tm_system_t in which to store the result.
+ */
+uint8_t tm_cron_spec_next(const tm_cron_spec_t * spec, tm_system_t * after,
+                          tm_system_t * next);
+
+#endif
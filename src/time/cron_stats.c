@@ -0,0 +1,175 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_stats.c
+ * @brief Cron scheduler instrumentation implementations.
+ *
+ * @see cron_stats.h
+ */
+
+#include <ds/sllist.h>
+#include "cron_stats.h"
+
+#if TIME_CRON_ENABLE_STATS
+
+tm_cron_health_t tm_cron_health;
+static tm_cron_stats_t * tm_cron_stats_root = NULL;
+
+#ifdef PIO_NATIVE
+#include <pthread.h>
+// Hosted builds may poll instances, and run pool workers, on several 
+// threads, which a critical section does not exclude.
+static pthread_mutex_t tm_cron_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static inline void tm_cron_stats_lock(void);
+
+static inline void tm_cron_stats_lock(void){
+    #ifdef PIO_NATIVE
+    pthread_mutex_lock(&tm_cron_stats_mutex);
+    #else
+    critical_enter();
+    #endif
+}
+
+static inline void tm_cron_stats_unlock(void);
+
+static inline void tm_cron_stats_unlock(void){
+    #ifdef PIO_NATIVE
+    pthread_mutex_unlock(&tm_cron_stats_mutex);
+    #else
+    critical_exit();
+    #endif
+}
+
+#define TM_UCDM_CRON_HEALTH_LEN  (sizeof(tm_cron_health_t) / 2)
+
+ucdm_addr_t tm_cron_stats_init(ucdm_addr_t ucdm_address){
+    for (uint8_t i=0; i < TM_UCDM_CRON_HEALTH_LEN; i++, ucdm_address++){
+        ucdm_redirect_regr_ptr(ucdm_address,
+                               ((uint16_t *)(void *)(&tm_cron_health) + i));
+    }
+    return ucdm_address;
+}
+
+static inline void tm_cron_stats_clear(tm_cron_stats_t * stats_p);
+
+static inline void tm_cron_stats_clear(tm_cron_stats_t * stats_p){
+    stats_p->runs = 0;
+    stats_p->late_min = UINT32_MAX;
+    stats_p->late_max = 0;
+    stats_p->late_total = 0;
+    stats_p->exec_max = 0;
+    stats_p->exec_total = 0;
+}
+
+void tm_cron_stats_attach(cron_job_t * job_p, tm_cron_stats_t * stats_p){
+    tm_cron_stats_t * walker = tm_cron_stats_root;
+    stats_p->job_p = job_p;
+    job_p->stats_p = stats_p;
+    while (walker){
+        if (walker == stats_p){
+            // Re-attached, such as after the job was re-created.
+            return;
+        }
+        walker = walker->next;
+    }
+    tm_cron_stats_clear(stats_p);
+    sllist_install((void *)&tm_cron_stats_root, (void *)stats_p);
+}
+
+void tm_cron_stats_reset(void){
+    tm_cron_stats_t * walker = tm_cron_stats_root;
+    tm_cron_stats_lock();
+    memset((void *)&tm_cron_health, 0, sizeof(tm_cron_health_t));
+    while (walker){
+        tm_cron_stats_clear(walker);
+        walker = walker->next;
+    }
+    tm_cron_stats_unlock();
+}
+
+tm_cron_stats_t * tm_cron_stats_next(tm_cron_stats_t * stats_p){
+    if (!stats_p){
+        return tm_cron_stats_root;
+    }
+    return stats_p->next;
+}
+
+static inline uint32_t tm_cron_stats_clamp(tm_sdelta_t value);
+
+static inline uint32_t tm_cron_stats_clamp(tm_sdelta_t value){
+    if (value < 0){
+        return 0;
+    }
+    if (value > UINT32_MAX){
+        return UINT32_MAX;
+    }
+    return (uint32_t)value;
+}
+
+void tm_cron_stats_record(cron_job_t * job_p, tm_sdelta_t late,
+                          tm_sdelta_t exec){
+    uint32_t late_c = tm_cron_stats_clamp(late);
+    uint32_t exec_c = tm_cron_stats_clamp(exec);
+    uint8_t bin = 0;
+    tm_cron_stats_t * stats_p = job_p->stats_p;
+
+    tm_cron_stats_lock();
+    tm_cron_health.runs ++;
+    if (late_c > tm_cron_health.late_max){
+        tm_cron_health.late_max = late_c;
+    }
+    if (exec_c > tm_cron_health.exec_max){
+        tm_cron_health.exec_max = exec_c;
+    }
+    while (late_c && bin < TIME_CRON_STATS_HIST_BINS - 1){
+        late_c >>= 1;
+        bin ++;
+    }
+    if (tm_cron_health.late_hist[bin] < UINT16_MAX){
+        tm_cron_health.late_hist[bin] ++;
+    }
+
+    if (!stats_p){
+        tm_cron_stats_unlock();
+        return;
+    }
+    late_c = tm_cron_stats_clamp(late);
+    stats_p->runs ++;
+    if (late_c < stats_p->late_min){
+        stats_p->late_min = late_c;
+    }
+    if (late_c > stats_p->late_max){
+        stats_p->late_max = late_c;
+    }
+    stats_p->late_total += late_c;
+    if (exec_c > stats_p->exec_max){
+        stats_p->exec_max = exec_c;
+    }
+    stats_p->exec_total += exec_c;
+    tm_cron_stats_unlock();
+}
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published
+ *    by the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_stats.h
+ * @brief Cron scheduler instrumentation.
+ *
+ * Applications enabling this functionality must ensure
+ * TIME_CRON_ENABLE_STATS is defined and non-zero, usually by defining
+ * APP_ENABLE_TIME_CRON_STATS in application.h.
+ *
+ * Two kinds of statistics are collected by `tm_cron_poll()` :
+ *
+ *   - Scheduler health, which is global and covers every job run. This
+ *     contains the total number of runs, the worst lateness and handler
+ *     execution time seen, and a histogram of lateness.
+ *   - Per-job statistics, which are only collected for jobs to which a
+ *     `tm_cron_stats_t` has been attached.
+ *
+ * Lateness is the difference between the time at which the job was
+ * polled and its texec. Execution time is the time spent within the job
+ * handler. Both are measured using the system time, and are therefore
+ * only as precise as the system tick (1ms).
+ *
+ * Runs are recorded within a critical section, or under a mutex on 
+ * hosted builds, so that instances polled from different tasks and the 
+ * workers of a pool can share the scheduler health.
+ *
+ * The lateness histogram uses logarithmic bins. Bin 0 counts jobs run on
+ * time, and bin n counts jobs late by [2^(n-1), 2^n) ms. The last bin
+ * additionally counts everything later than that. Bin counts saturate.
+ *
+ * If the time library UCDM interface is exposed, scheduler health is
+ * mapped to read-only UCDM registers as a `tm_cron_health_t`, in the
+ * same word order as the system time registers. See time.h.
+ *
+ * @see cron_stats.c
+ */
+
+#ifndef TIME_CRON_STATS_H
+#define TIME_CRON_STATS_H
+
+#include "cron.h"
+
+#if TIME_CRON_ENABLE_STATS
+
+/**
+ * @brief Per-job Statistics Type
+ *
+ * Attach to a job using `tm_cron_stats_attach()`. All durations are in
+ * system ticks (ms). Members should be treated as read-only by the
+ * application.
+ */
+typedef struct TM_CRON_STATS_t{
+    struct TM_CRON_STATS_t * next;
+    cron_job_t * job_p;
+    uint32_t runs;
+    uint32_t late_min;
+    uint32_t late_max;
+    uint64_t late_total;
+    uint32_t exec_max;
+    uint64_t exec_total;
+} tm_cron_stats_t;
+
+/**
+ * @brief Scheduler Health Type
+ *
+ * Global statistics covering all jobs. All durations are in system
+ * ticks (ms).
+ */
+typedef struct TM_CRON_HEALTH_t{
+    uint32_t runs;
+    uint32_t late_max;
+    uint32_t exec_max;
+    uint16_t late_hist[TIME_CRON_STATS_HIST_BINS];
+} tm_cron_health_t;
+
+extern tm_cron_health_t tm_cron_health;
+
+/**
+ * @brief Map the scheduler health structure to UCDM registers.
+ *
+ * Called by `tm_init()` when the UCDM interface is exposed.
+ *
+ * @param ucdm_address The first UCDM register to use.
+ * @return The next free UCDM register.
+ */
+ucdm_addr_t tm_cron_stats_init(ucdm_addr_t ucdm_address);
+
+/**
+ * @brief Attach a statistics container to a job.
+ *
+ * The container is cleared and added to the list of containers visited
+ * by `tm_cron_stats_next()`. Creating a job detaches its container, so 
+ * the container must be attached again each time the job is re-created.
+ * Attaching a container which is already in the list moves it to the 
+ * job, and keeps its statistics.
+ *
+ * @param job_p Pointer to the job.
+ * @param stats_p Pointer to the statistics container.
+ */
+void tm_cron_stats_attach(cron_job_t * job_p, tm_cron_stats_t * stats_p);
+
+/**
+ * @brief Clear all per-job statistics and the scheduler health.
+ */
+void tm_cron_stats_reset(void);
+
+/**
+ * @brief Iterate over all attached statistics containers.
+ *
+ * Containers are visited in the order in which they were attached.
+ * Detached jobs retain their containers, so statistics of jobs which
+ * have completed or been cancelled remain available.
+ *
+ * @param stats_p The previous container, or NULL to get the first.
+ * @return The next container, or NULL if there are no more.
+ */
+tm_cron_stats_t * tm_cron_stats_next(tm_cron_stats_t * stats_p);
+
+/**
+ * @brief Record a single job run. Used internally by `tm_cron_poll()`.
+ *
+ * @param job_p Pointer to the job which was run.
+ * @param late Lateness of the run.
+ * @param exec Execution time of the handler.
+ */
+void tm_cron_stats_record(cron_job_t * job_p, tm_sdelta_t late,
+                          tm_sdelta_t exec);
+
+static inline uint32_t tm_cron_stats_late_mean(tm_cron_stats_t * stats_p);
+
+static inline uint32_t tm_cron_stats_late_mean(tm_cron_stats_t * stats_p){
+    if (!stats_p->runs){
+        return 0;
+    }
+    return (uint32_t)(stats_p->late_total / stats_p->runs);
+}
+
+static inline uint32_t tm_cron_stats_exec_mean(tm_cron_stats_t * stats_p);
+
+static inline uint32_t tm_cron_stats_exec_mean(tm_cron_stats_t * stats_p){
+    if (!stats_p->runs){
+        return 0;
+    }
+    return (uint32_t)(stats_p->exec_total / stats_p->runs);
+}
+
+#endif
+#endif
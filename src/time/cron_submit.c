@@ -0,0 +1,163 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_submit.c
+ * @brief Interrupt context cron job submission queue.
+ *
+ * The submission queue is a bounded multi-producer, single-consumer ring.
+ * Each slot carries a sequence number, which tells producers whether the
+ * slot is free for the current lap of the ring and tells the consumer
+ * whether the slot has been published.
+ *
+ * A producer reserves a slot by advancing the head with a compare-and-swap,
+ * fills it, and then publishes it by advancing its sequence number. The
+ * consumer (`tm_cron_poll()`) only ever reads published slots, and stops
+ * at the first slot which is reserved but not yet published. Such a slot
+ * belongs to a producer which was itself interrupted, and is picked up at
+ * the next poll.
+ *
+ * @see cron.h
+ */
+
+#include "cron.h"
+
+#if TIME_CRON_SUBMIT_QUEUE_LEN
+
+#define TM_CRON_SUBMIT_MASK   (TIME_CRON_SUBMIT_QUEUE_LEN - 1)
+
+
+void tm_cron_sched_submit_init(tm_cron_sched_t * sched_p){
+    for (unsigned int i=0; i < TIME_CRON_SUBMIT_QUEUE_LEN; i++){
+        sched_p->submit_ring[i].seq = i;
+    }
+    sched_p->submit_head = 0;
+    sched_p->submit_tail = 0;
+}
+
+
+static inline uint8_t tm_cron_submit_reserve(tm_cron_sched_t * sched_p, 
+                                             unsigned int * pos);
+
+#if __GCC_ATOMIC_INT_LOCK_FREE == 2
+
+static inline uint8_t tm_cron_submit_reserve(tm_cron_sched_t * sched_p, 
+                                             unsigned int * pos){
+    unsigned int seq;
+    int diff;
+    *pos = __atomic_load_n(&(sched_p->submit_head), __ATOMIC_RELAXED);
+    while (1){
+        seq = __atomic_load_n(&(sched_p->submit_ring[*pos & TM_CRON_SUBMIT_MASK].seq),
+                              __ATOMIC_ACQUIRE);
+        diff = (int)(seq - *pos);
+        if (diff == 0){
+            if (__atomic_compare_exchange_n(&(sched_p->submit_head), pos, *pos + 1,
+                                            1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)){
+                return 0;
+            }
+            // pos has been updated with the current head. Retry.
+        }
+        else if (diff < 0){
+            // The slot still holds a request from the previous lap.
+            return 1;
+        }
+        else{
+            *pos = __atomic_load_n(&(sched_p->submit_head), __ATOMIC_RELAXED);
+        }
+    }
+}
+
+#else
+
+static inline uint8_t tm_cron_submit_reserve(tm_cron_sched_t * sched_p, 
+                                             unsigned int * pos){
+    uint8_t rval = 1;
+    critical_enter();
+    *pos = sched_p->submit_head;
+    if (sched_p->submit_ring[*pos & TM_CRON_SUBMIT_MASK].seq == *pos){
+        sched_p->submit_head ++;
+        rval = 0;
+    }
+    critical_exit();
+    return rval;
+}
+
+#endif
+
+
+static uint8_t tm_cron_submit(tm_cron_sched_t * sched_p, cron_job_t * job_p, 
+                              uint8_t op, tm_system_t * texec_p);
+
+static uint8_t tm_cron_submit(tm_cron_sched_t * sched_p, cron_job_t * job_p, 
+                              uint8_t op, tm_system_t * texec_p){
+    unsigned int pos;
+    tm_cron_submit_slot_t * slot_p;
+    if (tm_cron_submit_reserve(sched_p, &pos)){
+        return 1;
+    }
+    slot_p = &(sched_p->submit_ring[pos & TM_CRON_SUBMIT_MASK]);
+    slot_p->op = op;
+    slot_p->job_p = job_p;
+    if (texec_p){
+        slot_p->texec = *texec_p;
+    }
+    __atomic_store_n(&(slot_p->seq), pos + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+
+uint8_t tm_cron_sched_submit_job(tm_cron_sched_t * sched_p, 
+                                 cron_job_t * job_p, tm_system_t * texec_p){
+    return tm_cron_submit(sched_p, job_p, TM_CRON_SUBMIT_SCHEDULE, texec_p);
+}
+
+
+uint8_t tm_cron_sched_submit_cancel(tm_cron_sched_t * sched_p, 
+                                    cron_job_t * job_p){
+    return tm_cron_submit(sched_p, job_p, TM_CRON_SUBMIT_CANCEL, NULL);
+}
+
+
+void tm_cron_sched_submit_drain(tm_cron_sched_t * sched_p){
+    tm_cron_submit_slot_t * slot_p;
+    unsigned int seq;
+    while (1){
+        slot_p = &(sched_p->submit_ring[sched_p->submit_tail & TM_CRON_SUBMIT_MASK]);
+        seq = __atomic_load_n(&(slot_p->seq), __ATOMIC_ACQUIRE);
+        if (seq != sched_p->submit_tail + 1){
+            // Empty, or the next request is not yet published.
+            return;
+        }
+        tm_cron_sched_cancel_job(sched_p, slot_p->job_p);
+        if (slot_p->op == TM_CRON_SUBMIT_SCHEDULE){
+            slot_p->job_p->texec = slot_p->texec - sched_p->epoch_offset;
+            tm_cron_sched_insert_job(sched_p, slot_p->job_p);
+        }
+        __atomic_store_n(&(slot_p->seq),
+                         sched_p->submit_tail + TIME_CRON_SUBMIT_QUEUE_LEN,
+                         __ATOMIC_RELEASE);
+        sched_p->submit_tail ++;
+    }
+}
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_table.c
+ * @brief Constant cron job table implementations.
+ *
+ * The next execution time of each entry is held as an offset from the
+ * base of the table, which is itself against the queue base of the
+ * scheduler instance, so that tables follow epoch changes along with
+ * the job queue. When an offset would exceed 31 bits, the base is moved
+ * forward to the earliest entry. When a table is polled after a gap too
+ * long for the offsets to span, the late entries are first realigned to
+ * their latest slot, so that the base can be moved up to them.
+ *
+ * @see cron_table.h
+ */
+
+#include "cron_table.h"
+
+#if TIME_CRON_ENABLE_TABLES
+
+#define TM_CRON_TABLE_REBASE     0x80000000UL
+
+static void tm_cron_table_update_due(tm_cron_table_t * table_p);
+
+static void tm_cron_table_update_due(tm_cron_table_t * table_p){
+    uint8_t due = 0;
+    for (uint8_t i=1; i < table_p->count; i++){
+        // Strictly less, so that ties go to the earlier entry.
+        if (table_p->next_p[i] < table_p->next_p[due]){
+            due = i;
+        }
+    }
+    table_p->due_index = due;
+}
+
+
+static tm_system_t tm_cron_table_slot(tm_cron_table_t * table_p, uint8_t index,
+                                      tm_system_t * now);
+
+static tm_system_t tm_cron_table_slot(tm_cron_table_t * table_p, uint8_t index,
+                                      tm_system_t * now){
+    // The latest slot of a late entry which is not after now, otherwise
+    // its next slot.
+    uint32_t period = table_p->entries[index].period;
+    tm_system_t due = table_p->base + table_p->next_p[index];
+    tm_sdelta_t late = *now - due;
+    if (late >= (tm_sdelta_t)period){
+        due += (late / period) * period;
+    }
+    return due;
+}
+
+
+static void tm_cron_table_realign(tm_cron_table_t * table_p, tm_system_t * now);
+
+static void tm_cron_table_realign(tm_cron_table_t * table_p, tm_system_t * now){
+    tm_system_t base;
+    tm_system_t due;
+    // Late entries stay due for a single, coalesced run, and the slots
+    // skipped over are counted as missed.
+    base = tm_cron_table_slot(table_p, 0, now);
+    for (uint8_t i=1; i < table_p->count; i++){
+        due = tm_cron_table_slot(table_p, i, now);
+        if (due < base){
+            base = due;
+        }
+    }
+    for (uint8_t i=0; i < table_p->count; i++){
+        due = tm_cron_table_slot(table_p, i, now);
+        table_p->missed += (due - (table_p->base + table_p->next_p[i])) /
+                           table_p->entries[i].period;
+        table_p->next_p[i] = (uint32_t)(due - base);
+    }
+    table_p->base = base;
+    tm_cron_table_update_due(table_p);
+}
+
+
+uint8_t tm_cron_sched_attach_table(tm_cron_sched_t * sched_p,
+                                   tm_cron_table_t * table_p){
+    const tm_cron_table_entry_t * entry_p;
+    tm_system_t current;
+    tm_sdelta_t rem;
+
+    if (!table_p->count){
+        return TM_CRON_TABLE_E_EMPTY;
+    }
+    for (uint8_t i=0; i < table_p->count; i++){
+        entry_p = &(table_p->entries[i]);
+        if (!entry_p->period || entry_p->period >= TM_CRON_TABLE_REBASE ||
+                entry_p->phase >= entry_p->period){
+            return TM_CRON_TABLE_E_ENTRY;
+        }
+    }
+
+    tm_cron_sched_follow_epoch(sched_p);
+    tm_current_time(&current);
+    table_p->base = current - sched_p->epoch_offset;
+    table_p->runs = 0;
+    table_p->missed = 0;
+    for (uint8_t i=0; i < table_p->count; i++){
+        entry_p = &(table_p->entries[i]);
+        rem = (current - entry_p->phase) % entry_p->period;
+        if (rem < 0){
+            rem += entry_p->period;
+        }
+        table_p->next_p[i] = rem ? entry_p->period - rem : 0;
+    }
+    tm_cron_table_update_due(table_p);
+
+    table_p->next = sched_p->tables_p;
+    sched_p->tables_p = table_p;
+    return 0;
+}
+
+
+tm_cron_table_t * tm_cron_table_next(tm_cron_sched_t * sched_p,
+                                     tm_system_t * due_p){
+    tm_cron_table_t * walker = sched_p->tables_p;
+    tm_cron_table_t * first = NULL;
+    tm_system_t due;
+    while (walker){
+        due = walker->base + walker->next_p[walker->due_index];
+        if (!first || due < *due_p){
+            first = walker;
+            *due_p = due;
+        }
+        walker = walker->next;
+    }
+    return first;
+}
+
+
+void tm_cron_table_run(tm_cron_table_t * table_p, tm_system_t * now){
+    uint8_t index = table_p->due_index;
+    const tm_cron_table_entry_t * entry_p = &(table_p->entries[index]);
+    uint64_t next = table_p->next_p[index];
+    tm_sdelta_t late = *now - (table_p->base + (tm_system_t)next);
+    uint64_t slots = 1;
+    uint32_t shift;
+
+    if (late >= (tm_sdelta_t)TM_CRON_TABLE_REBASE){
+        // The next slot could not be held against the current base.
+        tm_cron_table_realign(table_p, now);
+        index = table_p->due_index;
+        entry_p = &(table_p->entries[index]);
+        next = table_p->next_p[index];
+        late = *now - (table_p->base + (tm_system_t)next);
+    }
+
+    if (late >= (tm_sdelta_t)entry_p->period){
+        slots = late / entry_p->period + 1;
+        table_p->missed += slots - 1;
+    }
+    if (entry_p->handler){
+        entry_p->handler();
+    }
+    table_p->runs ++;
+
+    next += slots * entry_p->period;
+    if (next >= TM_CRON_TABLE_REBASE){
+        // The entry being run is the earliest one.
+        shift = table_p->next_p[index];
+        table_p->base += shift;
+        for (uint8_t i=0; i < table_p->count; i++){
+            table_p->next_p[i] -= shift;
+        }
+        next -= shift;
+    }
+    table_p->next_p[index] = (uint32_t)next;
+    tm_cron_table_update_due(table_p);
+}
+
+#endif
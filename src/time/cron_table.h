@@ -0,0 +1,160 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published
+ *    by the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file cron_table.h
+ * @brief Constant (flash resident) tables of periodic cron jobs.
+ *
+ * Applications enabling this functionality must ensure
+ * TIME_CRON_ENABLE_TABLES is defined and non-zero, usually by defining
+ * APP_ENABLE_TIME_CRON_TABLES in application.h.
+ *
+ * Periodic jobs which are fixed at build time can be declared in a
+ * `const` table of `tm_cron_table_entry_t`, which the toolchain places
+ * in flash. Each entry holds only the handler, the period and the phase.
+ * The only RAM needed per entry is a single `uint32_t`, holding the next
+ * execution time of the entry against the base of the table. Nothing is
+ * inserted into the job queue.
+ *
+ * An entry runs at every time t (against the epoch) for which
+ * `t % period == phase`. Entries are therefore aligned to the epoch, and
+ * entries with a common period and different phases never run together.
+ * Missed runs are coalesced, as with TM_CRON_POLICY_COALESCE, except
+ * that they are not reported to the handler.
+ *
+ * Entries may be in any order. Entries due at the same time run in
+ * table order, after any dynamic jobs due at that time. Use
+ * `TM_CRON_TABLE_ENTRY()` to declare entries, which reduces the phase
+ * modulo the period at compile time.
+ *
+ * Attached tables are polled along with the job queue of the scheduler
+ * instance, and their runs are merged in time order with those of the
+ * dynamic jobs. Tables do not take part in slack batching.
+ *
+ * @see cron_table.c
+ */
+
+#ifndef TIME_CRON_TABLE_H
+#define TIME_CRON_TABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "cron.h"
+
+#if TIME_CRON_ENABLE_TABLES
+
+/**
+ * @brief Constant Table Entry Type
+ */
+typedef struct TM_CRON_TABLE_ENTRY_t{
+    void (* handler)(void);
+    uint32_t period;
+    uint32_t phase;
+} tm_cron_table_entry_t;
+
+/**
+ * @brief Declare a table entry, with the phase reduced modulo the period.
+ */
+#define TM_CRON_TABLE_ENTRY(handler, period, phase) \
+    {(handler), (period), (phase) % (period)}
+
+/**
+ * @brief Table Instance Type
+ *
+ * Initialize with `TM_CRON_TABLE_INIT()`. Members should be treated as
+ * read-only by the application.
+ */
+typedef struct TM_CRON_TABLE_t{
+    struct TM_CRON_TABLE_t * next;
+    const tm_cron_table_entry_t * entries;
+    uint32_t * next_p;
+    uint8_t count;
+    uint8_t due_index;
+    tm_system_t base;
+    uint32_t runs;
+    uint32_t missed;
+} tm_cron_table_t;
+
+/**
+ * @brief Static initializer for a table instance.
+ *
+ * @param entries The const array of entries.
+ * @param state A uint32_t array with one element per entry.
+ */
+#define TM_CRON_TABLE_INIT(entries, state) \
+    {NULL, (entries), (state), sizeof(entries) / sizeof((entries)[0]), 0, 0, 0, 0}
+
+#define TM_CRON_TABLE_E_EMPTY       1
+#define TM_CRON_TABLE_E_ENTRY       2
+
+/**
+ * @brief Check a table, and attach it to a scheduler instance.
+ *
+ * The first run of each entry is at the earliest aligned time which is
+ * not before the current time. A table can only be attached to one instance, once.
+ *
+ * @param sched_p Pointer to the scheduler instance.
+ * @param table_p Pointer to the table instance.
+ * @return 0 on success, or one of the TM_CRON_TABLE_E_ definitions.
+ */
+uint8_t tm_cron_sched_attach_table(tm_cron_sched_t * sched_p,
+                                   tm_cron_table_t * table_p);
+
+/**
+ * @brief Get the earliest due table run of an instance.
+ *
+ * Used internally by the scheduler.
+ *
+ * @param sched_p Pointer to the scheduler instance.
+ * @param due_p Pointer to the tm_system_t in which to store the execution
+ *              time, against the queue base.
+ * @return The table holding the entry, or NULL if there are no tables.
+ */
+tm_cron_table_t * tm_cron_table_next(tm_cron_sched_t * sched_p,
+                                     tm_system_t * due_p);
+
+/**
+ * @brief Run the earliest due entry of a table and reschedule it.
+ *
+ * Used internally by the scheduler.
+ *
+ * @param table_p Pointer to the table instance.
+ * @param now Pointer to the current time, against the queue base.
+ */
+void tm_cron_table_run(tm_cron_table_t * table_p, tm_system_t * now);
+
+static inline uint8_t tm_cron_attach_table(tm_cron_table_t * table_p);
+
+static inline uint8_t tm_cron_attach_table(tm_cron_table_t * table_p){
+    return tm_cron_sched_attach_table(&tm_cron_default, table_p);
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,203 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file interval.c
+ * @brief Time interval set implementations.
+ *
+ * Since the intervals of a set are disjoint and sorted, both their starts
+ * and their ends are in increasing order, and either can be binary
+ * searched.
+ *
+ * @see interval.h
+ */
+
+#include "interval.h"
+
+/**
+ * @brief Index of the first interval whose end is after (or, if
+ *        `inclusive`, at or after) the given time.
+ */
+static uint16_t tm_interval_search_end(const tm_interval_set_t * set_p,
+                                       tm_system_t time, uint8_t inclusive);
+
+static uint16_t tm_interval_search_end(const tm_interval_set_t * set_p,
+                                       tm_system_t time, uint8_t inclusive){
+    uint16_t lo = 0;
+    uint16_t hi = set_p->count;
+    uint16_t mid;
+    while (lo < hi){
+        mid = lo + (hi - lo) / 2;
+        if (set_p->items[mid].end > time ||
+                (inclusive && set_p->items[mid].end == time)){
+            hi = mid;
+        }
+        else{
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief Index of the first interval whose start is after (or, if
+ *        `inclusive`, at or after) the given time.
+ */
+static uint16_t tm_interval_search_start(const tm_interval_set_t * set_p,
+                                         tm_system_t time, uint8_t inclusive);
+
+static uint16_t tm_interval_search_start(const tm_interval_set_t * set_p,
+                                         tm_system_t time, uint8_t inclusive){
+    uint16_t lo = 0;
+    uint16_t hi = set_p->count;
+    uint16_t mid;
+    while (lo < hi){
+        mid = lo + (hi - lo) / 2;
+        if (set_p->items[mid].start > time ||
+                (inclusive && set_p->items[mid].start == time)){
+            hi = mid;
+        }
+        else{
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+/**
+ * @brief Replace the intervals [first, last) of a set with `kept`
+ *        intervals, which must already fit.
+ */
+static void tm_interval_splice(tm_interval_set_t * set_p, uint16_t first,
+                               uint16_t last, const tm_interval_t * kept,
+                               uint16_t nkept);
+
+static void tm_interval_splice(tm_interval_set_t * set_p, uint16_t first,
+                               uint16_t last, const tm_interval_t * kept,
+                               uint16_t nkept){
+    memmove(&(set_p->items[first + nkept]), &(set_p->items[last]),
+            (set_p->count - last) * sizeof(tm_interval_t));
+    if (nkept){
+        memcpy(&(set_p->items[first]), kept, nkept * sizeof(tm_interval_t));
+    }
+    set_p->count = set_p->count - (last - first) + nkept;
+}
+
+
+void tm_interval_set_init(tm_interval_set_t * set_p,
+                          tm_interval_t * items, uint16_t size){
+    set_p->items = items;
+    set_p->count = 0;
+    set_p->size = size;
+}
+
+
+uint8_t tm_interval_set_add(tm_interval_set_t * set_p,
+                            const tm_interval_t * interval_p){
+    tm_interval_t merged = *interval_p;
+    uint16_t first, last;
+
+    if (merged.start >= merged.end){
+        return 0;
+    }
+    // Intervals which overlap or touch the new one are [first, last).
+    first = tm_interval_search_end(set_p, merged.start, 1);
+    last = tm_interval_search_start(set_p, merged.end, 0);
+    if (first == last && set_p->count >= set_p->size){
+        return 1;
+    }
+    if (first < last){
+        if (set_p->items[first].start < merged.start){
+            merged.start = set_p->items[first].start;
+        }
+        if (set_p->items[last - 1].end > merged.end){
+            merged.end = set_p->items[last - 1].end;
+        }
+    }
+    tm_interval_splice(set_p, first, last, &merged, 1);
+    return 0;
+}
+
+
+uint8_t tm_interval_set_remove(tm_interval_set_t * set_p,
+                               const tm_interval_t * interval_p){
+    tm_interval_t kept[2];
+    uint16_t nkept = 0;
+    uint16_t first, last;
+
+    if (interval_p->start >= interval_p->end){
+        return 0;
+    }
+    // Intervals which overlap the span are [first, last).
+    first = tm_interval_search_end(set_p, interval_p->start, 0);
+    last = tm_interval_search_start(set_p, interval_p->end, 1);
+    if (first >= last){
+        return 0;
+    }
+    if (set_p->items[first].start < interval_p->start){
+        kept[nkept].start = set_p->items[first].start;
+        kept[nkept].end = interval_p->start;
+        nkept ++;
+    }
+    if (set_p->items[last - 1].end > interval_p->end){
+        kept[nkept].start = interval_p->end;
+        kept[nkept].end = set_p->items[last - 1].end;
+        nkept ++;
+    }
+    if (set_p->count - (last - first) + nkept > set_p->size){
+        return 1;
+    }
+    tm_interval_splice(set_p, first, last, kept, nkept);
+    return 0;
+}
+
+
+void tm_interval_set_expire(tm_interval_set_t * set_p,
+                            const tm_system_t * time_p){
+    uint16_t last = tm_interval_search_end(set_p, *time_p, 0);
+    tm_interval_splice(set_p, 0, last, NULL, 0);
+}
+
+
+const tm_interval_t * tm_interval_set_find(const tm_interval_set_t * set_p,
+                                           const tm_system_t * time_p){
+    uint16_t index = tm_interval_search_end(set_p, *time_p, 0);
+    if (index < set_p->count && set_p->items[index].start <= *time_p){
+        return &(set_p->items[index]);
+    }
+    return NULL;
+}
+
+
+const tm_interval_t * tm_interval_set_overlap(const tm_interval_set_t * set_p,
+                                              const tm_interval_t * interval_p){
+    uint16_t index;
+    if (interval_p->start >= interval_p->end){
+        return NULL;
+    }
+    index = tm_interval_search_end(set_p, interval_p->start, 0);
+    if (index < set_p->count && set_p->items[index].start < interval_p->end){
+        return &(set_p->items[index]);
+    }
+    return NULL;
+}
@@ -0,0 +1,142 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published
+ *    by the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file interval.h
+ * @brief Time intervals and sorted interval sets.
+ *
+ * An interval is the half-open span of system time [start, end), against
+ * the epoch. An interval set holds a number of intervals in storage
+ * provided by the application. The intervals are kept sorted, and
+ * overlapping or adjacent intervals are merged when they are added, so
+ * that the set is always a sorted list of disjoint intervals. Point and
+ * overlap queries are binary searches, and are O(log n). Adding and
+ * removing intervals is O(n).
+ *
+ * Interval sets are meant for things like transmit blackouts and
+ * maintenance windows, which cron jobs can reference to have their runs
+ * deferred past the windows. See `tm_cron_set_blackout()`.
+ *
+ * Interval sets are not protected against concurrent access. They should
+ * not be modified from interrupt context while they are in use by a
+ * scheduler.
+ *
+ * @see interval.c
+ */
+
+#ifndef TIME_INTERVAL_H
+#define TIME_INTERVAL_H
+
+#include "time.h"
+
+/**
+ * @brief Interval Type
+ *
+ * The half-open span [start, end) of system time, against the epoch.
+ */
+typedef struct TM_INTERVAL_t{
+    tm_system_t start;
+    tm_system_t end;
+} tm_interval_t;
+
+/**
+ * @brief Interval Set Type
+ *
+ * Initialize using `tm_interval_set_init()`. Members should be treated as
+ * read-only by the application.
+ */
+typedef struct TM_INTERVAL_SET_t{
+    tm_interval_t * items;
+    uint16_t count;
+    uint16_t size;
+} tm_interval_set_t;
+
+/**
+ * @brief Initialize an empty interval set.
+ *
+ * @param set_p Pointer to the interval set.
+ * @param items Storage for the intervals of the set.
+ * @param size Number of intervals which fit in the storage.
+ */
+void tm_interval_set_init(tm_interval_set_t * set_p,
+                          tm_interval_t * items, uint16_t size);
+
+/**
+ * @brief Add an interval to a set, merging it with any it overlaps or
+ *        touches.
+ *
+ * Empty intervals are ignored.
+ *
+ * @param set_p Pointer to the interval set.
+ * @param interval_p Pointer to the interval to add.
+ * @return 0 on success, 1 if the set is full. The set is unchanged on
+ *         failure.
+ */
+uint8_t tm_interval_set_add(tm_interval_set_t * set_p,
+                            const tm_interval_t * interval_p);
+
+/**
+ * @brief Remove a span of time from a set.
+ *
+ * Intervals which partially overlap the span are trimmed, and an
+ * interval which contains it is split in two.
+ *
+ * @param set_p Pointer to the interval set.
+ * @param interval_p Pointer to the span to remove.
+ * @return 0 on success, 1 if a split was needed and the set is full. The
+ *         set is unchanged on failure.
+ */
+uint8_t tm_interval_set_remove(tm_interval_set_t * set_p,
+                               const tm_interval_t * interval_p);
+
+/**
+ * @brief Remove all intervals which end at or before the given time.
+ *
+ * @param set_p Pointer to the interval set.
+ * @param time_p Pointer to the time.
+ */
+void tm_interval_set_expire(tm_interval_set_t * set_p,
+                            const tm_system_t * time_p);
+
+/**
+ * @brief Find the interval of a set which contains a point in time.
+ *
+ * @param set_p Pointer to the interval set.
+ * @param time_p Pointer to the time.
+ * @return Pointer to the containing interval, or NULL if there is none.
+ */
+const tm_interval_t * tm_interval_set_find(const tm_interval_set_t * set_p,
+                                           const tm_system_t * time_p);
+
+/**
+ * @brief Find the first interval of a set which overlaps a span of time.
+ *
+ * @param set_p Pointer to the interval set.
+ * @param interval_p Pointer to the span.
+ * @return Pointer to the earliest overlapping interval, or NULL if there
+ *         is none.
+ */
+const tm_interval_t * tm_interval_set_overlap(const tm_interval_set_t * set_p,
+                                              const tm_interval_t * interval_p);
+
+#endif
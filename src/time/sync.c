@@ -35,12 +35,22 @@
  *  - t2p - master timestamped reception of t2
  * 
  * The state machine is executed on reciept of the last synchronization 
- * register from the host. 
+ * register from the host. A sync with timestamp is a write of a non-zero 
+ * t1. A sync without timestamp is a write of 0, followed by a write of 
+ * t1 as the follow up. 
  * 
  * When the delay out timestamp is read from the host (t2), it needs to 
  * read one extra register. The final register read is the trigger we 
  * use to record our copy.
  * 
+ * The offset of the local clock from that of the host is 
+ * ((t1p - t1) - (t2p - t2)) / 2, and the round trip delay is 
+ * (t1p - t1) + (t2p - t2). The local clock is corrected by the negative 
+ * of the offset. 
+ * 
+ * Each sync instance has its own state machine. The UCDM handlers are 
+ * shared, and find the instance from the address of the register. 
+ * 
  * 
  * @see sync.h
  */
@@ -50,92 +60,685 @@
 
 #if TIME_ENABLE_SYNC
 
-avlt_node_t  tm_avlt_sync_handler_node;
 tm_sync_sm_t tm_sync_sm;
+tm_sync_clock_t tm_sync_clock;
 uint16_t tm_sync_host_read_hook(ucdm_addr_t address);
-ucdm_addr_t ucdm_addr_sync_host_ts;
+ucdm_addr_t ucdm_addr_sync_telemetry;
+
+static uint16_t tm_sync_since_read(ucdm_addr_t address);
+
+#if TIME_ENABLE_SYNC_BLOCK
+ucdm_addr_t ucdm_addr_sync_block;
+static uint16_t tm_sync_block_read_hook(ucdm_addr_t address);
+
+#define TM_UCDM_SYNC_BLOCK_LEN      (sizeof(tm_sync_block_t) / 2)
+#endif
+
+#define TM_UCDM_SYNC_TELEMETRY_LEN  (sizeof(tm_sync_telemetry_t) / 2)
+
+static inline void tm_redirect_next_host_ts(tm_sync_sm_t * sm_p, 
+                                            tm_system_t * target);
 
 ucdm_addr_t tm_sync_init(ucdm_addr_t ucdm_address){
+    tm_sync_clock.instances = NULL;
+    tm_sync_clock.selected = NULL;
+    tm_sync_clock.candidate = NULL;
+    tm_sync_clock.candidate_count = 0;
+    tm_sync_clock.switches = 0;
+    #if TIME_ENABLE_SYNC_SERVO
+    tm_sync_servo_reset(&(tm_sync_clock.servo));
+    #endif
+    #if TIME_SYNC_ERROR_BUDGET
+    tm_sync_auto_reset(&(tm_sync_clock.autosync));
+    #endif
+    ucdm_addr_sync_telemetry = ucdm_address + TM_SYNC_UCDM_TELEMETRY;
+    #if TIME_ENABLE_SYNC_BLOCK
+    ucdm_addr_sync_block = ucdm_address + TM_SYNC_UCDM_BLOCK;
+    #endif
+    return tm_sync_instance_init(&tm_sync_sm, ucdm_address);
+}
+
+ucdm_addr_t tm_sync_instance_init(tm_sync_sm_t * sm_p, ucdm_addr_t ucdm_address){
+    tm_sync_sm_t ** link_p = &(tm_sync_clock.instances);
+    sm_p->address = ucdm_address;
+
     // Setup System Time Read Hook
     ucdm_redirect_regr_func(ucdm_address, &tm_sync_host_read_hook);
     ucdm_address += 2;
     
-    ucdm_addr_sync_host_ts = ucdm_address;
     // Setup Host Interface Registers
     for(uint8_t i=0; i<(sizeof(tm_system_t)/2); i++, ucdm_address++){
-        ucdm_enable_regw(ucdm_address + i);        
+        ucdm_enable_regw(ucdm_address);
     }
     
     // Setup Host Sync Handler(s)
     ucdm_install_regw_handler(ucdm_address - 1, 
-                              &tm_avlt_sync_handler_node, 
+                              &(sm_p->handler_node), 
                               &tm_sync_handler);
-    tm_sync_sm.state = TM_SYNC_STATE_IDLE;
+    tm_redirect_next_host_ts(sm_p, &(sm_p->t1));
+    
+    // Setup Telemetry Registers
+    for (uint8_t i=0; i < TM_UCDM_SYNC_TELEMETRY_LEN; i++, ucdm_address++){
+        ucdm_redirect_regr_ptr(ucdm_address, 
+                               ((uint16_t *)(void *)(&(sm_p->telemetry)) + i));
+    }
+    for (uint8_t i=0; i < 2; i++, ucdm_address++){
+        ucdm_redirect_regr_func(ucdm_address, &tm_sync_since_read);
+    }
+    
+    #if TIME_ENABLE_SYNC_BLOCK
+    // Setup Block Mode Registers
+    ucdm_redirect_regr_func(ucdm_address, &tm_sync_block_read_hook);
+    ucdm_address ++;
+    for (uint8_t i=0; i < TM_UCDM_SYNC_BLOCK_LEN; i++, ucdm_address++){
+        ucdm_enable_regw(ucdm_address);
+        ucdm_register[ucdm_address].ptr = (uint16_t *)(void *)(&(sm_p->block)) + i;
+    }
+    ucdm_install_regw_handler(ucdm_address - 1, 
+                              &(sm_p->block_node), 
+                              &tm_sync_block_handler);
+    sm_p->block_state = TM_SYNC_BLOCK_IDLE;
+    #endif
+    sm_p->end = ucdm_address;
+    memset((void *)&(sm_p->telemetry), 0, sizeof(tm_sync_telemetry_t));
+    sm_p->rx.valid = 0;
+    sm_p->tx_p = NULL;
+    sm_p->state = TM_SYNC_STATE_IDLE;
+    #if TIME_SYNC_FILTER_LEN
+    tm_sync_filter_reset(&(sm_p->filter));
+    #endif
+
+    while (*link_p){
+        link_p = &((*link_p)->next);
+    }
+    sm_p->next = NULL;
+    *link_p = sm_p;
     return ucdm_address;
 }
 
+/**
+ * @brief Find the sync instance to which a register belongs.
+ */
+static tm_sync_sm_t * tm_sync_find(ucdm_addr_t address);
+
+static tm_sync_sm_t * tm_sync_find(ucdm_addr_t address){
+    tm_sync_sm_t * sm_p = tm_sync_clock.instances;
+    while (sm_p){
+        if (address >= sm_p->address && address < sm_p->end){
+            return sm_p;
+        }
+        sm_p = sm_p->next;
+    }
+    return NULL;
+}
+
 void tm_sync_request_host(void){
+    tm_sync_sm_t * sm_p = tm_sync_clock.instances;
     ucdm_exception_status |= UCDM_EXST_TIMESYNC_REQ;
-    tm_sync_sm.state = TM_SYNC_STATE_WAIT_HOST;
+    // Exchanges already in progress are left to complete.
+    while (sm_p){
+        if (sm_p->state == TM_SYNC_STATE_IDLE){
+            sm_p->state = TM_SYNC_STATE_WAIT_HOST;
+        }
+        sm_p = sm_p->next;
+    }
+}
+
+
+#if TIME_SYNC_FILTER_LEN
+
+static inline tm_sdelta_t tm_sync_abs(tm_sdelta_t value);
+
+static inline tm_sdelta_t tm_sync_abs(tm_sdelta_t value){
+    return (value < 0) ? -value : value;
+}
+
+
+void tm_sync_filter_shift(tm_sync_filter_t * filter_p, tm_sdelta_t correction){
+    for (uint8_t i=0; i < filter_p->count; i++){
+        filter_p->samples[i].offset += correction;
+    }
+}
+
+
+void tm_sync_filter_reset(tm_sync_filter_t * filter_p){
+    filter_p->head = 0;
+    filter_p->count = 0;
+    filter_p->seq = 0;
+    filter_p->applied_seq = 0;
+    filter_p->offset = 0;
+    filter_p->delay = 0;
+    filter_p->jitter = 0;
+    filter_p->held = 0;
+}
+
+
+uint8_t tm_sync_filter_add(tm_sync_filter_t * filter_p, tm_sdelta_t tsd1, 
+                           tm_sdelta_t tsd2, tm_sdelta_t * correction_p){
+    tm_sync_sample_t * sample_p = &(filter_p->samples[filter_p->head]);
+    tm_sync_sample_t * best_p;
+    tm_sdelta_t deviation = 0;
+    uint8_t agree = 0;
+
+    filter_p->seq ++;
+    sample_p->offset = (tsd1 - tsd2) / 2;
+    sample_p->delay = tsd1 + tsd2;
+    sample_p->seq = filter_p->seq;
+    filter_p->head = (filter_p->head + 1) % TIME_SYNC_FILTER_LEN;
+    if (filter_p->count < TIME_SYNC_FILTER_LEN){
+        filter_p->count ++;
+    }
+
+    best_p = &(filter_p->samples[0]);
+    for (uint8_t i=1; i < filter_p->count; i++){
+        if (filter_p->samples[i].delay < best_p->delay){
+            best_p = &(filter_p->samples[i]);
+        }
+    }
+    for (uint8_t i=0; i < filter_p->count; i++){
+        sample_p = &(filter_p->samples[i]);
+        deviation += tm_sync_abs(sample_p->offset - best_p->offset);
+        if (2 * tm_sync_abs(sample_p->offset - best_p->offset) <= 
+                sample_p->delay + best_p->delay){
+            agree ++;
+        }
+    }
+    filter_p->offset = best_p->offset;
+    filter_p->delay = best_p->delay;
+    filter_p->jitter = (filter_p->count > 1) ? 
+                       deviation / (filter_p->count - 1) : 0;
+
+    // Only samples newer than the last one applied, and consistent with 
+    // most of the others, are applied.
+    if ((int16_t)(best_p->seq - filter_p->applied_seq) <= 0 || 
+            2 * agree <= filter_p->count){
+        filter_p->held ++;
+        return 0;
+    }
+    filter_p->applied_seq = best_p->seq;
+    *correction_p = -best_p->offset;
+    tm_sync_filter_shift(filter_p, *correction_p);
+    return 1;
+}
+
+#endif
+
+
+#if TIME_ENABLE_SYNC_SERVO
+
+#define TM_SYNC_SERVO_TAU   ((tm_sdelta_t)TIME_SYNC_SERVO_TAU * TIME_TICKS_PER_SECOND)
+
+void tm_sync_servo_reset(tm_sync_servo_t * servo_p){
+    tm_sdelta_t zero = 0;
+    servo_p->last = 0;
+    servo_p->seen = 0;
+    servo_p->drift = 0;
+    servo_p->state = TM_SYNC_CLOCK_UNSYNCED;
+    servo_p->lock_count = 0;
+    servo_p->slews = 0;
+    servo_p->steps = 0;
+    tm_slew_time(&zero);
+    tm_slew_frequency(0);
+}
+
+
+uint8_t tm_sync_servo_update(tm_sync_servo_t * servo_p, 
+                             tm_sdelta_t * correction_p){
+    tm_system_t now;
+    tm_sdelta_t interval, residual;
+    int32_t pending;
+
+    critical_enter();
+    now = tm_current;
+    pending = tm_slew.phase;
+    critical_exit();
+    interval = now - servo_p->last;
+    servo_p->last = now;
+    servo_p->seen = now;
+
+    if (*correction_p > TIME_SYNC_STEP_THRESHOLD || 
+            *correction_p < -TIME_SYNC_STEP_THRESHOLD){
+        residual = 0;
+        tm_slew_time(&residual);
+        servo_p->state = TM_SYNC_CLOCK_LOCKING;
+        servo_p->lock_count = 0;
+        servo_p->steps ++;
+        return 1;
+    }
+
+    // The error left once the pending slew completes is that accumulated 
+    // from the frequency error since the last correction.
+    if (servo_p->state != TM_SYNC_CLOCK_UNSYNCED && interval > 0){
+        residual = (*correction_p - pending) * TM_SLEW_PPB / interval;
+        if (interval < TM_SYNC_SERVO_TAU){
+            residual = residual * interval / TM_SYNC_SERVO_TAU;
+        }
+        residual += tm_slew.freq;
+        if (residual > TM_SLEW_FREQ_MAX){
+            residual = TM_SLEW_FREQ_MAX;
+        }
+        else if (residual < -TM_SLEW_FREQ_MAX){
+            residual = -TM_SLEW_FREQ_MAX;
+        }
+        tm_slew_frequency((int32_t)residual);
+    }
+    tm_slew_time(correction_p);
+    servo_p->slews ++;
+
+    if (*correction_p > TIME_SYNC_LOCK_THRESHOLD || 
+            *correction_p < -TIME_SYNC_LOCK_THRESHOLD){
+        servo_p->state = TM_SYNC_CLOCK_LOCKING;
+        servo_p->lock_count = 0;
+    }
+    else if (servo_p->state == TM_SYNC_CLOCK_LOCKED || 
+                servo_p->state == TM_SYNC_CLOCK_HOLDOVER){
+        servo_p->state = TM_SYNC_CLOCK_LOCKED;
+        servo_p->drift += (tm_slew.freq - servo_p->drift) / 8;
+    }
+    else{
+        servo_p->state = TM_SYNC_CLOCK_LOCKING;
+        if (++servo_p->lock_count >= TM_SYNC_LOCK_COUNT){
+            servo_p->state = TM_SYNC_CLOCK_LOCKED;
+            servo_p->drift = tm_slew.freq;
+        }
+    }
+    return 0;
+}
+
+
+void tm_sync_servo_hold(tm_sync_servo_t * servo_p){
+    tm_current_time(&(servo_p->seen));
+}
+
+
+uint8_t tm_sync_servo_state(tm_sync_servo_t * servo_p){
+    tm_system_t now;
+    if (servo_p->state == TM_SYNC_CLOCK_LOCKED){
+        tm_current_time(&now);
+        if (now - servo_p->seen > 
+                (tm_sdelta_t)TIME_SYNC_HOLDOVER_TIMEOUT * TIME_TICKS_PER_SECOND){
+            servo_p->state = TM_SYNC_CLOCK_HOLDOVER;
+            tm_slew_frequency(servo_p->drift);
+        }
+    }
+    return servo_p->state;
+}
+
+#endif
+
+
+#if TIME_SYNC_ERROR_BUDGET
+
+#define TM_SYNC_AUTO_PPB    1000000000LL
+
+void tm_sync_auto_reset(tm_sync_auto_t * auto_p){
+    auto_p->last = 0;
+    auto_p->due = 0;
+    auto_p->rate = 0;
+    auto_p->interval = TIME_SYNC_INTERVAL_MIN;
+    auto_p->requests = 0;
+}
+
+
+void tm_sync_auto_update(tm_sync_auto_t * auto_p, tm_sdelta_t offset, 
+                         tm_sdelta_t delay){
+    tm_system_t now;
+    tm_sdelta_t elapsed, rate, margin, horizon;
+    uint32_t interval = auto_p->interval;
+
+    if (offset < 0){
+        offset = -offset;
+    }
+    tm_current_time(&now);
+    elapsed = now - auto_p->last;
+    if (auto_p->last && elapsed > 0){
+        // Rises in the rate are followed at once, falls slowly.
+        rate = offset * TM_SYNC_AUTO_PPB / elapsed;
+        if (rate > UINT32_MAX){
+            rate = UINT32_MAX;
+        }
+        if (rate >= auto_p->rate){
+            auto_p->rate = (uint32_t)rate;
+        }
+        else{
+            auto_p->rate -= (auto_p->rate - (uint32_t)rate) / 4;
+        }
+    }
+    auto_p->last = now;
+
+    if (offset > TIME_SYNC_ERROR_BUDGET){
+        interval /= 2;
+    }
+    else if (interval <= TIME_SYNC_INTERVAL_MAX / 2){
+        interval *= 2;
+    }
+    else{
+        interval = TIME_SYNC_INTERVAL_MAX;
+    }
+
+    // The time, in s, at which the predicted error reaches the budget.
+    margin = TIME_SYNC_ERROR_BUDGET - delay / 2;
+    if (margin <= 0){
+        interval = TIME_SYNC_INTERVAL_MIN;
+    }
+    else if (auto_p->rate){
+        horizon = margin * (TM_SYNC_AUTO_PPB / TIME_TICKS_PER_SECOND) / auto_p->rate;
+        if (horizon < interval){
+            interval = (uint32_t)horizon;
+        }
+    }
+    if (interval < TIME_SYNC_INTERVAL_MIN){
+        interval = TIME_SYNC_INTERVAL_MIN;
+    }
+    auto_p->interval = interval;
+    auto_p->due = now + (tm_sdelta_t)interval * TIME_TICKS_PER_SECOND;
+}
+
+
+uint8_t tm_sync_auto_poll(void){
+    tm_system_t now;
+    if (ucdm_exception_status & UCDM_EXST_TIMESYNC_REQ){
+        return 0;
+    }
+    tm_current_time(&now);
+    if (tm_sync_clock.autosync.last && now < tm_sync_clock.autosync.due){
+        return 0;
+    }
+    tm_sync_request_host();
+    tm_sync_clock.autosync.requests ++;
+    return 1;
+}
+
+#endif
+
+
+static inline void tm_sync_capture_time(uint16_t sub_us, tm_system_t * time_p);
+
+static inline void tm_sync_capture_time(uint16_t sub_us, tm_system_t * time_p){
+    tm_current_time(time_p);
+    if (sub_us >= TIME_SYSTICK_PERIOD_uS / 2){
+        (*time_p) ++;
+    }
+}
+
+
+void tm_sync_instance_capture_rx(tm_sync_sm_t * sm_p, uint16_t sub_us){
+    tm_sync_capture_time(sub_us, &(sm_p->rx.time));
+    sm_p->rx.valid = 1;
+}
+
+
+void tm_sync_instance_capture_tx(tm_sync_sm_t * sm_p, uint16_t sub_us){
+    if (sm_p->tx_p){
+        tm_sync_capture_time(sub_us, sm_p->tx_p);
+        sm_p->tx_p = NULL;
+    }
 }
 
 
-static inline void tm_sync_apply(void);
+/**
+ * @brief Get the time of receipt of the register write being handled.
+ */
+static inline void tm_sync_rx_time(tm_sync_sm_t * sm_p, tm_system_t * time_p);
 
-static inline void tm_sync_apply(void){
+static inline void tm_sync_rx_time(tm_sync_sm_t * sm_p, tm_system_t * time_p){
+    if (sm_p->rx.valid){
+        *time_p = sm_p->rx.time;
+        sm_p->rx.valid = 0;
+    }
+    else{
+        tm_current_time(time_p);
+    }
+}
+
+
+static int32_t tm_sync_clamp(tm_sdelta_t value);
+
+static int32_t tm_sync_clamp(tm_sdelta_t value){
+    if (value > INT32_MAX){
+        return INT32_MAX;
+    }
+    if (value < -INT32_MAX){
+        return -INT32_MAX;
+    }
+    return (int32_t)value;
+}
+
+
+static uint16_t tm_sync_since_read(ucdm_addr_t address){
+    tm_sync_sm_t * sm_p = tm_sync_find(address);
+    tm_system_t now;
+    tm_sdelta_t since;
+    uint32_t value = UINT32_MAX;
+    if (sm_p->telemetry.samples){
+        tm_current_time(&now);
+        since = (now - sm_p->last_sync) / TIME_TICKS_PER_SECOND;
+        if (since < UINT32_MAX){
+            value = (since < 0) ? 0 : (uint32_t)since;
+        }
+    }
+    if (address == sm_p->address + TM_SYNC_UCDM_SINCE){
+        return (uint16_t)value;
+    }
+    return (uint16_t)(value >> 16);
+}
+
+
+static inline void tm_sync_record(tm_sync_sm_t * sm_p, tm_sdelta_t tsd1, 
+                                  tm_sdelta_t tsd2);
+
+static inline void tm_sync_record(tm_sync_sm_t * sm_p, tm_sdelta_t tsd1, 
+                                  tm_sdelta_t tsd2){
+    tm_sync_telemetry_t * telemetry_p = &(sm_p->telemetry);
+    tm_current_time(&(sm_p->last_sync));
+    telemetry_p->offset = tm_sync_clamp((tsd1 - tsd2) / 2);
+    telemetry_p->delay = tm_sync_clamp((tsd1 + tsd2) / 2);
+    if (telemetry_p->samples < UINT32_MAX){
+        telemetry_p->samples ++;
+    }
+}
+
+
+/**
+ * @brief Get the quality of a sync instance. Lower is better. 
+ */
+static inline tm_sdelta_t tm_sync_quality(tm_sync_sm_t * sm_p);
+
+static inline tm_sdelta_t tm_sync_quality(tm_sync_sm_t * sm_p){
+    #if TIME_SYNC_FILTER_LEN
+    return sm_p->filter.delay / 2 + sm_p->filter.jitter;
+    #else
+    return sm_p->telemetry.delay;
+    #endif
+}
+
+
+/**
+ * @brief Select the source of the clock, following an exchange completed 
+ *        on the given instance. 
+ * 
+ * @return 1 if the instance is selected, 0 otherwise.
+ */
+static uint8_t tm_sync_select(tm_sync_sm_t * sm_p);
+
+static uint8_t tm_sync_select(tm_sync_sm_t * sm_p){
+    tm_sync_sm_t * selected_p = tm_sync_clock.selected;
+    tm_system_t now;
+    if (selected_p == sm_p){
+        return 1;
+    }
+    if (selected_p){
+        tm_current_time(&now);
+        if (now - selected_p->last_sync <= 
+                (tm_sdelta_t)TIME_SYNC_HOLDOVER_TIMEOUT * TIME_TICKS_PER_SECOND){
+            if (tm_sync_quality(sm_p) + TIME_SYNC_SELECT_MARGIN >= 
+                    tm_sync_quality(selected_p)){
+                if (tm_sync_clock.candidate == sm_p){
+                    tm_sync_clock.candidate = NULL;
+                }
+                return 0;
+            }
+            if (tm_sync_clock.candidate != sm_p){
+                tm_sync_clock.candidate = sm_p;
+                tm_sync_clock.candidate_count = 0;
+            }
+            if (++tm_sync_clock.candidate_count < TIME_SYNC_SELECT_HOLD){
+                return 0;
+            }
+        }
+        tm_sync_clock.switches ++;
+    }
+    tm_sync_clock.candidate = NULL;
+    tm_sync_clock.selected = sm_p;
+    return 1;
+}
+
+
+/**
+ * @brief Keep the other instances consistent with a correction applied 
+ *        to the local clock through the given one. 
+ */
+static void tm_sync_follow(tm_sync_sm_t * sm_p, tm_sdelta_t correction, 
+                           uint8_t step);
+
+static void tm_sync_follow(tm_sync_sm_t * sm_p, tm_sdelta_t correction, 
+                           uint8_t step){
+    tm_sync_sm_t * other_p = tm_sync_clock.instances;
+    while (other_p){
+        if (other_p != sm_p){
+            #if TIME_SYNC_FILTER_LEN
+            tm_sync_filter_shift(&(other_p->filter), correction);
+            #endif
+            if (step){
+                // Local timestamps of exchanges in progress.
+                other_p->t1p += correction;
+                other_p->t2 += correction;
+                other_p->rx.time += correction;
+                #if TIME_ENABLE_SYNC_BLOCK
+                other_p->block_t1p += correction;
+                other_p->block_t2 += correction;
+                #endif
+            }
+        }
+        other_p = other_p->next;
+    }
+}
+
+
+/**
+ * @brief Calculate and apply the correction from a completed exchange.
+ * 
+ * The correction is only applied if the instance is selected. 
+ * 
+ * @return The correction stepped into the system time, or 0 if it was 
+ *         slewed or held.
+ */
+static inline tm_sdelta_t tm_sync_apply(tm_sync_sm_t * sm_p);
+
+static inline tm_sdelta_t tm_sync_apply(tm_sync_sm_t * sm_p){
     tm_sdelta_t offset, tsd1, tsd2;
+    uint8_t step = 1;
+    #if TIME_SYNC_FILTER_LEN
+    uint16_t applied_seq = sm_p->filter.applied_seq;
+    #endif
 
-    tm_get_sdelta(&(tm_sync_sm.t1), &(tm_sync_sm.t1p), &(tsd1));
-    tm_get_sdelta(&(tm_sync_sm.t2), &(tm_sync_sm.t2p), &(tsd2));
+    tm_get_sdelta(&(sm_p->t1), &(sm_p->t1p), &(tsd1));
+    tm_get_sdelta(&(sm_p->t2), &(sm_p->t2p), &(tsd2));
+    tm_sync_record(sm_p, tsd1, tsd2);
+    
+    #if TIME_SYNC_FILTER_LEN
+    step = tm_sync_filter_add(&(sm_p->filter), tsd1, tsd2, &offset);
+    sm_p->telemetry.jitter = (uint32_t)tm_sync_clamp(sm_p->filter.jitter);
+    #else
+    offset = -(tsd1 - tsd2) / 2;
+    #endif
+    
+    if (!tm_sync_select(sm_p)){
+        // Only the selected instance steers the clock.
+        #if TIME_SYNC_FILTER_LEN
+        if (step){
+            tm_sync_filter_shift(&(sm_p->filter), -offset);
+            sm_p->filter.applied_seq = applied_seq;
+        }
+        #endif
+        #if TIME_ENABLE_SYNC_SERVO
+        sm_p->telemetry.state = tm_sync_servo_state(&(tm_sync_clock.servo));
+        #endif
+        return 0;
+    }
+    
+    ucdm_exception_status &= ~UCDM_EXST_TIMESYNC_REQ;
+    #if TIME_SYNC_ERROR_BUDGET
+    tm_sync_auto_update(&(tm_sync_clock.autosync), (tsd1 - tsd2) / 2, tsd1 + tsd2);
+    #endif
+    
+    if (!step){
+        #if TIME_ENABLE_SYNC_SERVO
+        tm_sync_servo_hold(&(tm_sync_clock.servo));
+        sm_p->telemetry.state = tm_sync_servo_state(&(tm_sync_clock.servo));
+        #endif
+        return 0;
+    }
+    
+    #if TIME_ENABLE_SYNC_SERVO
+    step = tm_sync_servo_update(&(tm_sync_clock.servo), &offset);
+    sm_p->telemetry.state = tm_sync_servo_state(&(tm_sync_clock.servo));
+    #endif
+    tm_sync_follow(sm_p, offset, step);
     
-    offset = (tsd1 - tsd2)/ 2;
+    if (!step){
+        return 0;
+    }
     
     critical_enter();
     tm_apply_sdelta((tm_system_t *)&tm_current, &offset);
     critical_exit();
 
-    tm_epochchange_handler_t * echandler = epoch_handlers_root;
-    while(echandler){
-        echandler -> func(&offset);
-        echandler = echandler->next;
-    }
+    tm_epoch_change_post(&offset, 1);
+    return offset;
 }
 
 uint16_t tm_sync_host_read_hook(ucdm_addr_t address){
-    if (tm_sync_sm.state == TM_SYNC_STATE_WAIT_DELAY_OUT){
-        tm_sync_sm.state = TM_SYNC_STATE_WAIT_DELAY_IN;
+    tm_sync_sm_t * sm_p = tm_sync_find(address);
+    if (sm_p->state == TM_SYNC_STATE_WAIT_DELAY_OUT){
+        sm_p->state = TM_SYNC_STATE_WAIT_DELAY_IN;
         // Host read our timestamp for delay calculation.
         // Store the timestamp sent out
-        tm_current_time(&(tm_sync_sm.t2));
+        tm_current_time(&(sm_p->t2));
+        sm_p->tx_p = &(sm_p->t2);
     }
     return 0;
 }
 
-static inline void tm_redirect_next_host_ts(tm_system_t * target){
+static inline void tm_redirect_next_host_ts(tm_sync_sm_t * sm_p, 
+                                            tm_system_t * target){
+    ucdm_addr_t address = sm_p->address + TM_SYNC_UCDM_HOST_TS;
     for (uint8_t i=0; i < (sizeof(tm_system_t) / 2); i++){
-        ucdm_register[ucdm_addr_sync_host_ts + i].ptr = (uint16_t *)target + i;
+        ucdm_register[address + i].ptr = (uint16_t *)target + i;
     }
 }
 
 void tm_sync_handler(ucdm_addr_t addr){
-    switch(tm_sync_sm.state){
+    tm_sync_sm_t * sm_p = tm_sync_find(addr);
+    switch(sm_p->state){
         case TM_SYNC_STATE_PREINIT:
             break;
+        case TM_SYNC_STATE_WAIT_HOST:
         case TM_SYNC_STATE_IDLE:
-            if (ucdm_register[addr].data){
+            if (sm_p->t1){
                 // Got sync with timestamp from the host. 
-                tm_sync_sm.state = TM_SYNC_STATE_WAIT_DELAY_OUT;
-                tm_redirect_next_host_ts(&tm_sync_sm.t2p);
+                sm_p->state = TM_SYNC_STATE_WAIT_DELAY_OUT;
+                tm_redirect_next_host_ts(sm_p, &(sm_p->t2p));
             } else { 
                 // Got sync without timestamp from the host. 
-                tm_sync_sm.state = TM_SYNC_STATE_WAIT_FOLLOW_UP;
+                sm_p->state = TM_SYNC_STATE_WAIT_FOLLOW_UP;
             }
-            tm_current_time(&(tm_sync_sm.t1p));
+            tm_sync_rx_time(sm_p, &(sm_p->t1p));
             break;
         case TM_SYNC_STATE_WAIT_FOLLOW_UP:
             // Got the sync timestamp from the host. 
-            tm_sync_sm.state = TM_SYNC_STATE_WAIT_DELAY_OUT;
-            tm_redirect_next_host_ts(&tm_sync_sm.t2p);
+            sm_p->state = TM_SYNC_STATE_WAIT_DELAY_OUT;
+            tm_redirect_next_host_ts(sm_p, &(sm_p->t2p));
             break;
         case TM_SYNC_STATE_WAIT_DELAY_OUT:
             // This is handled in the register read function for the 
@@ -143,11 +746,10 @@ void tm_sync_handler(ucdm_addr_t addr){
             break;
         case TM_SYNC_STATE_WAIT_DELAY_IN:
             // Host returned its timestamp for delay calculation.
-            tm_redirect_next_host_ts(&tm_sync_sm.t1);
-            tm_sync_sm.state = TM_SYNC_STATE_IDLE;
+            tm_redirect_next_host_ts(sm_p, &(sm_p->t1));
+            sm_p->state = TM_SYNC_STATE_IDLE;
             // All information is now available. Calculate and apply.
-            tm_sync_apply();
-            ucdm_exception_status &= ~UCDM_EXST_TIMESYNC_REQ;
+            tm_sync_apply(sm_p);
             // TODO Schedule update of RTC in main loop from here
             break;
         default:
@@ -156,4 +758,38 @@ void tm_sync_handler(ucdm_addr_t addr){
     return;
 }
 
-#endif
\ No newline at end of file
+#if TIME_ENABLE_SYNC_BLOCK
+
+static uint16_t tm_sync_block_read_hook(ucdm_addr_t address){
+    tm_sync_sm_t * sm_p = tm_sync_find(address);
+    if (sm_p->block_state == TM_SYNC_BLOCK_WAIT_DELAY_OUT){
+        tm_current_time(&(sm_p->block_t2));
+        sm_p->tx_p = &(sm_p->block_t2);
+        sm_p->block_state = TM_SYNC_BLOCK_WAIT_SYNC;
+    }
+    return 0;
+}
+
+void tm_sync_block_handler(ucdm_addr_t addr){
+    tm_sync_sm_t * sm_p = tm_sync_find(addr);
+    tm_system_t t1p;
+    tm_sync_rx_time(sm_p, &t1p);
+
+    // The previous exchange is complete if the host has returned the 
+    // time at which it received our delay timestamp.
+    if (sm_p->block_state == TM_SYNC_BLOCK_WAIT_SYNC && sm_p->block.t2p){
+        sm_p->t1 = sm_p->block_t1;
+        sm_p->t1p = sm_p->block_t1p;
+        sm_p->t2 = sm_p->block_t2;
+        sm_p->t2p = sm_p->block.t2p;
+        // A stepped correction also applies to the new exchange.
+        t1p += tm_sync_apply(sm_p);
+    }
+    sm_p->block_t1 = sm_p->block.t1;
+    sm_p->block_t1p = t1p;
+    sm_p->block_state = TM_SYNC_BLOCK_WAIT_DELAY_OUT;
+}
+
+#endif
+
+#endif
@@ -113,19 +113,577 @@
 #include <ds/avltree.h>
 #include "time.h"
 
+#if TIME_SYNC_FILTER_LEN
+
+/**
+ * @name Clock Filter
+ * 
+ * Each completed exchange produces a sample of the offset of the local 
+ * clock from that of the host, along with the round trip delay of the 
+ * exchange. Any delay in the transport, and in particular any asymmetry 
+ * in it, appears as error in the offset, and the error of a sample is 
+ * at most half its round trip delay. 
+ * 
+ * The last TIME_SYNC_FILTER_LEN samples are kept in a ring, and the one 
+ * with the least delay is selected, as with the NTP clock filter. The 
+ * selected sample is only applied if it has not been applied before, 
+ * and if it is consistent with a majority of the samples in the ring, 
+ * ie, if its error bounds overlap with theirs. Otherwise, the clock is 
+ * held. When a correction is applied, the offsets of the samples in the 
+ * ring are adjusted by the same amount. 
+ * 
+ * The jitter is the mean absolute deviation of the offsets of the 
+ * samples in the ring from that of the selected sample. 
+ * 
+ * Setting TIME_SYNC_FILTER_LEN to 0 disables the filter, and every 
+ * exchange is applied as it is.
+ */
+/**@{*/ 
+
+typedef struct TM_SYNC_SAMPLE_t{
+    tm_sdelta_t offset;
+    tm_sdelta_t delay;
+    uint16_t seq;
+} tm_sync_sample_t;
+
+typedef struct TM_SYNC_FILTER_t{
+    tm_sync_sample_t samples[TIME_SYNC_FILTER_LEN];
+    uint8_t head;
+    uint8_t count;
+    uint16_t seq;
+    uint16_t applied_seq;
+    tm_sdelta_t offset;
+    tm_sdelta_t delay;
+    tm_sdelta_t jitter;
+    uint32_t held;
+} tm_sync_filter_t;
+
+/**
+ * @brief Clear all samples from a clock filter.
+ */
+void tm_sync_filter_reset(tm_sync_filter_t * filter_p);
+
+/**
+ * @brief Adjust the offsets of the samples of a clock filter for a 
+ *        correction applied to the local clock.
+ */
+void tm_sync_filter_shift(tm_sync_filter_t * filter_p, tm_sdelta_t correction);
+
+/**
+ * @brief Add the sample from an exchange to a clock filter.
+ * 
+ * @param filter_p Pointer to the filter.
+ * @param tsd1 Local time of receipt less host time of transmission of 
+ *             the sync timestamp (t1p - t1).
+ * @param tsd2 Host time of receipt less local time of transmission of 
+ *             the delay timestamp (t2p - t2).
+ * @param correction_p Pointer to the tm_sdelta_t in which to store the 
+ *                     correction to apply to the local clock.
+ * @return 1 if the correction is to be applied, 0 if the clock is held.
+ */
+uint8_t tm_sync_filter_add(tm_sync_filter_t * filter_p, tm_sdelta_t tsd1, 
+                           tm_sdelta_t tsd2, tm_sdelta_t * correction_p);
+
+/**@}*/ 
+
+#endif
+
+#if TIME_ENABLE_SYNC_SERVO
+
+/**
+ * @name Clock Servo
+ * 
+ * Applications enabling this functionality must ensure 
+ * TIME_ENABLE_SYNC_SERVO is defined and non-zero, usually by defining 
+ * APP_ENABLE_TIME_SYNC_SERVO in application.h.
+ * 
+ * Without the servo, each correction steps the system time and notifies 
+ * all the epoch change handlers. With it, corrections no larger than 
+ * TIME_SYNC_STEP_THRESHOLD ms are slewed into the system time by the 
+ * system tick handler instead, so that cron jobs and stored timestamps 
+ * see continuous time. See `tm_slew_time()`. Larger corrections are 
+ * still stepped. 
+ * 
+ * The servo is a proportional-integral controller. The proportional term 
+ * is the correction itself, which is slewed in full. The integral term is 
+ * the frequency correction. The error which remains once the slew in 
+ * progress is complete is that due to the frequency error over the 
+ * interval T since the last correction, and the frequency correction is 
+ * moved towards cancelling it by a gain of T / TIME_SYNC_SERVO_TAU, with 
+ * T no longer than the time constant TIME_SYNC_SERVO_TAU (in s). 
+ * The frequency error measured over short intervals is dominated by the 
+ * 1 ms resolution of the system time, and the gain keeps it from being 
+ * followed too closely. 
+ * 
+ * The frequency correction is the estimate of the drift of the local 
+ * oscillator, and is applied continuously by the system tick handler, 
+ * including between exchanges. While locked, it is also averaged into 
+ * `drift`, in ppb. 
+ * 
+ * The servo runs a clock state machine : 
+ * 
+ *   - UNSYNCED, until the first correction is received.
+ *   - LOCKING, after a step, or while corrections are larger than 
+ *     TIME_SYNC_LOCK_THRESHOLD ms. 
+ *   - LOCKED, once TM_SYNC_LOCK_COUNT successive corrections are within 
+ *     TIME_SYNC_LOCK_THRESHOLD ms. 
+ *   - HOLDOVER, when no exchange has been completed for 
+ *     TIME_SYNC_HOLDOVER_TIMEOUT s while locked. The frequency correction 
+ *     is replaced by the averaged drift, which is the last good estimate, 
+ *     and continues to be applied until the host returns. 
+ * 
+ * The holdover timeout is checked by `tm_sync_servo_state()`, which the 
+ * application should call periodically. 
+ */
+/**@{*/ 
+
+#define TM_SYNC_CLOCK_UNSYNCED      0
+#define TM_SYNC_CLOCK_LOCKING       1
+#define TM_SYNC_CLOCK_LOCKED        2
+#define TM_SYNC_CLOCK_HOLDOVER      3
+
+#define TM_SYNC_LOCK_COUNT          4
+
+typedef struct TM_SYNC_SERVO_t{
+    tm_system_t last;
+    tm_system_t seen;
+    int32_t drift;
+    uint8_t state;
+    uint8_t lock_count;
+    uint32_t slews;
+    uint32_t steps;
+} tm_sync_servo_t;
+
+/**
+ * @brief Reset a clock servo, clearing the frequency correction.
+ */
+void tm_sync_servo_reset(tm_sync_servo_t * servo_p);
+
+/**
+ * @brief Provide a correction of the local clock to a clock servo.
+ * 
+ * @param servo_p Pointer to the servo.
+ * @param correction_p Pointer to the correction to the local clock.
+ * @return 1 if the correction is to be stepped by the caller, 0 if it 
+ *         has been slewed.
+ */
+uint8_t tm_sync_servo_update(tm_sync_servo_t * servo_p, 
+                             tm_sdelta_t * correction_p);
+
+/**
+ * @brief Notify a clock servo of an exchange which did not produce a 
+ *        correction, such as one held by the clock filter.
+ * 
+ * @param servo_p Pointer to the servo.
+ */
+void tm_sync_servo_hold(tm_sync_servo_t * servo_p);
+
+/**
+ * @brief Get the clock state of a clock servo, entering holdover if the 
+ *        host has gone away.
+ * 
+ * @param servo_p Pointer to the servo.
+ * @return One of the TM_SYNC_CLOCK_ definitions.
+ */
+uint8_t tm_sync_servo_state(tm_sync_servo_t * servo_p);
+
+/**@}*/ 
+
+#endif
+
+#if TIME_SYNC_ERROR_BUDGET
+
+/**
+ * @name Automatic Sync Requests
+ * 
+ * Applications enabling this functionality must ensure 
+ * TIME_SYNC_ERROR_BUDGET is defined and non-zero, usually by defining 
+ * APP_TIME_SYNC_ERROR_BUDGET in application.h. It is the error of the 
+ * local clock, in ms, which the application is prepared to tolerate. 
+ * 
+ * Instead of the application calling `tm_sync_request_host()` when it 
+ * thinks it may need to, `tm_sync_auto_poll()` raises the sync request 
+ * when the predicted error of the local clock approaches the budget. 
+ * 
+ * The offset measured by each exchange is the error accumulated since 
+ * the one before it. Divided by the time between them, it is the rate 
+ * at which the error grows, which is the drift of the local oscillator 
+ * not already corrected for, by the servo or otherwise. The estimate 
+ * follows increases of the rate at once, and decreases slowly. The 
+ * error just after an exchange is taken to be up to half its round 
+ * trip delay. 
+ * 
+ * After each exchange, the time to the next request is : 
+ * 
+ *   - halved, if the measured offset exceeded the budget. 
+ *   - doubled otherwise, so that a stable clock is synced less and 
+ *     less often. 
+ *   - limited to the time at which the predicted error reaches the 
+ *     budget. 
+ *   - kept between TIME_SYNC_INTERVAL_MIN and TIME_SYNC_INTERVAL_MAX s. 
+ * 
+ * Until the first exchange completes, the request is raised at every 
+ * poll. 
+ */
+/**@{*/ 
+
+typedef struct TM_SYNC_AUTO_t{
+    tm_system_t last;
+    tm_system_t due;
+    uint32_t rate;
+    uint32_t interval;
+    uint32_t requests;
+} tm_sync_auto_t;
+
+/**
+ * @brief Reset the automatic sync request state.
+ */
+void tm_sync_auto_reset(tm_sync_auto_t * auto_p);
+
+/**
+ * @brief Provide the result of a completed exchange, and schedule the 
+ *        next request.
+ * 
+ * @param auto_p Pointer to the automatic sync request state.
+ * @param offset Measured offset of the local clock, in ms. 
+ * @param delay Measured round trip delay, in ms.
+ */
+void tm_sync_auto_update(tm_sync_auto_t * auto_p, tm_sdelta_t offset, 
+                         tm_sdelta_t delay);
+
+/**@}*/ 
+
+#endif
+
+/**
+ * @brief Sync Telemetry Type
+ * 
+ * Sync quality, mapped to read-only UCDM registers following the host 
+ * timestamp registers, in the same word order as the system time 
+ * registers. These are followed by two more registers holding the time 
+ * since the last exchange in s, as a uint32_t, which is computed when 
+ * read. It reads as UINT32_MAX before the first exchange. 
+ * 
+ *   - offset  : offset of the local clock from the host in the last 
+ *               exchange, in ms, before correction. 
+ *   - delay   : mean path delay of the last exchange (half the round 
+ *               trip delay), in ms. 
+ *   - jitter  : jitter of the clock filter in ms, or 0 without it. 
+ *   - samples : number of exchanges completed. 
+ *   - state   : clock state of the servo, or 0 without it. 
+ * 
+ * Values which do not fit are saturated. 
+ */
+typedef struct TM_SYNC_TELEMETRY_t{
+    int32_t offset;
+    int32_t delay;
+    uint32_t jitter;
+    uint32_t samples;
+    uint16_t state;
+} tm_sync_telemetry_t;
+
+#if TIME_ENABLE_SYNC_BLOCK
+
+/**
+ * @name Block Mode
+ * 
+ * Applications enabling this functionality must ensure 
+ * TIME_ENABLE_SYNC_BLOCK is defined and non-zero, usually by defining 
+ * APP_ENABLE_TIME_SYNC_BLOCK in application.h. 
+ * 
+ * In the standard mode, each host timestamp is written as a separate 
+ * sequence of register writes, and a full exchange takes about a dozen 
+ * bus transactions, each of which adds to the delay, and to its 
+ * asymmetry. Block mode instead uses one block write and one block read 
+ * per exchange, with registers following the telemetry registers : 
+ * 
+ *   - One read hook register. 
+ *   - A tm_sync_block_t, written by the host in a single block write. The 
+ *     write of its last register is the trigger. 
+ * 
+ * An exchange proceeds as follows : 
+ * 
+ *   - The host writes the block, with `t1` set to the time at which it 
+ *     sends it. The local time of receipt is recorded as t1p. 
+ *   - The host reads the read hook register. The local time at which it 
+ *     is read is recorded as t2, and the host records the time at which 
+ *     it receives the response as t2p. 
+ *   - The host returns t2p in the `t2p` of its next block write, which 
+ *     also starts the next exchange. The previous exchange is then 
+ *     complete, and is applied. 
+ * 
+ * `t2p` should be written as 0 if the host has no delay measurement to 
+ * return, such as at the first exchange. 
+ */
+/**@{*/ 
+
+#define TM_SYNC_BLOCK_IDLE           0
+#define TM_SYNC_BLOCK_WAIT_DELAY_OUT 1
+#define TM_SYNC_BLOCK_WAIT_SYNC      2
+
+typedef struct TM_SYNC_BLOCK_t{
+    tm_system_t t1;
+    tm_system_t t2p;
+} tm_sync_block_t;
+
+/**@}*/ 
+
+#endif
+
+/**
+ * @brief Capture Timestamp Type
+ * 
+ * A receive timestamp latched by the transport. See `tm_sync_capture_rx()`.
+ */
+typedef struct TM_SYNC_CAPTURE_t{
+    tm_system_t time;
+    uint8_t valid;
+} tm_sync_capture_t;
+
+/**
+ * @name UCDM Register Layout
+ * 
+ * Offsets of the sync registers from the address provided to 
+ * `tm_sync_init()`. Host implementations must use the same sizes of 
+ * the exchanged types as the device. 
+ */
+/**@{*/ 
+
+#define TM_SYNC_UCDM_HOOK            0
+#define TM_SYNC_UCDM_HOST_TS         2
+#define TM_SYNC_UCDM_TELEMETRY       (TM_SYNC_UCDM_HOST_TS + sizeof(tm_system_t) / 2)
+#define TM_SYNC_UCDM_SINCE           (TM_SYNC_UCDM_TELEMETRY + sizeof(tm_sync_telemetry_t) / 2)
+#if TIME_ENABLE_SYNC_BLOCK
+#define TM_SYNC_UCDM_BLOCK_HOOK      (TM_SYNC_UCDM_SINCE + 2)
+#define TM_SYNC_UCDM_BLOCK           (TM_SYNC_UCDM_BLOCK_HOOK + 1)
+#endif
+
+/**@}*/ 
+
+/**
+ * @name Sync Instances
+ * 
+ * Each sync instance is an independent set of sync registers, with its 
+ * own state machine, clock filter and telemetry, through which a host 
+ * can sync the local clock. A device reachable over more than one 
+ * interface, such as a main bus and a debug link, can provide an 
+ * instance on each. 
+ * 
+ * `tm_sync_init()` sets up the default instance, `tm_sync_sm`, and is 
+ * called by `tm_init()`. Further instances are set up by the 
+ * application using `tm_sync_instance_init()`, with registers at 
+ * addresses of its choosing. Functions without an instance argument 
+ * operate on the default instance. 
+ * 
+ * The local clock, its servo and the automatic sync requests are shared 
+ * by all instances, in `tm_sync_clock`. Only the selected instance 
+ * steers the clock. Exchanges on the other instances only update their 
+ * own filters and telemetry, which are kept consistent with corrections 
+ * applied through the selected one. When an exchange completes, its 
+ * instance is selected if : 
+ * 
+ *   - no instance is selected yet, 
+ *   - the selected instance has not completed an exchange for 
+ *     TIME_SYNC_HOLDOVER_TIMEOUT s, or 
+ *   - its quality has been better than that of the selected one by more 
+ *     than TIME_SYNC_SELECT_MARGIN ms on TIME_SYNC_SELECT_HOLD of its 
+ *     exchanges in a row. 
+ * 
+ * Quality is the error bound of the selected sample of the filter, ie, 
+ * half its round trip delay plus the jitter, or half the round trip 
+ * delay of the last exchange without the filter. Lower is better. The 
+ * margin and hold keep two sources of similar quality from trading the 
+ * clock back and forth, since each switch can move it by up to the 
+ * difference in their offsets. 
+ */
+/**@{*/ 
+
 typedef struct TM_SYNC_SM_t{
+    struct TM_SYNC_SM_t * next;
+    ucdm_addr_t address;
+    ucdm_addr_t end;
+    avlt_node_t handler_node;
     uint8_t state;
     tm_system_t t1;
     tm_system_t t1p;
     tm_system_t t2;
     tm_system_t t2p;
+#if TIME_SYNC_FILTER_LEN
+    tm_sync_filter_t filter;
+#endif
+    tm_system_t last_sync;
+    tm_sync_telemetry_t telemetry;
+    tm_sync_capture_t rx;
+    tm_system_t * tx_p;
+#if TIME_ENABLE_SYNC_BLOCK
+    avlt_node_t block_node;
+    uint8_t block_state;
+    tm_sync_block_t block;
+    tm_system_t block_t1;
+    tm_system_t block_t1p;
+    tm_system_t block_t2;
+#endif
 } tm_sync_sm_t;
 
+typedef struct TM_SYNC_CLOCK_t{
+    tm_sync_sm_t * instances;
+    tm_sync_sm_t * selected;
+    tm_sync_sm_t * candidate;
+    uint8_t candidate_count;
+    uint32_t switches;
+#if TIME_ENABLE_SYNC_SERVO
+    tm_sync_servo_t servo;
+#endif
+#if TIME_SYNC_ERROR_BUDGET
+    tm_sync_auto_t autosync;
+#endif
+} tm_sync_clock_t;
+
+/**@}*/ 
+
 #if TIME_ENABLE_SYNC
+extern tm_sync_sm_t tm_sync_sm;
+extern tm_sync_clock_t tm_sync_clock;
+extern ucdm_addr_t ucdm_addr_sync_telemetry;
+#if TIME_ENABLE_SYNC_BLOCK
+extern ucdm_addr_t ucdm_addr_sync_block;
+void tm_sync_block_handler(ucdm_addr_t addr);
+#endif
+
+/**
+ * @brief Reset the shared sync state, and set up the default sync 
+ *        instance. 
+ * 
+ * @param ucdm_next_address Address of the first register of the instance.
+ * @return Address of the first register following those of the instance.
+ */
 ucdm_addr_t tm_sync_init(ucdm_addr_t ucdm_next_address);
+
+/**
+ * @brief Set up an additional sync instance. 
+ * 
+ * The registers of the instance are laid out as for the default one. An 
+ * instance should only be set up once. 
+ * 
+ * @param sm_p Pointer to the instance.
+ * @param ucdm_next_address Address of the first register of the instance.
+ * @return Address of the first register following those of the instance.
+ */
+ucdm_addr_t tm_sync_instance_init(tm_sync_sm_t * sm_p, 
+                                  ucdm_addr_t ucdm_next_address);
+
+/**
+ * @brief Ask the host to sync, by raising UCDM_EXST_TIMESYNC_REQ. 
+ * 
+ * The request is cleared when an exchange completes on the selected 
+ * instance, or on an instance which becomes selected.
+ */
 void tm_sync_request_host(void);
 void tm_sync_handler(ucdm_addr_t addr);
-extern avlt_node_t  tm_avlt_sync_handler_node;
+
+/**
+ * @brief Get the sync instance currently steering the local clock, or 
+ *        NULL if no exchange has completed yet.
+ */
+static inline tm_sync_sm_t * tm_sync_selected(void);
+
+static inline tm_sync_sm_t * tm_sync_selected(void){
+    return tm_sync_clock.selected;
+}
+
+/**
+ * @name Transport Capture Timestamps
+ * 
+ * By default, the local timestamps of an exchange are taken when the 
+ * UCDM handlers run, which may be well after the frame carrying the 
+ * register access was received, or well before the response is sent. 
+ * Any such latency appears as error in the offset. 
+ * 
+ * Transport drivers can instead latch timestamps from their frame 
+ * interrupts : 
+ * 
+ *   - `tm_sync_capture_rx()` at the start or end of each received frame. 
+ *     The latched time is used as the time of receipt of the next sync 
+ *     timestamp handled, in place of the time of handling, and is then 
+ *     consumed. 
+ *   - `tm_sync_capture_tx()` at the start of each transmitted frame. The 
+ *     first call after the delay timestamp has been read replaces the 
+ *     time it was read with the time the response went out. Other calls 
+ *     do nothing. 
+ * 
+ * Both take the time elapsed since the last system tick in us, if the 
+ * driver can get it from the systick timer, and the latched time is 
+ * rounded to the nearest tick. Drivers which cannot should provide 0. 
+ * Drivers which do not call these functions are unaffected. 
+ * 
+ * Drivers of interfaces serving other sync instances use the 
+ * `tm_sync_instance_` variants. 
+ */
+/**@{*/ 
+
+void tm_sync_instance_capture_rx(tm_sync_sm_t * sm_p, uint16_t sub_us);
+
+void tm_sync_instance_capture_tx(tm_sync_sm_t * sm_p, uint16_t sub_us);
+
+static inline void tm_sync_capture_rx(uint16_t sub_us);
+
+static inline void tm_sync_capture_rx(uint16_t sub_us){
+    tm_sync_instance_capture_rx(&tm_sync_sm, sub_us);
+}
+
+static inline void tm_sync_capture_tx(uint16_t sub_us);
+
+static inline void tm_sync_capture_tx(uint16_t sub_us){
+    tm_sync_instance_capture_tx(&tm_sync_sm, sub_us);
+}
+
+/**@}*/ 
+
+#if TIME_SYNC_ERROR_BUDGET
+/**
+ * @brief Raise the sync request if the predicted error of the local 
+ *        clock is approaching the budget. 
+ * 
+ * Should be called periodically from the main loop, at least once per 
+ * TIME_SYNC_INTERVAL_MIN s. 
+ * 
+ * @return 1 if the request was raised by this call, 0 otherwise.
+ */
+uint8_t tm_sync_auto_poll(void);
+
+/**
+ * @brief Get the time to the next automatic sync request, as last 
+ *        scheduled, in s.
+ */
+static inline uint32_t tm_sync_auto_interval(void);
+
+static inline uint32_t tm_sync_auto_interval(void){
+    return tm_sync_clock.autosync.interval;
+}
+#endif
+
+#if TIME_ENABLE_SYNC_SERVO
+/**
+ * @brief Get the clock state of the time sync servo. 
+ * 
+ * @return One of the TM_SYNC_CLOCK_ definitions.
+ */
+static inline uint8_t tm_sync_clock_state(void);
+
+static inline uint8_t tm_sync_clock_state(void){
+    return tm_sync_servo_state(&(tm_sync_clock.servo));
+}
+
+/**
+ * @brief Get the estimated drift of the local oscillator in ppb, as 
+ *        last averaged while locked.
+ */
+static inline int32_t tm_sync_drift(void);
+
+static inline int32_t tm_sync_drift(void){
+    return tm_sync_clock.servo.drift;
+}
+#endif
 #endif
 
 #if TIME_ENABLE_SYNC_RTC
@@ -0,0 +1,127 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published by
+ *    the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file sync_master.c
+ * @brief Reference host implementation of the time sync protocol.
+ *
+ * @see sync_master.h
+ */
+
+#include "sync_master.h"
+
+#if TIME_ENABLE_SYNC_MASTER
+
+#define TM_SYNC_MASTER_TS_LEN       (sizeof(tm_system_t) / 2)
+
+static void tm_sync_master_write_ts(tm_sync_master_t * master_p,
+                                    const tm_system_t * time_p);
+
+static void tm_sync_master_write_ts(tm_sync_master_t * master_p,
+                                    const tm_system_t * time_p){
+    uint16_t words[TM_SYNC_MASTER_TS_LEN];
+    memcpy(words, time_p, sizeof(tm_system_t));
+    master_p->transport_p->write(master_p->transport_p->ctx,
+                                 master_p->address + TM_SYNC_UCDM_HOST_TS,
+                                 words, TM_SYNC_MASTER_TS_LEN);
+    master_p->transactions ++;
+}
+
+
+static void tm_sync_master_read_hook(tm_sync_master_t * master_p,
+                                     ucdm_addr_t offset);
+
+static void tm_sync_master_read_hook(tm_sync_master_t * master_p,
+                                     ucdm_addr_t offset){
+    uint16_t word;
+    master_p->transport_p->read(master_p->transport_p->ctx,
+                                master_p->address + offset, &word, 1);
+    master_p->transport_p->now(master_p->transport_p->ctx, &(master_p->t2p));
+    master_p->transactions ++;
+}
+
+
+void tm_sync_master_init(tm_sync_master_t * master_p,
+                         const tm_sync_transport_t * transport_p,
+                         ucdm_addr_t address, uint8_t mode){
+    master_p->transport_p = transport_p;
+    master_p->address = address;
+    master_p->mode = mode;
+    master_p->t2p = 0;
+    master_p->exchanges = 0;
+    master_p->transactions = 0;
+}
+
+
+void tm_sync_master_exchange(tm_sync_master_t * master_p){
+    const tm_sync_transport_t * transport_p = master_p->transport_p;
+    tm_system_t t1;
+    tm_system_t zero = 0;
+    #if TIME_ENABLE_SYNC_BLOCK
+    tm_sync_block_t block;
+    uint16_t words[sizeof(tm_sync_block_t) / 2];
+    #endif
+
+    switch (master_p->mode){
+        #if TIME_ENABLE_SYNC_BLOCK
+        case TM_SYNC_MASTER_BLOCK:
+            transport_p->now(transport_p->ctx, &(block.t1));
+            block.t2p = master_p->t2p;
+            memcpy(words, &block, sizeof(tm_sync_block_t));
+            transport_p->write(transport_p->ctx,
+                               master_p->address + TM_SYNC_UCDM_BLOCK,
+                               words, sizeof(tm_sync_block_t) / 2);
+            master_p->transactions ++;
+            tm_sync_master_read_hook(master_p, TM_SYNC_UCDM_BLOCK_HOOK);
+            break;
+        #endif
+        case TM_SYNC_MASTER_TWO_STEP:
+            transport_p->now(transport_p->ctx, &t1);
+            tm_sync_master_write_ts(master_p, &zero);
+            tm_sync_master_write_ts(master_p, &t1);
+            tm_sync_master_read_hook(master_p, TM_SYNC_UCDM_HOOK);
+            tm_sync_master_write_ts(master_p, &(master_p->t2p));
+            break;
+        case TM_SYNC_MASTER_ONE_STEP:
+        default:
+            transport_p->now(transport_p->ctx, &t1);
+            tm_sync_master_write_ts(master_p, &t1);
+            tm_sync_master_read_hook(master_p, TM_SYNC_UCDM_HOOK);
+            tm_sync_master_write_ts(master_p, &(master_p->t2p));
+            break;
+    }
+    master_p->exchanges ++;
+}
+
+
+void tm_sync_master_telemetry(tm_sync_master_t * master_p,
+                              tm_sync_telemetry_t * telemetry_p){
+    uint16_t words[sizeof(tm_sync_telemetry_t) / 2];
+    master_p->transport_p->read(master_p->transport_p->ctx,
+                                master_p->address + TM_SYNC_UCDM_TELEMETRY,
+                                words, sizeof(tm_sync_telemetry_t) / 2);
+    memcpy(telemetry_p, words, sizeof(tm_sync_telemetry_t));
+    master_p->transactions ++;
+}
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ *    Copyright (c)
+ *      (c) 2016-2018 Chintalagiri Shashank, Firefly Aerospace Pvt.Ltd.
+ *
+ *    This file is part of
+ *    Embedded bootstraps : time library
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU Lesser General Public License as published
+ *    by the Free Software Foundation; either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Lesser General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Lesser General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+/**
+ * @file sync_master.h
+ * @brief Reference host implementation of the time sync protocol.
+ *
+ * Applications enabling this functionality must ensure
+ * TIME_ENABLE_SYNC_MASTER is defined and non-zero, usually by defining
+ * APP_ENABLE_TIME_SYNC_MASTER in application.h.
+ *
+ * The master drives the protocol described in sync.h against the sync
+ * registers of a device, through a transport provided by the application
+ * as a `tm_sync_transport_t`. It is primarily meant for native builds,
+ * where it serves as a reference for ground software and, with a
+ * simulated transport, as a test bench for the sync implementation. It
+ * can also be used by a device which is itself the time master of
+ * another.
+ *
+ * Each transport call is one bus transaction. The master takes the host
+ * time immediately before it sends a timestamp, and immediately after a
+ * read returns.
+ *
+ * @see sync_master.c
+ */
+
+#ifndef TIME_SYNC_MASTER_H
+#define TIME_SYNC_MASTER_H
+
+#include "sync.h"
+
+#if TIME_ENABLE_SYNC_MASTER
+
+#define TM_SYNC_MASTER_ONE_STEP     0
+#define TM_SYNC_MASTER_TWO_STEP     1
+#define TM_SYNC_MASTER_BLOCK        2
+
+/**
+ * @brief Sync Transport Type
+ *
+ * `write` writes `count` registers starting at `address`, and `read`
+ * reads them, each in a single transaction. `now` provides the current
+ * host time against the same epoch as the device. All are called with
+ * `ctx` as their first argument.
+ */
+typedef struct TM_SYNC_TRANSPORT_t{
+    void (* write)(void * ctx, ucdm_addr_t address,
+                   const uint16_t * words, uint8_t count);
+    void (* read)(void * ctx, ucdm_addr_t address,
+                  uint16_t * words, uint8_t count);
+    void (* now)(void * ctx, tm_system_t * time_p);
+    void * ctx;
+} tm_sync_transport_t;
+
+/**
+ * @brief Sync Master Type
+ *
+ * Initialize using `tm_sync_master_init()`. Members should be treated as
+ * read-only by the application.
+ */
+typedef struct TM_SYNC_MASTER_t{
+    const tm_sync_transport_t * transport_p;
+    ucdm_addr_t address;
+    uint8_t mode;
+    tm_system_t t2p;
+    uint32_t exchanges;
+    uint32_t transactions;
+} tm_sync_master_t;
+
+/**
+ * @brief Initialize a sync master.
+ *
+ * @param master_p Pointer to the master.
+ * @param transport_p Pointer to the transport to the device.
+ * @param address The address provided to `tm_sync_init()` on the device.
+ * @param mode One of the TM_SYNC_MASTER_ definitions. TM_SYNC_MASTER_BLOCK
+ *             requires TIME_ENABLE_SYNC_BLOCK.
+ */
+void tm_sync_master_init(tm_sync_master_t * master_p,
+                         const tm_sync_transport_t * transport_p,
+                         ucdm_addr_t address, uint8_t mode);
+
+/**
+ * @brief Run one exchange with the device.
+ *
+ * In block mode, the delay measurement of each exchange is returned to
+ * the device with the next one, which is when the device applies it.
+ *
+ * @param master_p Pointer to the master.
+ */
+void tm_sync_master_exchange(tm_sync_master_t * master_p);
+
+/**
+ * @brief Read the sync telemetry registers of the device.
+ *
+ * @param master_p Pointer to the master.
+ * @param telemetry_p Pointer to the tm_sync_telemetry_t in which to store
+ *                    the result.
+ */
+void tm_sync_master_telemetry(tm_sync_master_t * master_p,
+                              tm_sync_telemetry_t * telemetry_p);
+
+#endif
+#endif
@@ -34,5 +34,9 @@
 static inline void time_systick_handler(void);
 
 static inline void time_systick_handler(void){
+    #if TIME_ENABLE_SLEW
+    tm_current += tm_slew_tick();
+    #else
     tm_current ++;
+    #endif
 }
@@ -32,13 +32,13 @@
  * @see time.h
  */
 
-#include <ds/sllist.h>
 #include <ucdm/descriptor.h>
 #include <string.h>
 #include "time.h"
 #include "systick.h"
 #include "sync.h"
 #include "cron.h"
+#include "cron_stats.h"
 #include <platform/sections.h>
 
 volatile tm_system_t tm_current FASTDATA;
@@ -50,6 +50,10 @@ int8_t tm_leapseconds = 0;
 
 tm_epochchange_handler_t * epoch_handlers_root = NULL;
 
+#if TIME_ENABLE_SLEW
+volatile tm_slew_t tm_slew;
+#endif
+
 /** @brief Time Library Epoch Descriptor */
 descriptor_custom_t tm_epoch_descriptor = {NULL, DESCRIPTOR_TAG_TIME_EPOCH, 
     sizeof(tm_real_t), DESCRIPTOR_ACCTYPE_PTR, {&tm_epoch}};
@@ -74,6 +78,12 @@ void tm_install_descriptor(void)
 
 ucdm_addr_t tm_init(ucdm_addr_t ucdm_address){
     tm_current = 0;
+    #if TIME_ENABLE_SLEW
+    tm_slew.freq = 0;
+    tm_slew.acc = 0;
+    tm_slew.phase = 0;
+    tm_slew.countdown = 0;
+    #endif
 
     #if TIME_EXPOSE_UCDM
     for (uint8_t i=0; i < TM_UCDM_STIME_LEN; i ++, ucdm_address++){
@@ -89,6 +99,9 @@ ucdm_addr_t tm_init(ucdm_addr_t ucdm_address){
 
     #if TIME_ENABLE_CRON
     tm_cron_init();
+    #if TIME_CRON_ENABLE_STATS && TIME_EXPOSE_UCDM
+    ucdm_address = tm_cron_stats_init(ucdm_address);
+    #endif
     #endif
 
     #if TIME_LIBVERSION_DESCRIPTOR
@@ -379,16 +392,164 @@ void tm_set_epoch(tm_real_t* rtime, uint8_t follow){
     
     use_epoch = 1;
     
+    #if TIME_ENABLE_EPOCH_DEFER
+    critical_exit();
+    tm_epoch_change_post(&sdelta, follow);
+    #else
+    tm_epoch_change_notify(&sdelta);
+    critical_exit();
+    #endif
+    return;
+}
+
+#if TIME_ENABLE_EPOCH_DEFER
+static void tm_epoch_change_seen(tm_epochchange_handler_t * handler);
+#endif
+
+void tm_register_epoch_change_handler(tm_epochchange_handler_t * handler){
+    tm_epochchange_handler_t ** link_p = &epoch_handlers_root;
+    #if TIME_ENABLE_EPOCH_DEFER
+    tm_epoch_change_seen(handler);
+    #endif
+    // Handlers of equal priority are called in the order registered.
+    while (*link_p && (*link_p)->priority <= handler->priority){
+        link_p = &((*link_p)->next);
+    }
+    handler->next = *link_p;
+    *link_p = handler;
+}
+
+static void tm_epoch_change_call(tm_epochchange_handler_t * handler, 
+                                 tm_sdelta_t * sdelta);
+
+static void tm_epoch_change_call(tm_epochchange_handler_t * handler, 
+                                 tm_sdelta_t * sdelta){
+    if (handler->func_ctx){
+        handler->func_ctx(handler->ctx, sdelta);
+    }
+    else{
+        handler->func(sdelta);
+    }
+}
+
+void tm_epoch_change_notify(tm_sdelta_t * sdelta){
     tm_epochchange_handler_t * echandler = epoch_handlers_root;
     while(echandler){
-        echandler -> func(&sdelta);
+        tm_epoch_change_call(echandler, sdelta);
         echandler = echandler->next;
     }
+}
+
+#if TIME_ENABLE_EPOCH_DEFER
 
+// Posted changes are kept as the sum of the deltas followed since the 
+// last change which was not, and a count of such changes. Each handler 
+// holds the values it last saw, so that handlers can be dispatched 
+// independently of each other.
+static tm_sdelta_t tm_epoch_posted_sdelta = 0;
+static uint16_t tm_epoch_posted_resets = 0;
+
+static void tm_epoch_change_seen(tm_epochchange_handler_t * handler){
+    critical_enter();
+    handler->seen_sdelta = tm_epoch_posted_sdelta;
+    handler->seen_resets = tm_epoch_posted_resets;
     critical_exit();
-    return;
 }
 
-void tm_register_epoch_change_handler(tm_epochchange_handler_t * handler){
-    sllist_install((void *)&epoch_handlers_root, (void *)handler);
+void tm_epoch_change_post(tm_sdelta_t * sdelta, uint8_t follow){
+    critical_enter();
+    if (follow){
+        tm_epoch_posted_sdelta += *sdelta;
+    }
+    else{
+        // Handlers discard everything, so earlier deltas do not matter.
+        tm_epoch_posted_sdelta = 0;
+        tm_epoch_posted_resets ++;
+    }
+    critical_exit();
+}
+
+uint8_t tm_epoch_change_dispatch_handler(tm_epochchange_handler_t * handler){
+    tm_sdelta_t sdelta;
+    tm_sdelta_t seen = handler->seen_sdelta;
+    tm_sdelta_t zero;
+    uint16_t resets = handler->seen_resets;
+    tm_epoch_change_seen(handler);
+    if (handler->seen_resets != resets){
+        tm_clear_sdelta(&zero);
+        tm_epoch_change_call(handler, &zero);
+        // Changes followed since the last reset, if any.
+        sdelta = handler->seen_sdelta;
+    }
+    else{
+        sdelta = handler->seen_sdelta - seen;
+        if (!sdelta){
+            // Nothing pending, or changes which cancel out.
+            return 0;
+        }
+    }
+    if (sdelta){
+        tm_epoch_change_call(handler, &sdelta);
+    }
+    return 1;
+}
+
+uint8_t tm_epoch_change_dispatch(void){
+    tm_epochchange_handler_t * echandler = epoch_handlers_root;
+    uint8_t rval = 0;
+    while(echandler){
+        if (!echandler->owned){
+            rval |= tm_epoch_change_dispatch_handler(echandler);
+        }
+        echandler = echandler->next;
+    }
+    return rval;
+}
+
+#else
+
+void tm_epoch_change_post(tm_sdelta_t * sdelta, uint8_t follow){
+    tm_sdelta_t zero;
+    if (follow){
+        tm_epoch_change_notify(sdelta);
+    }
+    else{
+        tm_clear_sdelta(&zero);
+        tm_epoch_change_notify(&zero);
+    }
+}
+
+#endif
+
+#if TIME_ENABLE_SLEW
+
+void tm_slew_time(tm_sdelta_t * sdelta){
+    int32_t phase;
+    if (*sdelta > INT32_MAX){
+        phase = INT32_MAX;
+    }
+    else if (*sdelta < -INT32_MAX){
+        phase = -INT32_MAX;
+    }
+    else{
+        phase = (int32_t)*sdelta;
+    }
+    critical_enter();
+    tm_slew.phase = phase;
+    tm_slew.countdown = TM_SLEW_INTERVAL;
+    critical_exit();
 }
+
+void tm_slew_frequency(int32_t ppb){
+    if (ppb > TM_SLEW_FREQ_MAX){
+        ppb = TM_SLEW_FREQ_MAX;
+    }
+    else if (ppb < -TM_SLEW_FREQ_MAX){
+        ppb = -TM_SLEW_FREQ_MAX;
+    }
+    critical_enter();
+    tm_slew.freq = ppb;
+    critical_exit();
+}
+
+#endif
@@ -55,6 +55,38 @@
  *    7    | Time Sync Register 2    | Write
  *    8    | Time Sync Register 3    | Write
  *    9    | Time Sync Register 4    | Write, Handle
+ *  10, 11 | Sync Offset             | Read, Pointer
+ *  12, 13 | Sync Path Delay         | Read, Pointer
+ *  14, 15 | Sync Jitter             | Read, Pointer
+ *  16, 17 | Sync Exchanges          | Read, Pointer
+ *    18   | Sync Clock State        | Read, Pointer
+ *    19   | Reserved                | Read, Pointer
+ *  20, 21 | Time Since Last Sync    | Read, Func
+ * 
+ * If sync block mode is enabled by TIME_ENABLE_SYNC_BLOCK, these are 
+ * followed by : 
+ * 
+ * Address | Description             | Access Type
+ * --------|-------------------------|--------------
+ *    22   | Block Read Hook         | Read, Func
+ *  23..26 | Block Host Send Time    | Write
+ *  27..30 | Block Host Receive Time | Write, Handle
+ * 
+ * Registers 10 to 19 hold a tm_sync_telemetry_t, and registers 23 to 30 a
+ * tm_sync_block_t. Further sync instances use the same layout, from the 
+ * address provided to `tm_sync_instance_init()`. See sync.h.
+ * 
+ * If cron statistics are enabled by TIME_CRON_ENABLE_STATS, the scheduler
+ * health structure (tm_cron_health_t) is mapped to the registers starting 
+ * at address 4, at 22 if synchronization is enabled, or at 31 if sync 
+ * block mode is also enabled. With 12 histogram bins, this is: 
+ * 
+ * Address | Description             | Access Type
+ * --------|-------------------------|--------------
+ *  +0, +1 | Total Job Runs          | Read, Pointer
+ *  +2, +3 | Maximum Lateness        | Read, Pointer
+ *  +4, +5 | Maximum Execution Time  | Read, Pointer
+ *  +6..17 | Lateness Histogram      | Read, Pointer
  * 
  * 
  * This library provides the following descriptors: 
@@ -203,21 +235,62 @@ typedef struct TM_RDELTA_t{
  * the two epochs are fundamentally incompatible, or if the change 
  * involves more than just a shift in the epoch.
  * 
- * Note that epoch change handlers are run in an interrupt-disabled 
- * context, so they should be as quick as possible. 
- * 
- * The epoch change handlers should be called in increasing order of 
- * the priority member, and this could, in principle, be used by the 
- * application to sequence shifts of related timestamps. This is not 
- * implemented. 
+ * Epoch change handlers are called in increasing order of the priority 
+ * member, which the application can use to sequence shifts of related 
+ * timestamps. Handlers of equal priority are called in the order in 
+ * which they were registered. 
+ * 
+ * By default, the handlers are run when the change happens. For 
+ * `tm_set_epoch()`, this is in an interrupt-disabled context, so they 
+ * should be as quick as possible. When TIME_ENABLE_EPOCH_DEFER is set, 
+ * changes are instead posted with `tm_epoch_change_post()`, and the 
+ * handlers are run later from `tm_epoch_change_dispatch()`, with 
+ * interrupts enabled. See `tm_epoch_change_post()`. 
+ * 
+ * Handlers which serve one of several instances of a construct can 
+ * instead provide `func_ctx`, which is called with `ctx` as its first 
+ * argument. `func` is then left NULL. Existing initializers which only 
+ * provide `func` remain valid.
+ * 
+ * With TIME_ENABLE_EPOCH_DEFER, the `seen_` members are used internally 
+ * to track the posted changes the handler has already been called for. 
+ * Handlers with `owned` set are only dispatched by their owner, using 
+ * `tm_epoch_change_dispatch_handler()`, and are skipped by 
+ * `tm_epoch_change_dispatch()`.
  * 
  */
 typedef struct TM_EPOCH_CHANGEHANDLER_t{
     struct TM_EPOCH_CHANGEHANDLER_t * next;
     uint8_t priority;
     void (* func)(tm_sdelta_t *);
+    void (* func_ctx)(void *, tm_sdelta_t *);
+    void * ctx;
+#if TIME_ENABLE_EPOCH_DEFER
+    uint8_t owned;
+    tm_sdelta_t seen_sdelta;
+    uint16_t seen_resets;
+#endif
 }tm_epochchange_handler_t;
 
+#if TIME_ENABLE_SLEW
+
+/**
+ * @brief Clock Slew State Type
+ * 
+ * Holds the frequency and phase corrections applied by the system tick 
+ * handler. See `tm_slew_time()` and `tm_slew_frequency()`. Members 
+ * should be treated as read-only by the application.
+ * 
+ */
+typedef struct TM_SLEW_t{
+    int32_t freq;
+    int32_t acc;
+    int32_t phase;
+    uint16_t countdown;
+} tm_slew_t;
+
+#endif
+
 /**@}*/ 
 
 /**
@@ -234,6 +307,9 @@ extern   tm_real_t tm_internal_epoch;
 extern     int64_t tm_internal_epoch_offset;
 extern     uint8_t use_epoch;
 extern tm_epochchange_handler_t * epoch_handlers_root;
+#if TIME_ENABLE_SLEW
+extern volatile tm_slew_t tm_slew;
+#endif
 
 /**@}*/ 
 
@@ -375,6 +451,94 @@ static inline void tm_apply_sdelta(tm_system_t * t, tm_sdelta_t * sdelta){
 
 /**@}*/ 
 
+#if TIME_ENABLE_SLEW
+
+/**
+ * @name Clock Slew Functions
+ * 
+ * Applications enabling this functionality must ensure TIME_ENABLE_SLEW 
+ * is defined and non-zero, usually by defining APP_ENABLE_TIME_SLEW in 
+ * application.h. It is enabled along with the sync servo. 
+ * 
+ * Instead of stepping the system time and notifying all the epoch change 
+ * handlers, corrections can be slewed into it by the system tick handler, 
+ * which occasionally inserts or drops a tick. System time then stays 
+ * continuous and never runs backwards, and no epoch change is notified. 
+ * 
+ * The phase correction is slewed at TIME_SLEW_RATE_PPM, ie, one tick is 
+ * inserted or dropped every 1000000 / TIME_SLEW_RATE_PPM ticks until the 
+ * correction is complete. The frequency correction is accumulated in ppb, 
+ * and is limited to TM_SLEW_FREQ_MAX. 
+ * 
+ */
+/**@{*/ 
+
+#define TM_SLEW_PPB                 1000000000L
+#define TM_SLEW_FREQ_MAX            500000L
+#define TM_SLEW_INTERVAL            (1000000L / TIME_SLEW_RATE_PPM)
+
+/**
+ * @brief Slew a time difference into the system time.
+ * 
+ * Replaces any phase correction which is still in progress, as adjtime 
+ * does. 
+ * 
+ * @param sdelta Pointer to the time difference to apply. 
+ */
+void tm_slew_time(tm_sdelta_t * sdelta);
+
+/**
+ * @brief Set the frequency correction of the system time.
+ * 
+ * @param ppb Frequency correction in parts per billion. Positive values 
+ *            make the system time run faster. 
+ */
+void tm_slew_frequency(int32_t ppb);
+
+/**
+ * @brief Get the number of ticks to advance the system time by, for one 
+ *        tick of the system tick.
+ * 
+ * This is called by the system tick handler, in interrupt context.
+ */
+static inline int8_t tm_slew_tick(void);
+
+static inline int8_t tm_slew_tick(void){
+    int8_t ticks = 1;
+    tm_slew.acc += tm_slew.freq;
+    if (tm_slew.acc >= TM_SLEW_PPB){
+        tm_slew.acc -= TM_SLEW_PPB;
+        ticks ++;
+    }
+    else if (tm_slew.acc <= -TM_SLEW_PPB){
+        tm_slew.acc += TM_SLEW_PPB;
+        ticks --;
+    }
+    // A tick is not dropped if the frequency correction already dropped 
+    // this one, so that time does not run backwards. 
+    if (tm_slew.phase){
+        if (tm_slew.countdown > 1){
+            tm_slew.countdown --;
+        }
+        else if (ticks || tm_slew.phase > 0){
+            tm_slew.countdown = TM_SLEW_INTERVAL;
+            if (tm_slew.phase > 0){
+                tm_slew.phase --;
+                ticks ++;
+            }
+            else{
+                tm_slew.phase ++;
+                ticks --;
+            }
+        }
+    }
+    return ticks;
+}
+
+/**@}*/ 
+
+#endif
+
 
 /**
  * @name Real Time Manipulation Functions
@@ -512,5 +676,77 @@ void tm_set_epoch(tm_real_t* rtime, uint8_t follow);
  */
 void tm_register_epoch_change_handler(tm_epochchange_handler_t * handler);
 
+/**
+ * @brief Call all registered epoch change handlers.
+ * 
+ * Used internally to dispatch changes. Changes should be reported 
+ * through `tm_epoch_change_post()` instead.
+ * 
+ * @param sdelta Pointer to the change in the epoch.
+ */
+void tm_epoch_change_notify(tm_sdelta_t * sdelta);
+
+/**
+ * @brief Report a change of the epoch, or a step of the system time, to 
+ *        the registered epoch change handlers.
+ * 
+ * Used internally by `tm_set_epoch()` and time sync. Should be called 
+ * with interrupts enabled. 
+ * 
+ * Without TIME_ENABLE_EPOCH_DEFER, the handlers are called before this 
+ * function returns. 
+ * 
+ * With TIME_ENABLE_EPOCH_DEFER, the change is only recorded, and the 
+ * handlers are called by the next `tm_epoch_change_dispatch()`. Changes 
+ * posted in the meantime, such as a burst of sync steps, are coalesced, 
+ * and the handlers see the cumulative delta once. If any of them was 
+ * not to be followed, the handlers see a single zero delta instead, 
+ * followed by the cumulative delta of the changes posted after the 
+ * last such change, if it is non-zero. 
+ * Each cron scheduler instance dispatches pending changes to its own 
+ * handler before it polls, so that it never runs jobs against a stale 
+ * epoch, and before it converts between absolute times and stored job 
+ * times. The handlers of the instances are owned, so that instances 
+ * polled from different tasks are never shifted from another task. 
+ * Applications storing timestamps should dispatch likewise before using 
+ * them. 
+ * 
+ * @param sdelta Pointer to the change in the epoch.
+ * @param follow Whether the change is to be followed by the handlers.
+ */
+void tm_epoch_change_post(tm_sdelta_t * sdelta, uint8_t follow);
+
+#if TIME_ENABLE_EPOCH_DEFER
+
+/**
+ * @brief Call the registered epoch change handlers for the changes 
+ *        posted since they were last dispatched, if any. 
+ * 
+ * Should be called from the main loop, and not from interrupt context. 
+ * Each handler is dispatched as by `tm_epoch_change_dispatch_handler()`, 
+ * in order of priority. Owned handlers, such as those of the cron 
+ * scheduler instances, are skipped. 
+ * 
+ * @return 1 if any handler was called, 0 if there was nothing to do.
+ */
+uint8_t tm_epoch_change_dispatch(void);
+
+/**
+ * @brief Call a single epoch change handler for the changes posted since 
+ *        it last saw them, if any. 
+ * 
+ * Each handler keeps track of the changes it has seen, so handlers can 
+ * be dispatched individually, or by `tm_epoch_change_dispatch()`, and 
+ * see each change once. A handler sees the changes posted after it was 
+ * registered. A handler must only be dispatched from one context at a 
+ * time. 
+ * 
+ * @param handler Pointer to the registered epoch change handler.
+ * @return 1 if the handler was called, 0 if there was nothing to do.
+ */
+uint8_t tm_epoch_change_dispatch_handler(tm_epochchange_handler_t * handler);
+
+#endif
+
 /**@}*/ 
 #endif
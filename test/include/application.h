@@ -5,7 +5,7 @@
 #endif
 
 #ifndef APP_UCDM_MAX_REGISTERS
-#define APP_UCDM_MAX_REGISTERS              20
+#define APP_UCDM_MAX_REGISTERS              80
 #endif
 
 #ifdef APP_ENABLE_LIBVERSION_DESCRIPTORS
@@ -32,10 +32,82 @@
     #define APP_ENABLE_TIME_CRON       1
     #endif
 
+    #ifndef APP_ENABLE_TIME_CRON_SPEC
+    #define APP_ENABLE_TIME_CRON_SPEC  1
+    #endif
+
+    #ifndef APP_ENABLE_TIME_CRON_POLICIES
+    #define APP_ENABLE_TIME_CRON_POLICIES   1
+    #endif
+
+    #ifndef APP_ENABLE_TIME_CRON_SLACK
+    #define APP_ENABLE_TIME_CRON_SLACK 1
+    #endif
+
+    #ifndef APP_ENABLE_TIME_CRON_STATS
+    #define APP_ENABLE_TIME_CRON_STATS 1
+    #endif
+
+    #ifndef APP_TIME_CRON_SUBMIT_QUEUE_LEN
+    #define APP_TIME_CRON_SUBMIT_QUEUE_LEN  8
+    #endif
+
+    #ifndef APP_ENABLE_TIME_CRON_PERSIST
+    #define APP_ENABLE_TIME_CRON_PERSIST    1
+    #endif
+
+    #ifndef APP_TIME_CRON_PERSIST_LEN
+    #define APP_TIME_CRON_PERSIST_LEN       256
+    #endif
+
+    #ifndef APP_ENABLE_TIME_CRON_TABLES
+    #define APP_ENABLE_TIME_CRON_TABLES     1
+    #endif
+
+    #ifndef APP_ENABLE_TIME_CRON_GROUPS
+    #define APP_ENABLE_TIME_CRON_GROUPS     1
+    #endif
+
+    #ifndef APP_ENABLE_TIME_CRON_EDF
+    #define APP_ENABLE_TIME_CRON_EDF        1
+    #endif
+
+    #ifndef APP_ENABLE_TIME_CRON_BLACKOUT
+    #define APP_ENABLE_TIME_CRON_BLACKOUT   1
+    #endif
+
+    #ifndef APP_ENABLE_TIME_CRON_COMPACT
+    #define APP_ENABLE_TIME_CRON_COMPACT    1
+    #endif
+
+    #if defined PIO_NATIVE && !defined APP_ENABLE_TIME_CRON_POOL
+    #define APP_ENABLE_TIME_CRON_POOL       1
+    #endif
+
+    #ifndef APP_ENABLE_TIME_EPOCH_DEFER
+    #define APP_ENABLE_TIME_EPOCH_DEFER     1
+    #endif
+
     #ifndef APP_ENABLE_TIME_SYNC
     #define APP_ENABLE_TIME_SYNC       1
     #endif
 
+    #ifndef APP_ENABLE_TIME_SYNC_BLOCK
+    #define APP_ENABLE_TIME_SYNC_BLOCK 1
+    #endif
+
+    #ifndef APP_ENABLE_TIME_SYNC_MASTER
+    #define APP_ENABLE_TIME_SYNC_MASTER 1
+    #endif
+
+    #ifndef APP_ENABLE_TIME_SYNC_SERVO
+    #define APP_ENABLE_TIME_SYNC_SERVO 1
+    #endif
+
+    #ifndef APP_TIME_SYNC_ERROR_BUDGET
+    #define APP_TIME_SYNC_ERROR_BUDGET 4
+    #endif
+
     #ifndef APP_ENABLE_RTC 
     #define APP_ENABLE_RTC             0
     #endif
@@ -0,0 +1,541 @@
+#include <string.h>
+#include <unity.h>
+#include <time/time.h>
+#include <time/cron.h>
+#include <time/cron_stats.h>
+#include <scaffold.h>
+
+static cron_job_t job;
+static tm_sdelta_t period;
+static uint8_t runs;
+static uint16_t last_missed;
+static uint32_t total_missed;
+
+static void plain_handler(void){
+    runs ++;
+}
+
+#if TIME_CRON_ENABLE_POLICIES
+static void missed_handler(uint16_t missed){
+    runs ++;
+    last_missed = missed;
+    total_missed += missed;
+}
+#endif
+
+static void reset(void){
+    if (job.active){
+        tm_cron_cancel_job(&job);
+    }
+    tm_current = 0;
+    runs = 0;
+    last_missed = 0;
+    total_missed = 0;
+    period = 100;
+}
+
+#if TIME_CRON_ENABLE_POLICIES
+static void create_periodic(uint8_t policy){
+    tm_system_t texec = 100;
+    reset();
+    tm_cron_create_job_abs(&job, &plain_handler, &texec, &period);
+    tm_cron_set_policy(&job, policy);
+    tm_cron_set_missed_handler(&job, &missed_handler);
+}
+#endif
+
+void test_cron_oneshot(void) {
+    tm_sdelta_t trel = 50;
+    reset();
+    tm_cron_create_job_rel(&job, &plain_handler, &trel, NULL);
+    TEST_ASSERT_EQUAL(1, job.active);
+    tm_current = 49;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(0, runs);
+    tm_current = 50;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(1, runs);
+    TEST_ASSERT_EQUAL(0, job.active);
+    TEST_ASSERT_NULL(cron_nextjob_p);
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(1, runs);
+}
+
+#if TIME_CRON_ENABLE_POLICIES
+void test_cron_policy_catchup(void) {
+    create_periodic(TM_CRON_POLICY_CATCHUP);
+    tm_current = 450;
+    for (uint8_t i = 0; i < 10; i++){
+        tm_cron_poll();
+    }
+    // Runs for 100, 200, 300 and 400, back to back.
+    TEST_ASSERT_EQUAL(4, runs);
+    TEST_ASSERT_EQUAL(0, total_missed);
+    TEST_ASSERT_EQUAL_INT64(500, job.texec);
+}
+
+void test_cron_policy_coalesce(void) {
+    create_periodic(TM_CRON_POLICY_COALESCE);
+    tm_current = 450;
+    for (uint8_t i = 0; i < 10; i++){
+        tm_cron_poll();
+    }
+    TEST_ASSERT_EQUAL(1, runs);
+    TEST_ASSERT_EQUAL(3, last_missed);
+    TEST_ASSERT_EQUAL_INT64(500, job.texec);
+
+    // Late by less than a period is not a miss.
+    tm_current = 550;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(2, runs);
+    TEST_ASSERT_EQUAL(0, last_missed);
+    TEST_ASSERT_EQUAL_INT64(600, job.texec);
+}
+
+void test_cron_policy_skip(void) {
+    create_periodic(TM_CRON_POLICY_SKIP);
+    tm_current = 450;
+    for (uint8_t i = 0; i < 10; i++){
+        tm_cron_poll();
+    }
+    TEST_ASSERT_EQUAL(0, runs);
+    TEST_ASSERT_EQUAL_INT64(500, job.texec);
+
+    // The skipped slots are reported with the next run.
+    tm_current = 500;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(1, runs);
+    TEST_ASSERT_EQUAL(4, last_missed);
+    TEST_ASSERT_EQUAL_INT64(600, job.texec);
+}
+
+void test_cron_policy_alignment(void) {
+    create_periodic(TM_CRON_POLICY_COALESCE);
+    tm_current = 100 + 100 * 100000LL + 37;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(1, runs);
+    TEST_ASSERT_EQUAL(0xFFFF, last_missed);
+    TEST_ASSERT_EQUAL_INT64(100 + 100 * 100001LL, job.texec);
+}
+#endif
+
+void test_cron_epoch_change(void) {
+    tm_system_t texec = 1000;
+    tm_system_t texec_abs;
+    tm_sdelta_t offset = 500;
+    cron_job_t other;
+
+    reset();
+    tm_cron_create_job_abs(&job, &plain_handler, &texec, NULL);
+    texec = 1200;
+    tm_cron_create_job_abs(&other, &plain_handler, &texec, NULL);
+    tm_cron_epoch_change_handler(&offset);
+
+    TEST_ASSERT_EQUAL_INT64(1000, job.texec);
+    tm_cron_get_texec(&job, &texec_abs);
+    TEST_ASSERT_EQUAL_INT64(1500, texec_abs);
+    TEST_ASSERT_EQUAL_PTR(&job, cron_nextjob_p);
+
+    tm_current = 1200;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(0, runs);
+    tm_current = 1500;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(1, runs);
+    TEST_ASSERT_EQUAL(0, job.active);
+
+    // Jobs created after the change are against the new base.
+    texec = 1600;
+    tm_cron_create_job_abs(&job, &plain_handler, &texec, NULL);
+    TEST_ASSERT_EQUAL_PTR(&job, cron_nextjob_p);
+    tm_cron_get_texec(&job, &texec_abs);
+    TEST_ASSERT_EQUAL_INT64(1600, texec_abs);
+
+    tm_cron_cancel_job(&other);
+    offset = -offset;
+    tm_cron_epoch_change_handler(&offset);
+}
+
+#if TIME_ENABLE_EPOCH_DEFER
+void test_cron_epoch_defer(void) {
+    tm_system_t texec = 2000;
+    tm_system_t texec_abs;
+    tm_system_t wake;
+    tm_sdelta_t offset = 60000;
+    tm_sdelta_t trel = 100;
+    cron_job_t other;
+
+    reset();
+    tm_current = 1000;
+    tm_cron_create_job_abs(&other, &plain_handler, &texec, NULL);
+
+    // The time steps at once, but the change is only posted. A job 
+    // created before it is dispatched is not shifted a second time.
+    tm_current += offset;
+    tm_epoch_change_post(&offset, 1);
+    tm_cron_create_job_rel(&job, &plain_handler, &trel, NULL);
+    tm_cron_get_texec(&job, &texec_abs);
+    TEST_ASSERT_EQUAL_INT64(61100, texec_abs);
+    tm_cron_get_texec(&other, &texec_abs);
+    TEST_ASSERT_EQUAL_INT64(62000, texec_abs);
+    TEST_ASSERT_EQUAL(0, tm_cron_next_wake(&wake));
+    TEST_ASSERT_EQUAL_INT64(61100, wake);
+
+    tm_current = 61100;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(1, runs);
+    tm_current = 62000;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(2, runs);
+
+    // Instances follow changes themselves, and are not dispatched from 
+    // elsewhere.
+    offset = -offset;
+    tm_epoch_change_post(&offset, 1);
+    tm_epoch_change_dispatch();
+    TEST_ASSERT_EQUAL_INT64(60000, cron_epoch_offset);
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL_INT64(0, cron_epoch_offset);
+}
+#endif
+
+void test_cron_instances(void) {
+    static tm_cron_sched_t sched;
+    static uint8_t initialized = 0;
+    cron_job_t other;
+    tm_system_t texec = 100;
+    tm_sdelta_t offset = 50;
+
+    reset();
+    if (!initialized){
+        tm_cron_sched_init(&sched);
+        initialized = 1;
+    }
+    tm_cron_create_job_abs(&job, &plain_handler, &texec, NULL);
+    tm_cron_sched_create_job_abs(&sched, &other, &plain_handler, &texec, NULL);
+    TEST_ASSERT_EQUAL_PTR(&job, cron_nextjob_p);
+    TEST_ASSERT_EQUAL_PTR(&other, sched.nextjob_p);
+    TEST_ASSERT_NULL(job.nextjob);
+
+    // Each instance follows epoch changes through its own handler.
+    tm_epoch_change_notify(&offset);
+    tm_current = 150;
+    tm_cron_sched_poll(&sched);
+    TEST_ASSERT_EQUAL(1, runs);
+    TEST_ASSERT_EQUAL(0, other.active);
+    TEST_ASSERT_EQUAL(1, job.active);
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(2, runs);
+
+    offset = -offset;
+    tm_epoch_change_notify(&offset);
+}
+
+#if TIME_CRON_ENABLE_SLACK
+void test_cron_slack(void) {
+    cron_job_t other;
+    tm_system_t texec = 100;
+    tm_system_t texec_other = 130;
+    tm_system_t wake;
+    uint32_t wakeups, saved;
+
+    reset();
+    tm_cron_create_job_abs(&job, &plain_handler, &texec, NULL);
+    tm_cron_set_slack(&job, 50);
+    tm_cron_create_job_abs(&other, &plain_handler, &texec_other, NULL);
+    tm_cron_set_slack(&other, 10);
+    wakeups = cron_wakeups;
+    saved = cron_wakeups_saved;
+
+    // The window of the second job ends first.
+    TEST_ASSERT_EQUAL(0, tm_cron_next_wake(&wake));
+    TEST_ASSERT_EQUAL_INT64(140, wake);
+    tm_current = 139;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(0, runs);
+
+    tm_current = 140;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(2, runs);
+    TEST_ASSERT_EQUAL(wakeups + 1, cron_wakeups);
+    TEST_ASSERT_EQUAL(saved + 1, cron_wakeups_saved);
+    TEST_ASSERT_EQUAL(1, tm_cron_next_wake(&wake));
+}
+#endif
+
+#if TIME_CRON_ENABLE_GROUPS && TIME_CRON_ENABLE_POLICIES
+void test_cron_groups(void) {
+    cron_job_t other, third;
+    tm_system_t texec = 100;
+    tm_system_t wake;
+
+    reset();
+    tm_cron_create_job_abs(&job, &plain_handler, &texec, &period);
+    tm_cron_set_policy(&job, TM_CRON_POLICY_COALESCE);
+    tm_cron_set_group(&job, 1);
+    tm_cron_create_job_abs(&other, &plain_handler, &texec, NULL);
+    tm_cron_set_group(&other, 2);
+
+    // The paused job stays in the queue, but does not wake or run.
+    tm_cron_pause_group(1);
+    TEST_ASSERT_EQUAL(0, tm_cron_next_wake(&wake));
+    TEST_ASSERT_EQUAL_INT64(100, wake);
+    tm_current = 250;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(1, runs);
+    TEST_ASSERT_EQUAL(1, job.active);
+    TEST_ASSERT_EQUAL(1, tm_cron_next_wake(&wake));
+
+    tm_cron_resume_group(1);
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(2, runs);
+    tm_cron_get_texec(&job, &texec);
+    TEST_ASSERT_EQUAL_INT64(300, texec);
+
+    tm_cron_create_job_abs(&other, &plain_handler, &texec, NULL);
+    tm_cron_set_group(&other, 1);
+    tm_cron_create_job_abs(&third, &plain_handler, &texec, NULL);
+    tm_cron_cancel_group(1);
+    TEST_ASSERT_EQUAL(0, job.active);
+    TEST_ASSERT_EQUAL(0, other.active);
+    TEST_ASSERT_EQUAL_PTR(&third, cron_nextjob_p);
+    TEST_ASSERT_NULL(third.nextjob);
+    tm_cron_cancel_job(&third);
+}
+#endif
+
+#if TIME_CRON_ENABLE_BLACKOUT
+void test_cron_blackout(void) {
+    static tm_interval_t windows_items[2];
+    tm_interval_set_t windows;
+    tm_interval_t window = {150, 250};
+    tm_system_t texec = 100;
+    tm_system_t wake;
+    uint32_t deferrals = tm_cron_default.deferrals;
+
+    reset();
+    tm_interval_set_init(&windows, windows_items, 2);
+    tm_interval_set_add(&windows, &window);
+    tm_cron_create_job_abs(&job, &plain_handler, &texec, &period);
+    tm_cron_set_blackout(&job, &windows);
+
+    tm_current = 100;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(1, runs);
+
+    // The next slot, at 200, is inside the window. The job does not wake 
+    // until the end of it.
+    TEST_ASSERT_EQUAL(0, tm_cron_next_wake(&wake));
+    TEST_ASSERT_EQUAL_INT64(250, wake);
+    TEST_ASSERT_EQUAL(deferrals + 1, tm_cron_default.deferrals);
+    tm_current = 250;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(2, runs);
+
+    // A window added after the job was scheduled is applied when polled.
+    window.start = 340;
+    window.end = 400;
+    tm_interval_set_add(&windows, &window);
+    tm_current = 350;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(2, runs);
+    TEST_ASSERT_EQUAL(0, tm_cron_next_wake(&wake));
+    TEST_ASSERT_EQUAL_INT64(400, wake);
+    tm_current = 400;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(3, runs);
+    tm_cron_cancel_job(&job);
+}
+#endif
+
+#if TIME_CRON_ENABLE_EDF
+static char edf_order[8];
+static uint8_t edf_len;
+
+static void edf_a(void){
+    edf_order[edf_len++] = 'a';
+}
+
+static void edf_b(void){
+    edf_order[edf_len++] = 'b';
+}
+
+static void edf_c(void){
+    edf_order[edf_len++] = 'c';
+}
+
+static void edf_slow(void){
+    edf_order[edf_len++] = 's';
+    tm_current += 30;
+}
+
+void test_cron_edf(void) {
+    static cron_job_t jobs[4];
+    tm_system_t texec = 100;
+    tm_system_t later = 110;
+    uint32_t misses = tm_cron_default.deadline_misses;
+
+    reset();
+    memset(edf_order, 0, sizeof(edf_order));
+    edf_len = 0;
+    tm_cron_create_job_abs(&jobs[0], &edf_a, &texec, NULL);
+    tm_cron_create_job_abs(&jobs[1], &edf_b, &texec, NULL);
+    tm_cron_set_deadline(&jobs[1], 50);
+    tm_cron_create_job_abs(&jobs[2], &edf_slow, &texec, NULL);
+    tm_cron_set_deadline(&jobs[2], 20);
+    tm_cron_create_job_abs(&jobs[3], &edf_c, &later, NULL);
+    tm_cron_set_priority(&jobs[3], 0);
+
+    // The class 0 job is not yet due, and is not run early. The others 
+    // run earliest deadline first, and then the one without a deadline.
+    tm_current = 100;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL_STRING("sba", edf_order);
+    TEST_ASSERT_EQUAL(misses + 1, tm_cron_default.deadline_misses);
+
+    // Classes take precedence over deadlines.
+    texec = 200;
+    tm_cron_create_job_abs(&jobs[1], &edf_b, &texec, NULL);
+    tm_cron_set_deadline(&jobs[1], 1);
+    tm_cron_cancel_job(&jobs[3]);
+    tm_cron_create_job_abs(&jobs[3], &edf_c, &texec, NULL);
+    tm_cron_set_priority(&jobs[3], 0);
+    tm_current = 200;
+    tm_cron_poll();
+    for (uint8_t i = 0; i < 4; i++){
+        tm_cron_cancel_job(&jobs[i]);
+    }
+    TEST_ASSERT_EQUAL_STRING("sbacb", edf_order);
+    TEST_ASSERT_EQUAL(misses + 1, tm_cron_default.deadline_misses);
+}
+#endif
+
+#if TIME_CRON_SUBMIT_QUEUE_LEN
+void test_cron_submit(void) {
+    cron_job_t others[TIME_CRON_SUBMIT_QUEUE_LEN];
+    tm_system_t texec = 300;
+
+    reset();
+    tm_cron_setup_job(&job, &plain_handler, NULL);
+    TEST_ASSERT_EQUAL(0, tm_cron_submit_job(&job, &texec));
+    // Not applied until the next poll
+    TEST_ASSERT_EQUAL(0, job.active);
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(1, job.active);
+    TEST_ASSERT_EQUAL_PTR(&job, cron_nextjob_p);
+
+    // Reschedule, and then cancel, in one drain.
+    texec = 200;
+    TEST_ASSERT_EQUAL(0, tm_cron_submit_job(&job, &texec));
+    TEST_ASSERT_EQUAL(0, tm_cron_submit_cancel(&job));
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(0, job.active);
+    TEST_ASSERT_NULL(cron_nextjob_p);
+
+    // Fill the queue, in reverse order of execution.
+    for (uint8_t i = 0; i < TIME_CRON_SUBMIT_QUEUE_LEN; i++){
+        texec = 1000 - i;
+        tm_cron_setup_job(&others[i], &plain_handler, NULL);
+        TEST_ASSERT_EQUAL(0, tm_cron_submit_job(&others[i], &texec));
+    }
+    TEST_ASSERT_EQUAL(1, tm_cron_submit_job(&job, &texec));
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL_PTR(&others[TIME_CRON_SUBMIT_QUEUE_LEN - 1], cron_nextjob_p);
+    for (uint8_t i = 0; i < TIME_CRON_SUBMIT_QUEUE_LEN; i++){
+        TEST_ASSERT_EQUAL(0, tm_cron_submit_cancel(&others[i]));
+    }
+    tm_cron_poll();
+    TEST_ASSERT_NULL(cron_nextjob_p);
+    TEST_ASSERT_EQUAL(0, runs);
+}
+#endif
+
+#if TIME_CRON_ENABLE_STATS
+static void slow_handler(void){
+    runs ++;
+    tm_current += 3;
+}
+
+void test_cron_stats(void) {
+    static tm_cron_stats_t stats;
+    tm_system_t texec = 100;
+
+    reset();
+    tm_cron_stats_reset();
+    tm_cron_create_job_abs(&job, &slow_handler, &texec, &period);
+    tm_cron_stats_attach(&job, &stats);
+    TEST_ASSERT_EQUAL_PTR(&stats, tm_cron_stats_next(NULL));
+    TEST_ASSERT_NULL(tm_cron_stats_next(&stats));
+
+    tm_current = 100;
+    tm_cron_poll();
+    tm_current = 205;
+    tm_cron_poll();
+    tm_current = 340;
+    tm_cron_poll();
+
+    TEST_ASSERT_EQUAL(3, runs);
+    TEST_ASSERT_EQUAL(3, stats.runs);
+    TEST_ASSERT_EQUAL(0, stats.late_min);
+    TEST_ASSERT_EQUAL(40, stats.late_max);
+    TEST_ASSERT_EQUAL(15, tm_cron_stats_late_mean(&stats));
+    TEST_ASSERT_EQUAL(3, stats.exec_max);
+    TEST_ASSERT_EQUAL(3, tm_cron_stats_exec_mean(&stats));
+
+    TEST_ASSERT_EQUAL(3, tm_cron_health.runs);
+    TEST_ASSERT_EQUAL(40, tm_cron_health.late_max);
+    TEST_ASSERT_EQUAL(1, tm_cron_health.late_hist[0]);
+    TEST_ASSERT_EQUAL(1, tm_cron_health.late_hist[3]);
+    TEST_ASSERT_EQUAL(1, tm_cron_health.late_hist[6]);
+
+    // Re-creating the job detaches the container. Attaching it again 
+    // keeps it in the list once, with its statistics.
+    tm_cron_cancel_job(&job);
+    texec = 400;
+    tm_cron_create_job_abs(&job, &slow_handler, &texec, &period);
+    TEST_ASSERT_NULL(job.stats_p);
+    tm_cron_stats_attach(&job, &stats);
+    TEST_ASSERT_NULL(tm_cron_stats_next(&stats));
+    tm_current = 400;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(4, stats.runs);
+    tm_cron_cancel_job(&job);
+}
+#endif
+
+int main( int argc, char **argv) {
+    init();
+    UNITY_BEGIN();
+    RUN_TEST(test_cron_oneshot);
+    #if TIME_CRON_ENABLE_POLICIES
+    RUN_TEST(test_cron_policy_catchup);
+    RUN_TEST(test_cron_policy_coalesce);
+    RUN_TEST(test_cron_policy_skip);
+    RUN_TEST(test_cron_policy_alignment);
+    #endif
+    RUN_TEST(test_cron_epoch_change);
+    #if TIME_ENABLE_EPOCH_DEFER
+    RUN_TEST(test_cron_epoch_defer);
+    #endif
+    #if TIME_CRON_ENABLE_SLACK
+    RUN_TEST(test_cron_slack);
+    #endif
+    RUN_TEST(test_cron_instances);
+    #if TIME_CRON_ENABLE_GROUPS && TIME_CRON_ENABLE_POLICIES
+    RUN_TEST(test_cron_groups);
+    #endif
+    #if TIME_CRON_ENABLE_EDF
+    RUN_TEST(test_cron_edf);
+    #endif
+    #if TIME_CRON_ENABLE_BLACKOUT
+    RUN_TEST(test_cron_blackout);
+    #endif
+    #if TIME_CRON_SUBMIT_QUEUE_LEN
+    RUN_TEST(test_cron_submit);
+    #endif
+    #if TIME_CRON_ENABLE_STATS
+    RUN_TEST(test_cron_stats);
+    #endif
+    reset();
+    UNITY_END();
+}
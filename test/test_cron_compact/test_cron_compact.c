@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <unity.h>
+#include <time/time.h>
+#include <time/cron.h>
+#include <time/cron_compact.h>
+#include <scaffold.h>
+
+/*
+ * Tests of the compact cron scheduler, along with a comparison of the
+ * memory used per job and of the poll cost against `cron_job_t`. The
+ * poll benchmark runs the same set of periodic jobs through both
+ * schedulers over the same span of system time, and is only timed on
+ * native builds.
+ */
+
+#if TIME_CRON_ENABLE_COMPACT
+
+#ifdef PIO_NATIVE
+#include <time.h>
+#endif
+
+#define BENCH_JOBS          512
+#define BENCH_SPAN          20000
+
+static tm_cron_cjob_t cjobs[BENCH_JOBS];
+static tm_cron_compact_t compact;
+
+static cron_job_t jobs[BENCH_JOBS];
+static tm_sdelta_t periods[BENCH_JOBS];
+
+static char order[16];
+static uint8_t order_len;
+static uint32_t runs;
+static uint16_t total_missed;
+
+static void log_run(char c){
+    if (order_len < sizeof(order) - 1){
+        order[order_len++] = c;
+        order[order_len] = 0;
+    }
+}
+
+static void handler_a(void){
+    log_run('a');
+}
+
+static void handler_b(void){
+    log_run('b');
+}
+
+static void handler_c(void){
+    log_run('c');
+}
+
+static void missed_handler(uint16_t missed){
+    runs ++;
+    total_missed += missed;
+}
+
+static void count_handler(void){
+    runs ++;
+}
+
+static void cancel_handler(void){
+    runs ++;
+    tm_cron_compact_cancel_job(&compact, 0);
+}
+
+static void reset(void){
+    for (uint16_t i = 0; i < BENCH_JOBS; i++){
+        tm_cron_compact_cancel_job(&compact, i);
+    }
+    tm_current = 0;
+    order_len = 0;
+    order[0] = 0;
+    runs = 0;
+    total_missed = 0;
+}
+
+void test_cron_compact_order(void) {
+    tm_system_t texec = 100;
+    tm_system_t wake;
+
+    reset();
+    TEST_ASSERT_EQUAL(1, tm_cron_compact_next_wake(&compact, &wake));
+    TEST_ASSERT_EQUAL(0, tm_cron_compact_create_job(&compact, 2, &handler_a, &texec, 0));
+    TEST_ASSERT_EQUAL(0, tm_cron_compact_create_job(&compact, 0, &handler_b, &texec, 0));
+    texec = 50;
+    TEST_ASSERT_EQUAL(0, tm_cron_compact_create_job(&compact, 1, &handler_c, &texec, 0));
+    TEST_ASSERT_EQUAL(0, tm_cron_compact_next_wake(&compact, &wake));
+    TEST_ASSERT_EQUAL(50, wake);
+
+    tm_current = 49;
+    tm_cron_compact_poll(&compact);
+    TEST_ASSERT_EQUAL_STRING("", order);
+
+    // Equal execution times run in the order of insertion, not of index.
+    tm_current = 100;
+    tm_cron_compact_poll(&compact);
+    TEST_ASSERT_EQUAL_STRING("cab", order);
+    TEST_ASSERT_EQUAL(TM_CRON_COMPACT_NONE, compact.head);
+}
+
+void test_cron_compact_cancel(void) {
+    tm_system_t texec;
+
+    reset();
+    for (uint16_t i = 0; i < 3; i++){
+        texec = 100 + i;
+        tm_cron_compact_create_job(&compact, i, &handler_a, &texec, 0);
+    }
+    tm_cron_compact_cancel_job(&compact, 1);
+    tm_cron_compact_cancel_job(&compact, 1);
+    TEST_ASSERT_EQUAL(0, compact.head);
+    TEST_ASSERT_EQUAL(2, cjobs[0].next);
+    tm_cron_compact_cancel_job(&compact, 0);
+    TEST_ASSERT_EQUAL(2, compact.head);
+    tm_cron_compact_cancel_job(&compact, 2);
+    TEST_ASSERT_EQUAL(TM_CRON_COMPACT_NONE, compact.head);
+}
+
+void test_cron_compact_self_cancel(void) {
+    tm_system_t texec = 100;
+
+    reset();
+    tm_cron_compact_create_job(&compact, 0, &cancel_handler, &texec, 100);
+    for (tm_system_t t = 100; t <= 500; t += 100){
+        tm_current = t;
+        tm_cron_compact_poll(&compact);
+    }
+    TEST_ASSERT_EQUAL(1, runs);
+    TEST_ASSERT_EQUAL(TM_CRON_COMPACT_NONE, compact.head);
+}
+
+void test_cron_compact_policies(void) {
+    tm_system_t texec = 100;
+
+    reset();
+    tm_cron_compact_create_job(&compact, 0, NULL, &texec, 100);
+    tm_cron_compact_set_policy(&compact, 0, TM_CRON_POLICY_COALESCE);
+    tm_cron_compact_set_missed_handler(&compact, 0, &missed_handler);
+    tm_cron_compact_create_job(&compact, 1, &count_handler, &texec, 100);
+
+    // Slots 100 to 450 are due. CATCHUP runs each of them, over as many
+    // polls as it takes. COALESCE runs once.
+    tm_current = 450;
+    tm_cron_compact_poll(&compact);
+    tm_cron_compact_poll(&compact);
+    TEST_ASSERT_EQUAL(1 + 4, runs);
+    TEST_ASSERT_EQUAL(3, total_missed);
+    tm_cron_compact_get_texec(&compact, 0, &texec);
+    TEST_ASSERT_EQUAL(500, texec);
+    tm_cron_compact_get_texec(&compact, 1, &texec);
+    TEST_ASSERT_EQUAL(500, texec);
+
+    // SKIP drops the late run altogether.
+    tm_cron_compact_set_policy(&compact, 0, TM_CRON_POLICY_SKIP);
+    tm_cron_compact_cancel_job(&compact, 1);
+    tm_current = 750;
+    tm_cron_compact_poll(&compact);
+    TEST_ASSERT_EQUAL(5, runs);
+    tm_current = 800;
+    tm_cron_compact_poll(&compact);
+    TEST_ASSERT_EQUAL(6, runs);
+    TEST_ASSERT_EQUAL(3 + 3, total_missed);
+}
+
+void test_cron_compact_range(void) {
+    tm_system_t texec = TM_CRON_COMPACT_HORIZON;
+    tm_system_t wake;
+    tm_sdelta_t offset = 1000;
+
+    reset();
+    TEST_ASSERT_EQUAL(TM_CRON_COMPACT_E_INDEX,
+                      tm_cron_compact_create_job(&compact, BENCH_JOBS, &handler_a, &texec, 0));
+    TEST_ASSERT_EQUAL(TM_CRON_COMPACT_E_RANGE,
+                      tm_cron_compact_create_job(&compact, 0, &handler_a, &texec, 0));
+    TEST_ASSERT_EQUAL(TM_CRON_COMPACT_E_RANGE,
+                      tm_cron_compact_create_job(&compact, 0, &handler_a, &texec,
+                                                 TM_CRON_COMPACT_HORIZON));
+
+    // A rejected job leaves the job it would replace in place.
+    texec = 100;
+    TEST_ASSERT_EQUAL(0, tm_cron_compact_create_job(&compact, 0, &handler_a, &texec, 0));
+    texec = TM_CRON_COMPACT_HORIZON + 100;
+    TEST_ASSERT_EQUAL(TM_CRON_COMPACT_E_RANGE,
+                      tm_cron_compact_create_job(&compact, 0, &handler_a, &texec, 0));
+    TEST_ASSERT_EQUAL(TM_CRON_COMPACT_E_RANGE,
+                      tm_cron_compact_create_job(&compact, 0, &handler_a, &texec,
+                                                 TM_CRON_COMPACT_HORIZON));
+    TEST_ASSERT_EQUAL(0, tm_cron_compact_next_wake(&compact, &wake));
+    TEST_ASSERT_EQUAL(100, wake);
+    tm_cron_compact_cancel_job(&compact, 0);
+
+    // A periodic job well past the horizon, by way of repeated rebases.
+    texec = 0x30000000;
+    TEST_ASSERT_EQUAL(0, tm_cron_compact_create_job(&compact, 0, &count_handler,
+                                                    &texec, 0x30000000));
+    for (uint8_t i = 1; i <= 8; i++){
+        tm_current = (tm_system_t)i * 0x30000000;
+        tm_cron_compact_poll(&compact);
+        TEST_ASSERT_EQUAL(i, runs);
+        TEST_ASSERT_TRUE(cjobs[0].texec <= 2 * TM_CRON_COMPACT_HORIZON);
+    }
+    TEST_ASSERT_EQUAL(0, tm_cron_compact_next_wake(&compact, &wake));
+    TEST_ASSERT_TRUE(wake == (tm_system_t)9 * 0x30000000);
+
+    // Epoch changes shift the queue in O(1).
+    tm_epoch_change_notify(&offset);
+    TEST_ASSERT_EQUAL(0, tm_cron_compact_next_wake(&compact, &wake));
+    TEST_ASSERT_TRUE(wake == (tm_system_t)9 * 0x30000000 + 1000);
+    offset = -offset;
+    tm_epoch_change_notify(&offset);
+}
+
+#ifdef PIO_NATIVE
+static uint64_t nanos(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+void test_cron_compact_bench(void) {
+    char buffer[120];
+    tm_system_t texec;
+    uint32_t runs_full, runs_compact;
+    uint64_t start = 0, full = 0, packed = 0;
+
+    reset();
+    for (uint16_t i = 0; i < BENCH_JOBS; i++){
+        texec = i % 97;
+        periods[i] = 50 + (i % 13) * 25;
+        tm_cron_create_job_abs(&jobs[i], &count_handler, &texec, &periods[i]);
+        tm_cron_compact_create_job(&compact, i, &count_handler, &texec, periods[i]);
+    }
+
+    #ifdef PIO_NATIVE
+    start = nanos();
+    #endif
+    for (tm_current = 0; tm_current < BENCH_SPAN; tm_current++){
+        tm_cron_poll();
+    }
+    #ifdef PIO_NATIVE
+    full = nanos() - start;
+    #endif
+    runs_full = runs;
+
+    runs = 0;
+    #ifdef PIO_NATIVE
+    start = nanos();
+    #endif
+    for (tm_current = 0; tm_current < BENCH_SPAN; tm_current++){
+        tm_cron_compact_poll(&compact);
+    }
+    #ifdef PIO_NATIVE
+    packed = nanos() - start;
+    #endif
+    runs_compact = runs;
+
+    for (uint16_t i = 0; i < BENCH_JOBS; i++){
+        tm_cron_cancel_job(&jobs[i]);
+    }
+
+    snprintf(buffer, sizeof(buffer),
+             "cron_job_t : %2u + %u bytes per job, %lu runs in %lu us",
+             (unsigned)sizeof(cron_job_t), (unsigned)sizeof(tm_sdelta_t),
+             (unsigned long)runs_full, (unsigned long)(full / 1000));
+    TEST_MESSAGE(buffer);
+    snprintf(buffer, sizeof(buffer),
+             "compact    : %2u bytes per job, %lu runs in %lu us",
+             (unsigned)sizeof(tm_cron_cjob_t),
+             (unsigned long)runs_compact, (unsigned long)(packed / 1000));
+    TEST_MESSAGE(buffer);
+    TEST_ASSERT_EQUAL(runs_full, runs_compact);
+    TEST_ASSERT_TRUE(sizeof(tm_cron_cjob_t) < sizeof(cron_job_t));
+}
+
+#endif
+
+int main( int argc, char **argv) {
+    init();
+    UNITY_BEGIN();
+    #if TIME_CRON_ENABLE_COMPACT
+    tm_cron_compact_init(&compact, cjobs, BENCH_JOBS);
+    RUN_TEST(test_cron_compact_order);
+    RUN_TEST(test_cron_compact_cancel);
+    RUN_TEST(test_cron_compact_self_cancel);
+    RUN_TEST(test_cron_compact_policies);
+    RUN_TEST(test_cron_compact_range);
+    RUN_TEST(test_cron_compact_bench);
+    #endif
+    UNITY_END();
+}
@@ -0,0 +1,255 @@
+#include <string.h>
+#include <unity.h>
+#include <time/time.h>
+#include <time/cron.h>
+#include <time/cron_persist.h>
+#include <scaffold.h>
+
+#ifdef PIO_NATIVE
+#include <unistd.h>
+#endif
+
+static cron_job_t jobs[3];
+static tm_sdelta_t periods[3];
+static uint8_t runs[3];
+
+static void handler_0(void){
+    runs[0] ++;
+}
+
+static void handler_1(void){
+    runs[1] ++;
+}
+
+static void handler_2(void){
+    runs[2] ++;
+}
+
+static const tm_cron_persist_desc_t table[3] = {
+    {&jobs[0], &handler_0, &periods[0], NULL},
+    {&jobs[1], &handler_1, NULL, NULL},
+    {&jobs[2], &handler_2, &periods[2], NULL},
+};
+
+static void clear(void){
+    for (uint8_t i = 0; i < 3; i++){
+        tm_cron_clear_job(&jobs[i]);
+        periods[i] = 0;
+        runs[i] = 0;
+    }
+}
+
+static void populate(void){
+    tm_system_t texec;
+    clear();
+    tm_current = 1000;
+    periods[0] = 100;
+    texec = 1300;
+    tm_cron_create_job_abs(&jobs[0], &handler_0, &texec, &periods[0]);
+    #if TIME_CRON_ENABLE_POLICIES
+    tm_cron_set_policy(&jobs[0], TM_CRON_POLICY_COALESCE);
+    jobs[0].missed = 4;
+    #endif
+    #if TIME_CRON_ENABLE_SLACK
+    tm_cron_set_slack(&jobs[0], 20);
+    #endif
+    texec = 1200;
+    tm_cron_create_job_abs(&jobs[1], &handler_1, &texec, NULL);
+    periods[2] = 50;
+    texec = 1300;
+    tm_cron_create_job_abs(&jobs[2], &handler_2, &texec, &periods[2]);
+}
+
+void test_cron_persist_roundtrip(void) {
+    uint8_t image[TM_CRON_PERSIST_SIZE(3)];
+    tm_system_t texec;
+    #if TIME_CRON_ENABLE_BLACKOUT
+    static tm_interval_t windows_items[1];
+    tm_interval_set_t windows;
+    tm_interval_t window = {1250, 1400};
+    tm_interval_set_init(&windows, windows_items, 1);
+    tm_interval_set_add(&windows, &window);
+    #endif
+
+    populate();
+    TEST_ASSERT_EQUAL(sizeof(image), tm_cron_persist_save(image, sizeof(image), table, 3));
+
+    // Warm restart. Configuration which is not saved is set again 
+    // before the restore.
+    clear();
+    TEST_ASSERT_NULL(cron_nextjob_p);
+    #if TIME_CRON_ENABLE_EDF
+    tm_cron_set_priority(&jobs[0], 0);
+    tm_cron_set_deadline(&jobs[0], 30);
+    #endif
+    #if TIME_CRON_ENABLE_BLACKOUT
+    tm_cron_set_blackout(&jobs[2], &windows);
+    #endif
+    TEST_ASSERT_EQUAL(0, tm_cron_persist_restore(image, sizeof(image), table, 3));
+    #if TIME_CRON_ENABLE_EDF
+    TEST_ASSERT_EQUAL(0, jobs[0].prio);
+    TEST_ASSERT_EQUAL(30, jobs[0].deadline);
+    TEST_ASSERT_EQUAL(TM_CRON_PRIO_DEFAULT, jobs[1].prio);
+    #endif
+
+    TEST_ASSERT_EQUAL_PTR(&jobs[1], cron_nextjob_p);
+    TEST_ASSERT_EQUAL_PTR(&jobs[0], jobs[1].nextjob);
+    TEST_ASSERT_EQUAL_PTR(&jobs[2], jobs[0].nextjob);
+    TEST_ASSERT_NULL(jobs[2].nextjob);
+    TEST_ASSERT_EQUAL_PTR(&jobs[0], jobs[2].prevjob);
+
+    tm_cron_get_texec(&jobs[0], &texec);
+    TEST_ASSERT_EQUAL_INT64(1300, texec);
+    TEST_ASSERT_EQUAL(100, periods[0]);
+    TEST_ASSERT_EQUAL(50, periods[2]);
+    #if TIME_CRON_ENABLE_POLICIES
+    TEST_ASSERT_EQUAL(TM_CRON_POLICY_COALESCE, jobs[0].flags & TM_CRON_POLICY_MASK);
+    TEST_ASSERT_EQUAL(4, jobs[0].missed);
+    #endif
+    #if TIME_CRON_ENABLE_SLACK
+    TEST_ASSERT_EQUAL(20, jobs[0].slack);
+    #endif
+    TEST_ASSERT_NULL(jobs[1].tafter_p);
+
+    tm_current = 1200;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(1, runs[1]);
+    TEST_ASSERT_EQUAL(0, jobs[1].active);
+
+    #if TIME_CRON_ENABLE_BLACKOUT
+    // Blackout windows still apply to the restored job.
+    TEST_ASSERT_EQUAL_PTR(&windows, jobs[2].blackout_p);
+    tm_current = 1300;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(0, runs[2]);
+    tm_cron_get_texec(&jobs[2], &texec);
+    TEST_ASSERT_EQUAL_INT64(1400, texec);
+    #endif
+    clear();
+}
+
+void test_cron_persist_cold(void) {
+    uint8_t image[TM_CRON_PERSIST_SIZE(3)];
+
+    populate();
+    tm_cron_persist_save(image, sizeof(image), table, 3);
+    clear();
+    // Jobs in RAM which was not initialized are prepared in full, apart 
+    // from the configuration the application sets before the restore.
+    memset(jobs, 0xA5, sizeof(jobs));
+    for (uint8_t i = 0; i < 3; i++){
+        jobs[i].active = 0;
+        #if TIME_CRON_ENABLE_STATS
+        jobs[i].stats_p = NULL;
+        #endif
+        #if TIME_CRON_ENABLE_GROUPS
+        jobs[i].group = 0;
+        #endif
+        #if TIME_CRON_ENABLE_EDF
+        jobs[i].prio = TM_CRON_PRIO_DEFAULT;
+        jobs[i].deadline = 0;
+        #endif
+        #if TIME_CRON_ENABLE_BLACKOUT
+        jobs[i].blackout_p = NULL;
+        #endif
+    }
+    TEST_ASSERT_EQUAL(0, tm_cron_persist_restore(image, sizeof(image), table, 3));
+    for (uint8_t i = 0; i < 3; i++){
+        TEST_ASSERT_EQUAL(1, jobs[i].active);
+        #if TIME_CRON_ENABLE_POOL
+        TEST_ASSERT_EQUAL(0, jobs[i].pending);
+        #endif
+    }
+    #if TIME_CRON_ENABLE_SLACK
+    TEST_ASSERT_EQUAL(20, jobs[0].slack);
+    #endif
+    clear();
+}
+
+void test_cron_persist_epoch(void) {
+    uint8_t image[TM_CRON_PERSIST_SIZE(3)];
+    tm_sdelta_t offset = 500;
+    tm_system_t texec;
+
+    populate();
+    tm_cron_epoch_change_handler(&offset);
+    tm_cron_persist_save(image, sizeof(image), table, 3);
+    clear();
+    offset = -500;
+    tm_cron_epoch_change_handler(&offset);
+    TEST_ASSERT_EQUAL(0, tm_cron_persist_restore(image, sizeof(image), table, 3));
+    // Execution times are saved against the epoch.
+    tm_cron_get_texec(&jobs[1], &texec);
+    TEST_ASSERT_EQUAL_INT64(1700, texec);
+    clear();
+}
+
+void test_cron_persist_merge(void) {
+    uint8_t image[TM_CRON_PERSIST_SIZE(3)];
+    uint16_t len;
+    tm_system_t texec = 1250;
+
+    populate();
+    tm_cron_cancel_job(&jobs[1]);
+    len = tm_cron_persist_save(image, sizeof(image), table, 3);
+    TEST_ASSERT_EQUAL(TM_CRON_PERSIST_SIZE(2), len);
+    tm_cron_cancel_job(&jobs[0]);
+    tm_cron_cancel_job(&jobs[2]);
+
+    tm_cron_create_job_abs(&jobs[1], &handler_1, &texec, NULL);
+    TEST_ASSERT_EQUAL(0, tm_cron_persist_restore(image, len, table, 3));
+    TEST_ASSERT_EQUAL_PTR(&jobs[1], cron_nextjob_p);
+    TEST_ASSERT_EQUAL_PTR(&jobs[0], jobs[1].nextjob);
+    TEST_ASSERT_EQUAL_PTR(&jobs[2], jobs[0].nextjob);
+    clear();
+}
+
+void test_cron_persist_invalid(void) {
+    uint8_t image[TM_CRON_PERSIST_SIZE(3)];
+    uint16_t len;
+
+    populate();
+    TEST_ASSERT_EQUAL(0, tm_cron_persist_save(image, TM_CRON_PERSIST_SIZE(2), table, 3));
+    len = tm_cron_persist_save(image, sizeof(image), table, 3);
+
+    // Jobs already in the queue are not disturbed.
+    TEST_ASSERT_EQUAL(TM_CRON_PERSIST_E_ACTIVE, tm_cron_persist_restore(image, len, table, 3));
+    clear();
+    TEST_ASSERT_EQUAL(TM_CRON_PERSIST_E_ID, tm_cron_persist_restore(image, len, table, 2));
+    TEST_ASSERT_EQUAL(TM_CRON_PERSIST_E_FORMAT, tm_cron_persist_restore(image, len - 1, table, 3));
+    image[len - 1] ^= 0x01;
+    TEST_ASSERT_EQUAL(TM_CRON_PERSIST_E_CHECK, tm_cron_persist_restore(image, len, table, 3));
+    image[0] ^= 0xFF;
+    TEST_ASSERT_EQUAL(TM_CRON_PERSIST_E_FORMAT, tm_cron_persist_restore(image, len, table, 3));
+    TEST_ASSERT_NULL(cron_nextjob_p);
+}
+
+#if TIME_CRON_PERSIST_LEN
+void test_cron_persist_store(void) {
+    populate();
+    TEST_ASSERT_EQUAL(0, tm_cron_persist_checkpoint(table, 3));
+    clear();
+    TEST_ASSERT_EQUAL(0, tm_cron_persist_recover(table, 3));
+    TEST_ASSERT_EQUAL_PTR(&jobs[1], cron_nextjob_p);
+    clear();
+    tm_cron_persist_discard();
+    TEST_ASSERT_EQUAL(TM_CRON_PERSIST_E_FORMAT, tm_cron_persist_recover(table, 3));
+    #ifdef PIO_NATIVE
+    unlink(TIME_CRON_PERSIST_FILE);
+    #endif
+}
+#endif
+
+int main( int argc, char **argv) {
+    init();
+    UNITY_BEGIN();
+    RUN_TEST(test_cron_persist_roundtrip);
+    RUN_TEST(test_cron_persist_cold);
+    RUN_TEST(test_cron_persist_epoch);
+    RUN_TEST(test_cron_persist_merge);
+    RUN_TEST(test_cron_persist_invalid);
+    #if TIME_CRON_PERSIST_LEN
+    RUN_TEST(test_cron_persist_store);
+    #endif
+    UNITY_END();
+}
@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <unity.h>
+#include <time/time.h>
+#include <time/cron.h>
+#include <time/cron_pool.h>
+#include <time/cron_stats.h>
+#include <scaffold.h>
+
+/*
+ * Tests and benchmark of parallel cron dispatch on hosted builds.
+ *
+ * The benchmark runs a set of periodic jobs with handlers which block
+ * for a fixed time, at increasing numbers of worker threads, and reports
+ * the number of runs completed and the lateness of the runs. Lateness is
+ * measured against the system time, which is driven from the monotonic
+ * clock by the polling loop, and is only as precise as the poll rate.
+ */
+
+#if TIME_CRON_ENABLE_POOL
+
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_JOBS          32
+#define BENCH_PERIOD        10
+#define BENCH_HANDLER_US    2000
+#define BENCH_DURATION      300
+
+static cron_job_t jobs[BENCH_JOBS];
+static tm_sdelta_t periods[BENCH_JOBS];
+static tm_cron_pool_t pool;
+
+static int inside;
+static int inside_max;
+static int overlaps;
+static int job_inside;
+static uint32_t runs;
+static uint32_t total_missed;
+
+static void enter(void){
+    int now = __atomic_add_fetch(&inside, 1, __ATOMIC_SEQ_CST);
+    int max = __atomic_load_n(&inside_max, __ATOMIC_SEQ_CST);
+    while (now > max &&
+           !__atomic_compare_exchange_n(&inside_max, &max, now, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+}
+
+static void leave(void){
+    __atomic_sub_fetch(&inside, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&runs, 1, __ATOMIC_SEQ_CST);
+}
+
+static void slow_handler(void){
+    enter();
+    usleep(20000);
+    leave();
+}
+
+static void serial_handler(uint16_t missed){
+    if (__atomic_add_fetch(&job_inside, 1, __ATOMIC_SEQ_CST) > 1){
+        __atomic_add_fetch(&overlaps, 1, __ATOMIC_SEQ_CST);
+    }
+    usleep(2000);
+    __atomic_add_fetch(&total_missed, missed, __ATOMIC_SEQ_CST);
+    __atomic_sub_fetch(&job_inside, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&runs, 1, __ATOMIC_SEQ_CST);
+}
+
+static void overlap_handler(void){
+    if (__atomic_add_fetch(&job_inside, 1, __ATOMIC_SEQ_CST) > 1){
+        __atomic_add_fetch(&overlaps, 1, __ATOMIC_SEQ_CST);
+    }
+    usleep(20000);
+    __atomic_sub_fetch(&job_inside, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&runs, 1, __ATOMIC_SEQ_CST);
+}
+
+static void bench_handler(void){
+    usleep(BENCH_HANDLER_US);
+}
+
+static void reset(void){
+    for (uint8_t i = 0; i < BENCH_JOBS; i++){
+        tm_cron_clear_job(&jobs[i]);
+    }
+    tm_current = 0;
+    inside = inside_max = overlaps = job_inside = 0;
+    runs = total_missed = 0;
+}
+
+void test_cron_pool_parallel(void) {
+    tm_system_t texec = 10;
+    reset();
+    TEST_ASSERT_EQUAL(0, tm_cron_pool_start(&pool, 4));
+    tm_cron_sched_attach_pool(&tm_cron_default, &pool);
+    for (uint8_t i = 0; i < 4; i++){
+        tm_cron_create_job_abs(&jobs[i], &slow_handler, &texec, NULL);
+    }
+    tm_current = 10;
+    tm_cron_poll();
+    // The poll returns before the handlers do.
+    TEST_ASSERT_NULL(cron_nextjob_p);
+    tm_cron_pool_wait(&pool);
+    TEST_ASSERT_EQUAL(4, runs);
+    TEST_ASSERT_TRUE(inside_max > 1);
+    tm_cron_sched_attach_pool(&tm_cron_default, NULL);
+    tm_cron_pool_stop(&pool);
+}
+
+static void run_serialized(uint8_t policy){
+    tm_system_t texec = 10;
+    reset();
+    TEST_ASSERT_EQUAL(0, tm_cron_pool_start(&pool, 4));
+    tm_cron_sched_attach_pool(&tm_cron_default, &pool);
+    periods[0] = 10;
+    tm_cron_create_job_abs(&jobs[0], NULL, &texec, &periods[0]);
+    tm_cron_set_policy(&jobs[0], policy);
+    tm_cron_set_missed_handler(&jobs[0], &serial_handler);
+    // Slots at 10, 20 .. 100 are all due, faster than the handler runs.
+    tm_current = 100;
+    for (uint8_t i = 0; i < 20; i++){
+        tm_cron_poll();
+    }
+    tm_cron_pool_wait(&pool);
+    tm_cron_sched_attach_pool(&tm_cron_default, NULL);
+    tm_cron_pool_stop(&pool);
+    tm_cron_cancel_job(&jobs[0]);
+    TEST_ASSERT_EQUAL(0, overlaps);
+}
+
+void test_cron_pool_serialized_catchup(void) {
+    run_serialized(TM_CRON_POLICY_CATCHUP);
+    TEST_ASSERT_EQUAL(10, runs);
+    TEST_ASSERT_EQUAL(0, total_missed);
+}
+
+void test_cron_pool_serialized_coalesce(void) {
+    run_serialized(TM_CRON_POLICY_COALESCE);
+    TEST_ASSERT_EQUAL(1, runs);
+    TEST_ASSERT_EQUAL(9, total_missed);
+}
+
+void test_cron_pool_clear_pending(void) {
+    tm_system_t texec = 10;
+    reset();
+    TEST_ASSERT_EQUAL(0, tm_cron_pool_start(&pool, 2));
+    tm_cron_sched_attach_pool(&tm_cron_default, &pool);
+    periods[0] = 10;
+    tm_cron_create_job_abs(&jobs[0], NULL, &texec, &periods[0]);
+    tm_cron_set_policy(&jobs[0], TM_CRON_POLICY_CATCHUP);
+    tm_cron_set_missed_handler(&jobs[0], &serial_handler);
+    tm_current = 100;
+    for (uint8_t i = 0; i < 20; i++){
+        tm_cron_poll();
+    }
+    // Clearing the job drops the runs still pending behind the current 
+    // one, rather than leaving the worker to count past zero.
+    tm_cron_clear_job(&jobs[0]);
+    tm_cron_pool_wait(&pool);
+    tm_cron_sched_attach_pool(&tm_cron_default, NULL);
+    tm_cron_pool_stop(&pool);
+    TEST_ASSERT_TRUE(runs < 10);
+    TEST_ASSERT_EQUAL(0, jobs[0].pending);
+    TEST_ASSERT_EQUAL(0, overlaps);
+}
+
+void test_cron_pool_recreate_running(void) {
+    tm_system_t texec = 10;
+    reset();
+    TEST_ASSERT_EQUAL(0, tm_cron_pool_start(&pool, 2));
+    tm_cron_sched_attach_pool(&tm_cron_default, &pool);
+    tm_cron_create_job_abs(&jobs[0], &overlap_handler, &texec, NULL);
+    tm_current = 10;
+    tm_cron_poll();
+    while (!(__atomic_load_n(&jobs[0].pool_state, __ATOMIC_SEQ_CST) & 
+             TM_CRON_POOL_RUNNING)){
+        sched_yield();
+    }
+    // The run of the re-created job waits for the executing run, on the 
+    // same worker, rather than starting on the idle one.
+    texec = 20;
+    tm_cron_create_job_abs(&jobs[0], &overlap_handler, &texec, NULL);
+    tm_current = 20;
+    tm_cron_poll();
+    tm_cron_pool_wait(&pool);
+    tm_cron_sched_attach_pool(&tm_cron_default, NULL);
+    tm_cron_pool_stop(&pool);
+    TEST_ASSERT_EQUAL(2, runs);
+    TEST_ASSERT_EQUAL(0, overlaps);
+    TEST_ASSERT_EQUAL(0, jobs[0].pending);
+    TEST_ASSERT_EQUAL(0, jobs[0].pool_state);
+}
+
+static uint64_t millis(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000ULL;
+}
+
+static void bench(uint8_t workers){
+    char buffer[100];
+    uint64_t start;
+    uint32_t done;
+    tm_system_t texec;
+
+    reset();
+    tm_cron_stats_reset();
+    if (workers){
+        TEST_ASSERT_EQUAL(0, tm_cron_pool_start(&pool, workers));
+        tm_cron_sched_attach_pool(&tm_cron_default, &pool);
+    }
+    for (uint8_t i = 0; i < BENCH_JOBS; i++){
+        periods[i] = BENCH_PERIOD;
+        texec = i % BENCH_PERIOD;
+        tm_cron_create_job_abs(&jobs[i], &bench_handler, &texec, &periods[i]);
+        tm_cron_set_policy(&jobs[i], TM_CRON_POLICY_COALESCE);
+    }
+    start = millis();
+    while ((tm_current = millis() - start) < BENCH_DURATION){
+        tm_cron_poll();
+    }
+    for (uint8_t i = 0; i < BENCH_JOBS; i++){
+        tm_cron_cancel_job(&jobs[i]);
+    }
+    if (workers){
+        tm_cron_pool_wait(&pool);
+        tm_cron_sched_attach_pool(&tm_cron_default, NULL);
+        tm_cron_pool_stop(&pool);
+    }
+    done = tm_cron_health.runs;
+    snprintf(buffer, sizeof(buffer),
+             "%u workers: %5lu runs of %lu slots, late max %lu ms",
+             workers, (unsigned long)done,
+             (unsigned long)(BENCH_JOBS * BENCH_DURATION / BENCH_PERIOD),
+             (unsigned long)tm_cron_health.late_max);
+    TEST_MESSAGE(buffer);
+    TEST_ASSERT_TRUE(done > 0);
+}
+
+void test_cron_pool_bench(void) {
+    // The handlers block rather than compute, so worker counts beyond
+    // the number of CPUs remain meaningful.
+    bench(0);
+    for (uint8_t workers = 1; workers <= TIME_CRON_POOL_MAX_WORKERS; workers *= 2){
+        bench(workers);
+    }
+}
+
+#endif
+
+int main( int argc, char **argv) {
+    init();
+    UNITY_BEGIN();
+    #if TIME_CRON_ENABLE_POOL
+    RUN_TEST(test_cron_pool_parallel);
+    RUN_TEST(test_cron_pool_serialized_catchup);
+    RUN_TEST(test_cron_pool_serialized_coalesce);
+    RUN_TEST(test_cron_pool_clear_pending);
+    RUN_TEST(test_cron_pool_recreate_running);
+    RUN_TEST(test_cron_pool_bench);
+    #endif
+    UNITY_END();
+}
@@ -0,0 +1,151 @@
+#include <unity.h>
+#include <time/time.h>
+#include <time/cron.h>
+#include <time/cron_spec.h>
+#include <scaffold.h>
+
+
+void test_cron_spec_compile_basic(void) {
+    tm_cron_spec_t spec;
+    TEST_ASSERT_EQUAL(0, tm_cron_spec_compile("0 2 * * *", &spec));
+    TEST_ASSERT_EQUAL_UINT64(1, spec.minutes);
+    TEST_ASSERT_EQUAL_UINT32(1 << 2, spec.hours);
+    TEST_ASSERT_EQUAL_UINT32(TM_CRON_SPEC_ALL_DOM, spec.dom);
+    TEST_ASSERT_EQUAL_UINT16(TM_CRON_SPEC_ALL_MONTHS, spec.months);
+    TEST_ASSERT_EQUAL_UINT8(TM_CRON_SPEC_ALL_DOW, spec.dow);
+}
+
+void test_cron_spec_compile_lists(void) {
+    tm_cron_spec_t spec;
+    TEST_ASSERT_EQUAL(0, tm_cron_spec_compile("*/15 8-10,20 1,15 1-12/6 7", &spec));
+    TEST_ASSERT_EQUAL_UINT64((1ULL << 0) | (1ULL << 15) | (1ULL << 30) | (1ULL << 45),
+                             spec.minutes);
+    TEST_ASSERT_EQUAL_UINT32((1 << 8) | (1 << 9) | (1 << 10) | (1 << 20), spec.hours);
+    TEST_ASSERT_EQUAL_UINT32((1 << 1) | (1 << 15), spec.dom);
+    TEST_ASSERT_EQUAL_UINT16((1 << 1) | (1 << 7), spec.months);
+    TEST_ASSERT_EQUAL_UINT8(1, spec.dow);
+}
+
+void test_cron_spec_compile_errors(void) {
+    tm_cron_spec_t spec;
+    TEST_ASSERT_EQUAL(1, tm_cron_spec_compile("60 * * * *", &spec));
+    TEST_ASSERT_EQUAL(2, tm_cron_spec_compile("0 5-3 * * *", &spec));
+    TEST_ASSERT_EQUAL(3, tm_cron_spec_compile("0 0 0 * *", &spec));
+    TEST_ASSERT_EQUAL(4, tm_cron_spec_compile("0 0 * 13 *", &spec));
+    TEST_ASSERT_EQUAL(5, tm_cron_spec_compile("0 0 * *", &spec));
+    TEST_ASSERT_EQUAL(6, tm_cron_spec_compile("0 0 * * * *", &spec));
+    TEST_ASSERT_EQUAL(1, tm_cron_spec_compile("*/0 * * * *", &spec));
+}
+
+void test_cron_spec_next_daily(void) {
+    tm_cron_spec_t spec;
+    tm_system_t after = 1704067200000;   // 2024-01-01 00:00
+    tm_system_t next;
+    tm_cron_spec_compile("0 2 * * *", &spec);
+    TEST_ASSERT_EQUAL(0, tm_cron_spec_next(&spec, &after, &next));
+    TEST_ASSERT_EQUAL_INT64(1704074400000, next);
+    // Strictly after the provided time
+    after = next;
+    TEST_ASSERT_EQUAL(0, tm_cron_spec_next(&spec, &after, &next));
+    TEST_ASSERT_EQUAL_INT64(1704160800000, next);
+}
+
+void test_cron_spec_next_month_rollover(void) {
+    tm_cron_spec_t spec;
+    tm_system_t after = 1705276800000;   // 2024-01-15 00:00
+    tm_system_t next;
+    tm_cron_spec_compile("0 0 1 * *", &spec);
+    TEST_ASSERT_EQUAL(0, tm_cron_spec_next(&spec, &after, &next));
+    TEST_ASSERT_EQUAL_INT64(1706745600000, next);
+
+    after = 1706745540000;               // 2024-01-31 23:59
+    TEST_ASSERT_EQUAL(0, tm_cron_spec_next(&spec, &after, &next));
+    TEST_ASSERT_EQUAL_INT64(1706745600000, next);
+}
+
+void test_cron_spec_next_leap_day(void) {
+    tm_cron_spec_t spec;
+    tm_system_t after = 1709251200000;   // 2024-03-01 00:00
+    tm_system_t next;
+    tm_cron_spec_compile("0 0 29 2 *", &spec);
+    TEST_ASSERT_EQUAL(0, tm_cron_spec_next(&spec, &after, &next));
+    TEST_ASSERT_EQUAL_INT64(1835395200000, next);
+}
+
+void test_cron_spec_next_weekday(void) {
+    tm_cron_spec_t spec;
+    tm_system_t after = 1704153600000;   // 2024-01-02 00:00, Tuesday
+    tm_system_t next;
+    tm_cron_spec_compile("30 8 * * 1", &spec);
+    TEST_ASSERT_EQUAL(0, tm_cron_spec_next(&spec, &after, &next));
+    TEST_ASSERT_EQUAL_INT64(1704702600000, next);
+}
+
+void test_cron_spec_next_dom_or_dow(void) {
+    tm_cron_spec_t spec;
+    tm_system_t after = 1704067200000;   // 2024-01-01 00:00, Monday
+    tm_system_t next;
+    // Either the 13th or a Friday
+    tm_cron_spec_compile("0 0 13 * 5", &spec);
+    TEST_ASSERT_EQUAL(0, tm_cron_spec_next(&spec, &after, &next));
+    TEST_ASSERT_EQUAL_INT64(1704412800000, next);
+}
+
+void test_cron_spec_next_impossible(void) {
+    tm_cron_spec_t spec;
+    tm_system_t after = 1704067200000;
+    tm_system_t next;
+    tm_cron_spec_compile("0 0 30 2 *", &spec);
+    TEST_ASSERT_NOT_EQUAL(0, tm_cron_spec_next(&spec, &after, &next));
+}
+
+#if TIME_CRON_ENABLE_SPEC
+static uint8_t spec_job_runs;
+
+static void spec_job_handler(void){
+    spec_job_runs ++;
+}
+
+void test_cron_spec_job(void) {
+    cron_job_t job;
+    tm_cron_spec_t spec;
+    tm_system_t saved = tm_current;
+
+    spec_job_runs = 0;
+    tm_cron_spec_compile("0 2 * * *", &spec);
+    tm_current = 1704067200000;
+    tm_cron_create_job_spec(&job, &spec_job_handler, &spec);
+    TEST_ASSERT_EQUAL(1, job.active);
+    TEST_ASSERT_EQUAL_INT64(1704074400000, job.texec);
+
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(0, spec_job_runs);
+
+    tm_current = 1704074400000;
+    tm_cron_poll();
+    TEST_ASSERT_EQUAL(1, spec_job_runs);
+    TEST_ASSERT_EQUAL(1, job.active);
+    TEST_ASSERT_EQUAL_INT64(1704160800000, job.texec);
+
+    tm_cron_cancel_job(&job);
+    tm_current = saved;
+}
+#endif
+
+int main( int argc, char **argv) {
+    init();
+    UNITY_BEGIN();
+    RUN_TEST(test_cron_spec_compile_basic);
+    RUN_TEST(test_cron_spec_compile_lists);
+    RUN_TEST(test_cron_spec_compile_errors);
+    RUN_TEST(test_cron_spec_next_daily);
+    RUN_TEST(test_cron_spec_next_month_rollover);
+    RUN_TEST(test_cron_spec_next_leap_day);
+    RUN_TEST(test_cron_spec_next_weekday);
+    RUN_TEST(test_cron_spec_next_dom_or_dow);
+    RUN_TEST(test_cron_spec_next_impossible);
+    #if TIME_CRON_ENABLE_SPEC
+    RUN_TEST(test_cron_spec_job);
+    #endif
+    UNITY_END();
+}
@@ -0,0 +1,358 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <time/time.h>
+#include <time/cron.h>
+#include <scaffold.h>
+
+/*
+ * Randomized test of the cron queue against a simple reference model.
+ *
+ * The model keeps, for each job, whether it is active, its absolute
+ * execution time, and an insertion sequence number used to order jobs
+ * with equal execution times, along with the slack window used to batch
+ * jobs into wakes. After every operation, the queue is checked against
+ * the model. On native builds, the time spent in each type of operation
+ * (excluding the checks) is reported.
+ */
+
+#ifdef PIO_NATIVE
+#include <time.h>
+#define STRESS_ITERATIONS   2000000UL
+#else
+#define STRESS_ITERATIONS   2000UL
+#endif
+
+#define STRESS_JOBS         64
+#define STRESS_SEED         0x2545F491UL
+
+#define OP_INSERT           0
+#define OP_CANCEL           1
+#define OP_REPLACE          2
+#define OP_POLL             3
+#define OP_SHIFT            4
+#define OP_COUNT            5
+
+static const char * op_names[OP_COUNT] =
+    {"insert", "cancel", "replace", "poll", "shift"};
+
+typedef struct MODEL_JOB_t{
+    uint8_t active;
+    uint8_t policy;
+    uint16_t slack;
+    tm_system_t texec;
+    tm_sdelta_t period;
+    uint32_t seq;
+} model_job_t;
+
+static cron_job_t jobs[STRESS_JOBS];
+static tm_sdelta_t periods[STRESS_JOBS];
+static model_job_t model[STRESS_JOBS];
+static uint32_t model_seq;
+static uint32_t fired;
+static uint32_t rng_state = STRESS_SEED;
+
+static uint32_t op_count[OP_COUNT];
+static uint64_t op_nanos[OP_COUNT];
+
+static uint32_t rng(void){
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void stress_handler(void){
+    fired ++;
+}
+
+#ifdef PIO_NATIVE
+static uint64_t nanos(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#else
+static uint64_t nanos(void){
+    return 0;
+}
+#endif
+
+static int8_t model_cmp(model_job_t * a, model_job_t * b){
+    if (a->texec != b->texec){
+        return a->texec < b->texec ? -1 : 1;
+    }
+    if (a->seq != b->seq){
+        return a->seq < b->seq ? -1 : 1;
+    }
+    return 0;
+}
+
+static int model_qsort_cmp(const void * a, const void * b){
+    return model_cmp(&model[*(const uint8_t *)a], &model[*(const uint8_t *)b]);
+}
+
+static uint8_t model_order(uint8_t * order){
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < STRESS_JOBS; i++){
+        if (model[i].active){
+            order[n++] = i;
+        }
+    }
+    qsort(order, n, sizeof(uint8_t), &model_qsort_cmp);
+    return n;
+}
+
+static int16_t model_head(void){
+    int16_t head = -1;
+    for (uint8_t i = 0; i < STRESS_JOBS; i++){
+        if (!model[i].active){
+            continue;
+        }
+        if (head < 0 || model_cmp(&model[i], &model[head]) < 0){
+            head = i;
+        }
+    }
+    return head;
+}
+
+static void check_invariants(void){
+    cron_job_t * walker = cron_nextjob_p;
+    cron_job_t * prev = NULL;
+    model_job_t * prev_model = NULL;
+    uint8_t count = 0;
+    uint8_t active = 0;
+    tm_system_t texec;
+    int idx;
+
+    for (uint8_t i = 0; i < STRESS_JOBS; i++){
+        active += model[i].active;
+        TEST_ASSERT_EQUAL(model[i].active, jobs[i].active);
+    }
+    while (walker){
+        idx = (int)(walker - jobs);
+        TEST_ASSERT_TRUE(idx >= 0 && idx < STRESS_JOBS);
+        TEST_ASSERT_EQUAL_PTR(prev, walker->prevjob);
+        TEST_ASSERT_TRUE(model[idx].active);
+        tm_cron_get_texec(walker, &texec);
+        TEST_ASSERT_EQUAL_INT64(model[idx].texec, texec);
+        if (prev_model){
+            // Ordered by texec, and by insertion among equals.
+            TEST_ASSERT_TRUE(model_cmp(prev_model, &model[idx]) < 0);
+        }
+        prev_model = &model[idx];
+        prev = walker;
+        walker = walker->nextjob;
+        count ++;
+        TEST_ASSERT_TRUE(count <= STRESS_JOBS);
+    }
+    TEST_ASSERT_EQUAL(active, count);
+}
+
+static void model_insert(uint8_t i, tm_system_t texec){
+    model[i].active = 1;
+    model[i].texec = texec;
+    model[i].seq = model_seq ++;
+}
+
+static void do_insert(uint8_t i){
+    tm_system_t texec = tm_current + (rng() % 2000);
+    uint64_t start;
+    if (jobs[i].active){
+        return;
+    }
+    model[i].policy = rng() % 3;
+    model[i].period = (rng() & 1) ? (1 + rng() % 500) : 0;
+    model[i].slack = (rng() & 1) ? (1 + rng() % 100) : 0;
+    #if !TIME_CRON_ENABLE_POLICIES
+    model[i].policy = TM_CRON_POLICY_CATCHUP;
+    #endif
+    #if !TIME_CRON_ENABLE_SLACK
+    model[i].slack = 0;
+    #endif
+    periods[i] = model[i].period;
+    model_insert(i, texec);
+
+    start = nanos();
+    tm_cron_create_job_abs(&jobs[i], &stress_handler, &texec,
+                           model[i].period ? &periods[i] : NULL);
+    #if TIME_CRON_ENABLE_POLICIES
+    tm_cron_set_policy(&jobs[i], model[i].policy);
+    #endif
+    #if TIME_CRON_ENABLE_SLACK
+    tm_cron_set_slack(&jobs[i], model[i].slack);
+    #endif
+    op_nanos[OP_INSERT] += nanos() - start;
+    op_count[OP_INSERT] ++;
+}
+
+static void do_cancel(uint8_t i){
+    uint64_t start = nanos();
+    tm_cron_cancel_job(&jobs[i]);
+    op_nanos[OP_CANCEL] += nanos() - start;
+    op_count[OP_CANCEL] ++;
+    model[i].active = 0;
+}
+
+static void do_replace(uint8_t i){
+    tm_system_t texec = tm_current + (rng() % 2000);
+    uint64_t start;
+    if (!jobs[i].active){
+        return;
+    }
+    model_insert(i, texec);
+    start = nanos();
+    jobs[i].texec = texec - cron_epoch_offset;
+    tm_cron_replace_job(&jobs[i]);
+    op_nanos[OP_REPLACE] += nanos() - start;
+    op_count[OP_REPLACE] ++;
+}
+
+static uint8_t model_fire(uint8_t i){
+    tm_sdelta_t late = tm_current - model[i].texec;
+    tm_sdelta_t slots = 1;
+    uint8_t runs = 1;
+    if (model[i].period){
+        if (model[i].policy != TM_CRON_POLICY_CATCHUP &&
+                late >= model[i].period){
+            slots = late / model[i].period + 1;
+        }
+        if (model[i].policy == TM_CRON_POLICY_SKIP && slots > 1){
+            runs = 0;
+        }
+        model_insert(i, model[i].texec + model[i].period * slots);
+    }
+    else{
+        model[i].active = 0;
+    }
+    return runs;
+}
+
+static void do_poll(void){
+    uint8_t order[STRESS_JOBS];
+    uint8_t n, count = 0;
+    int16_t head;
+    uint32_t fired_before = fired;
+    uint32_t runs = 0;
+    tm_system_t wake = 0, wake_cron;
+    uint64_t start;
+
+    tm_current += rng() % 50;
+
+    // Batch wake, as the earliest window end among the jobs due by it.
+    n = model_order(order);
+    if (n){
+        wake = model[order[0]].texec + model[order[0]].slack;
+        count = 1;
+        while (count < n && model[order[count]].texec <= wake){
+            if (model[order[count]].texec + model[order[count]].slack < wake){
+                wake = model[order[count]].texec + model[order[count]].slack;
+            }
+            count ++;
+        }
+        TEST_ASSERT_EQUAL(0, tm_cron_next_wake(&wake_cron));
+        TEST_ASSERT_EQUAL_INT64(wake, wake_cron);
+    }
+    if (n && wake <= tm_current){
+        while (count--){
+            head = model_head();
+            if (head < 0 || model[head].texec > tm_current){
+                break;
+            }
+            runs += model_fire(head);
+        }
+    }
+
+    start = nanos();
+    tm_cron_poll();
+    op_nanos[OP_POLL] += nanos() - start;
+    op_count[OP_POLL] ++;
+    TEST_ASSERT_EQUAL(fired_before + runs, fired);
+}
+
+static void do_shift(void){
+    tm_sdelta_t offset = (tm_sdelta_t)(rng() % 2001) - 1000;
+    uint64_t start = nanos();
+    tm_cron_epoch_change_handler(&offset);
+    op_nanos[OP_SHIFT] += nanos() - start;
+    op_count[OP_SHIFT] ++;
+    for (uint8_t i = 0; i < STRESS_JOBS; i++){
+        model[i].texec += offset;
+    }
+}
+
+void test_cron_stress(void) {
+    uint32_t r;
+    uint8_t i;
+    char buffer[80];
+
+    tm_current = 1000000;
+    for (i = 0; i < STRESS_JOBS; i++){
+        tm_cron_setup_job(&jobs[i], &stress_handler, NULL);
+    }
+
+    for (uint32_t n = 0; n < STRESS_ITERATIONS; n++){
+        r = rng() % 100;
+        i = rng() % STRESS_JOBS;
+        if (r < 30){
+            do_insert(i);
+        }
+        else if (r < 40){
+            do_cancel(i);
+        }
+        else if (r < 55){
+            do_replace(i);
+        }
+        else if (r < 99){
+            do_poll();
+        }
+        else{
+            do_shift();
+        }
+        check_invariants();
+        if (Unity.CurrentTestFailed){
+            snprintf(buffer, sizeof(buffer), "Failed at iteration %lu",
+                     (unsigned long)n);
+            TEST_MESSAGE(buffer);
+            break;
+        }
+    }
+
+    for (i = 0; i < STRESS_JOBS; i++){
+        tm_cron_cancel_job(&jobs[i]);
+    }
+    TEST_ASSERT_NULL(cron_nextjob_p);
+
+    #ifdef PIO_NATIVE
+    for (i = 0; i < OP_COUNT; i++){
+        snprintf(buffer, sizeof(buffer), "%-8s %9lu ops %8.1f ns/op",
+                 op_names[i], (unsigned long)op_count[i],
+                 op_count[i] ? (double)op_nanos[i] / op_count[i] : 0.0);
+        TEST_MESSAGE(buffer);
+    }
+    #endif
+}
+
+void test_cron_cancel_inactive(void) {
+    cron_job_t idle;
+    cron_job_t queued;
+    tm_system_t texec = tm_current + 100;
+
+    tm_cron_setup_job(&idle, &stress_handler, NULL);
+    tm_cron_create_job_abs(&queued, &stress_handler, &texec, NULL);
+    // Neither of these may disturb the queue.
+    tm_cron_cancel_job(&idle);
+    tm_cron_clear_job(&idle);
+    TEST_ASSERT_EQUAL_PTR(&queued, cron_nextjob_p);
+    tm_cron_cancel_job(&queued);
+    tm_cron_cancel_job(&queued);
+    TEST_ASSERT_NULL(cron_nextjob_p);
+}
+
+int main( int argc, char **argv) {
+    init();
+    UNITY_BEGIN();
+    RUN_TEST(test_cron_cancel_inactive);
+    RUN_TEST(test_cron_stress);
+    UNITY_END();
+}
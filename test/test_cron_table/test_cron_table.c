@@ -0,0 +1,196 @@
+#include <unity.h>
+#include <time/time.h>
+#include <time/cron.h>
+#include <time/cron_table.h>
+#include <scaffold.h>
+
+#if TIME_CRON_ENABLE_TABLES
+
+static char order[16];
+static uint8_t order_len;
+
+static void log_run(char c){
+    if (order_len < sizeof(order) - 1){
+        order[order_len++] = c;
+        order[order_len] = 0;
+    }
+}
+
+static void handler_a(void){
+    log_run('a');
+}
+
+static void handler_b(void){
+    log_run('b');
+}
+
+static void handler_d(void){
+    log_run('d');
+}
+
+static const tm_cron_table_entry_t entries[] = {
+    TM_CRON_TABLE_ENTRY(&handler_a, 100, 0),
+    TM_CRON_TABLE_ENTRY(&handler_b, 300, 350),
+};
+static uint32_t state[2];
+static tm_cron_table_t table = TM_CRON_TABLE_INIT(entries, state);
+
+static tm_cron_sched_t sched_check;
+static tm_cron_sched_t sched;
+
+static void reset(void){
+    tm_current = 0;
+    order_len = 0;
+    order[0] = 0;
+}
+
+void test_cron_table_check(void) {
+    static const tm_cron_table_entry_t bad_period[] = {
+        {&handler_a, 0, 0},
+    };
+    static const tm_cron_table_entry_t bad_phase[] = {
+        {&handler_a, 100, 100},
+    };
+    static const tm_cron_table_entry_t unsorted[] = {
+        {&handler_b, 100, 50}, {&handler_a, 50, 0},
+    };
+    static uint32_t scratch[2];
+    tm_cron_table_t empty = {NULL, entries, scratch, 0, 0, 0, 0, 0};
+    tm_cron_table_t t1 = TM_CRON_TABLE_INIT(bad_period, scratch);
+    tm_cron_table_t t2 = TM_CRON_TABLE_INIT(bad_phase, scratch);
+    static tm_cron_table_t t3 = TM_CRON_TABLE_INIT(unsorted, scratch);
+
+    reset();
+    TEST_ASSERT_EQUAL(TM_CRON_TABLE_E_EMPTY, tm_cron_sched_attach_table(&sched_check, &empty));
+    TEST_ASSERT_EQUAL(TM_CRON_TABLE_E_ENTRY, tm_cron_sched_attach_table(&sched_check, &t1));
+    TEST_ASSERT_EQUAL(TM_CRON_TABLE_E_ENTRY, tm_cron_sched_attach_table(&sched_check, &t2));
+    TEST_ASSERT_NULL(sched_check.tables_p);
+
+    // Entries need not be sorted. Those due together run in table order.
+    tm_current = 1;
+    TEST_ASSERT_EQUAL(0, tm_cron_sched_attach_table(&sched_check, &t3));
+    tm_current = 50;
+    tm_cron_sched_poll(&sched_check);
+    TEST_ASSERT_EQUAL_STRING("ba", order);
+    tm_current = 100;
+    tm_cron_sched_poll(&sched_check);
+    TEST_ASSERT_EQUAL_STRING("baa", order);
+}
+
+void test_cron_table_run(void) {
+    cron_job_t job;
+    tm_system_t texec = 1200;
+    tm_system_t wake;
+    tm_sdelta_t offset = 50;
+
+    reset();
+    TEST_ASSERT_EQUAL(50, entries[1].phase);
+    tm_current = 1001;
+    TEST_ASSERT_EQUAL(0, tm_cron_sched_attach_table(&sched, &table));
+
+    // First runs are at the next aligned times, 1100 and 1250.
+    TEST_ASSERT_EQUAL(0, tm_cron_sched_next_wake(&sched, &wake));
+    TEST_ASSERT_EQUAL(1100, wake);
+    tm_current = 1099;
+    tm_cron_sched_poll(&sched);
+    TEST_ASSERT_EQUAL_STRING("", order);
+    tm_current = 1100;
+    tm_cron_sched_poll(&sched);
+    TEST_ASSERT_EQUAL_STRING("a", order);
+
+    // Dynamic jobs run ahead of table entries due at the same time.
+    tm_cron_sched_create_job_abs(&sched, &job, &handler_d, &texec, NULL);
+    tm_current = 1250;
+    tm_cron_sched_poll(&sched);
+    TEST_ASSERT_EQUAL_STRING("adab", order);
+    TEST_ASSERT_EQUAL(3, table.runs);
+
+    // Missed runs are coalesced.
+    tm_current = 1650;
+    tm_cron_sched_poll(&sched);
+    TEST_ASSERT_EQUAL_STRING("adabab", order);
+    TEST_ASSERT_EQUAL(3, table.missed);
+    TEST_ASSERT_EQUAL(0, tm_cron_sched_next_wake(&sched, &wake));
+    TEST_ASSERT_EQUAL(1700, wake);
+
+    // Tables follow epoch changes with the job queue.
+    tm_epoch_change_notify(&offset);
+    TEST_ASSERT_EQUAL(0, tm_cron_sched_next_wake(&sched, &wake));
+    TEST_ASSERT_EQUAL(1750, wake);
+    offset = -offset;
+    tm_epoch_change_notify(&offset);
+}
+
+void test_cron_table_rebase(void) {
+    static const tm_cron_table_entry_t slow[] = {
+        TM_CRON_TABLE_ENTRY(&handler_a, 0x60000000UL, 0),
+    };
+    static uint32_t slow_state[1];
+    static tm_cron_sched_t sched_slow;
+    tm_cron_table_t t = TM_CRON_TABLE_INIT(slow, slow_state);
+    tm_system_t wake;
+
+    reset();
+    tm_current = 1;
+    tm_cron_sched_init(&sched_slow);
+    TEST_ASSERT_EQUAL(0, tm_cron_sched_attach_table(&sched_slow, &t));
+    for (uint8_t i = 1; i <= 4; i++){
+        tm_current = (tm_system_t)i * 0x60000000LL;
+        tm_cron_sched_poll(&sched_slow);
+        TEST_ASSERT_EQUAL(i, t.runs);
+        TEST_ASSERT_EQUAL(0, tm_cron_sched_next_wake(&sched_slow, &wake));
+        TEST_ASSERT_TRUE(wake == (tm_system_t)(i + 1) * 0x60000000LL);
+    }
+    TEST_ASSERT_EQUAL(0, t.missed);
+}
+
+void test_cron_table_long_gap(void) {
+    static const tm_cron_table_entry_t fast[] = {
+        TM_CRON_TABLE_ENTRY(&handler_a, 1000, 0),
+        TM_CRON_TABLE_ENTRY(&handler_b, 3000, 500),
+    };
+    static uint32_t fast_state[2];
+    static tm_cron_sched_t sched_gap;
+    tm_cron_table_t t = TM_CRON_TABLE_INIT(fast, fast_state);
+    tm_system_t wake;
+
+    // A table attached exactly on a slot runs in that slot.
+    reset();
+    tm_cron_sched_init(&sched_gap);
+    TEST_ASSERT_EQUAL(0, tm_cron_sched_attach_table(&sched_gap, &t));
+    TEST_ASSERT_EQUAL(0, tm_cron_sched_next_wake(&sched_gap, &wake));
+    TEST_ASSERT_EQUAL_INT64(0, wake);
+    tm_cron_sched_poll(&sched_gap);
+    TEST_ASSERT_EQUAL_STRING("a", order);
+
+    // After a gap longer than the offsets can span, each entry runs once, 
+    // in order of the slots it is late for, and stays on its slots.
+    tm_current = 5000000000LL;
+    tm_cron_sched_poll(&sched_gap);
+    TEST_ASSERT_EQUAL_STRING("aba", order);
+    TEST_ASSERT_EQUAL(4999999 + 1666666, t.missed);
+    TEST_ASSERT_EQUAL(0, tm_cron_sched_next_wake(&sched_gap, &wake));
+    TEST_ASSERT_TRUE(wake == 5000001000LL);
+    tm_current = 5000001500LL;
+    tm_cron_sched_poll(&sched_gap);
+    TEST_ASSERT_EQUAL_STRING("abaab", order);
+    TEST_ASSERT_EQUAL(4999999 + 1666666, t.missed);
+    TEST_ASSERT_EQUAL(0, tm_cron_sched_next_wake(&sched_gap, &wake));
+    TEST_ASSERT_TRUE(wake == 5000002000LL);
+}
+
+#endif
+
+int main( int argc, char **argv) {
+    init();
+    UNITY_BEGIN();
+    #if TIME_CRON_ENABLE_TABLES
+    tm_cron_sched_init(&sched_check);
+    tm_cron_sched_init(&sched);
+    RUN_TEST(test_cron_table_check);
+    RUN_TEST(test_cron_table_run);
+    RUN_TEST(test_cron_table_rebase);
+    RUN_TEST(test_cron_table_long_gap);
+    #endif
+    UNITY_END();
+}
@@ -0,0 +1,182 @@
+#include <string.h>
+#include <unity.h>
+#include <time/time.h>
+#include <scaffold.h>
+
+/*
+ * Tests of the ordering of epoch change handlers, and of deferred and
+ * coalesced dispatch of epoch changes.
+ */
+
+static char order[16];
+static uint8_t order_len;
+static tm_sdelta_t seen[4];
+static uint8_t calls[4];
+
+static void record(uint8_t index, char c, tm_sdelta_t * sdelta){
+    if (order_len < sizeof(order) - 1){
+        order[order_len++] = c;
+        order[order_len] = 0;
+    }
+    seen[index] = *sdelta;
+    calls[index] ++;
+}
+
+static void handler_a(tm_sdelta_t * sdelta){
+    record(0, 'a', sdelta);
+}
+
+static void handler_b(tm_sdelta_t * sdelta){
+    record(1, 'b', sdelta);
+}
+
+static void handler_c(tm_sdelta_t * sdelta){
+    record(2, 'c', sdelta);
+}
+
+static void handler_d(void * ctx, tm_sdelta_t * sdelta){
+    record(3, *(char *)ctx, sdelta);
+}
+
+static char d_name = 'd';
+
+static tm_epochchange_handler_t handlers[] = {
+    {.priority = 5, .func = &handler_a},
+    {.priority = 1, .func = &handler_b},
+    {.priority = 5, .func = &handler_c},
+    {.priority = 0, .func_ctx = &handler_d, .ctx = &d_name},
+};
+
+static void reset(void){
+    order_len = 0;
+    order[0] = 0;
+    memset(seen, 0, sizeof(seen));
+    memset(calls, 0, sizeof(calls));
+}
+
+void test_epoch_handler_order(void) {
+    tm_sdelta_t sdelta = 10;
+
+    reset();
+    tm_epoch_change_notify(&sdelta);
+    TEST_ASSERT_EQUAL_STRING("dbac", order);
+    for (uint8_t i = 0; i < 4; i++){
+        TEST_ASSERT_EQUAL(1, calls[i]);
+        TEST_ASSERT_TRUE(seen[i] == 10);
+    }
+    sdelta = -sdelta;
+    tm_epoch_change_notify(&sdelta);
+}
+
+#if TIME_ENABLE_EPOCH_DEFER
+
+void test_epoch_defer_coalesce(void) {
+    tm_sdelta_t sdelta;
+
+    reset();
+    TEST_ASSERT_EQUAL(0, tm_epoch_change_dispatch());
+
+    // A burst of steps is seen once, as the cumulative delta.
+    sdelta = 10;
+    tm_epoch_change_post(&sdelta, 1);
+    sdelta = -3;
+    tm_epoch_change_post(&sdelta, 1);
+    sdelta = 20;
+    tm_epoch_change_post(&sdelta, 1);
+    TEST_ASSERT_EQUAL(0, order_len);
+    TEST_ASSERT_EQUAL(1, tm_epoch_change_dispatch());
+    TEST_ASSERT_EQUAL_STRING("dbac", order);
+    TEST_ASSERT_TRUE(seen[0] == 27);
+    TEST_ASSERT_EQUAL(0, tm_epoch_change_dispatch());
+    TEST_ASSERT_EQUAL(1, calls[0]);
+
+    // Steps which cancel out are not seen at all.
+    sdelta = 5;
+    tm_epoch_change_post(&sdelta, 1);
+    sdelta = -5;
+    tm_epoch_change_post(&sdelta, 1);
+    TEST_ASSERT_EQUAL(0, tm_epoch_change_dispatch());
+    TEST_ASSERT_EQUAL(1, calls[0]);
+
+    // A change which is not followed overrides the rest.
+    sdelta = 5;
+    tm_epoch_change_post(&sdelta, 1);
+    tm_epoch_change_post(&sdelta, 0);
+    TEST_ASSERT_EQUAL(1, tm_epoch_change_dispatch());
+    TEST_ASSERT_EQUAL(2, calls[0]);
+    TEST_ASSERT_TRUE(seen[0] == 0);
+
+    // Changes followed after one which is not are still seen.
+    tm_epoch_change_post(&sdelta, 0);
+    sdelta = 7;
+    tm_epoch_change_post(&sdelta, 1);
+    TEST_ASSERT_EQUAL(1, tm_epoch_change_dispatch());
+    TEST_ASSERT_EQUAL(4, calls[0]);
+    TEST_ASSERT_TRUE(seen[0] == 7);
+
+    sdelta = -34;
+    tm_epoch_change_notify(&sdelta);
+}
+
+void test_epoch_defer_handler(void) {
+    tm_sdelta_t sdelta = 10;
+
+    reset();
+    tm_epoch_change_post(&sdelta, 1);
+    TEST_ASSERT_EQUAL(1, tm_epoch_change_dispatch_handler(&handlers[2]));
+    TEST_ASSERT_EQUAL_STRING("c", order);
+    TEST_ASSERT_EQUAL(0, tm_epoch_change_dispatch_handler(&handlers[2]));
+
+    // The others still see the change, and the dispatched handler does 
+    // not see it twice.
+    TEST_ASSERT_EQUAL(1, tm_epoch_change_dispatch());
+    TEST_ASSERT_EQUAL_STRING("cdba", order);
+    TEST_ASSERT_EQUAL(1, calls[2]);
+
+    sdelta = -10;
+    tm_epoch_change_post(&sdelta, 1);
+    TEST_ASSERT_EQUAL(1, tm_epoch_change_dispatch());
+}
+
+void test_epoch_defer_set_epoch(void) {
+    tm_real_t original, shifted;
+    tm_system_t before;
+    tm_sdelta_t shift;
+
+    reset();
+    tm_current = 1000;
+    memcpy(&original, &tm_epoch, sizeof(tm_real_t));
+    memcpy(&shifted, &tm_epoch, sizeof(tm_real_t));
+    shifted.date += 1;
+
+    before = tm_current;
+    tm_set_epoch(&shifted, 1);
+    shift = tm_current - before;
+    TEST_ASSERT_TRUE(shift != 0);
+    TEST_ASSERT_EQUAL(0, order_len);
+    TEST_ASSERT_EQUAL(1, tm_epoch_change_dispatch());
+    TEST_ASSERT_TRUE(seen[0] == shift);
+    TEST_ASSERT_TRUE(seen[3] == shift);
+
+    tm_set_epoch(&original, 1);
+    TEST_ASSERT_EQUAL(1, tm_epoch_change_dispatch());
+    TEST_ASSERT_TRUE(seen[0] == -shift);
+    TEST_ASSERT_TRUE(tm_current == 1000);
+}
+
+#endif
+
+int main( int argc, char **argv) {
+    init();
+    for (uint8_t i = 0; i < 4; i++){
+        tm_register_epoch_change_handler(&handlers[i]);
+    }
+    UNITY_BEGIN();
+    RUN_TEST(test_epoch_handler_order);
+    #if TIME_ENABLE_EPOCH_DEFER
+    RUN_TEST(test_epoch_defer_coalesce);
+    RUN_TEST(test_epoch_defer_handler);
+    RUN_TEST(test_epoch_defer_set_epoch);
+    #endif
+    UNITY_END();
+}
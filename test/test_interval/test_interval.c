@@ -0,0 +1,119 @@
+#include <unity.h>
+#include <time/time.h>
+#include <time/interval.h>
+#include <scaffold.h>
+
+static tm_interval_t items[4];
+static tm_interval_set_t set;
+
+static void add(tm_system_t start, tm_system_t end, uint8_t rval){
+    tm_interval_t interval = {start, end};
+    TEST_ASSERT_EQUAL(rval, tm_interval_set_add(&set, &interval));
+}
+
+static void remove_span(tm_system_t start, tm_system_t end, uint8_t rval){
+    tm_interval_t interval = {start, end};
+    TEST_ASSERT_EQUAL(rval, tm_interval_set_remove(&set, &interval));
+}
+
+static void check(uint16_t index, tm_system_t start, tm_system_t end){
+    TEST_ASSERT_TRUE(index < set.count);
+    TEST_ASSERT_EQUAL_INT64(start, set.items[index].start);
+    TEST_ASSERT_EQUAL_INT64(end, set.items[index].end);
+}
+
+static void reset(void){
+    tm_interval_set_init(&set, items, 4);
+}
+
+void test_interval_add(void) {
+    reset();
+    add(100, 200, 0);
+    add(300, 400, 0);
+    add(0, 50, 0);
+    add(60, 60, 0);
+    TEST_ASSERT_EQUAL(3, set.count);
+    check(0, 0, 50);
+    check(1, 100, 200);
+    check(2, 300, 400);
+
+    // Touching intervals are merged, as are those spanned by a new one.
+    add(50, 60, 0);
+    check(0, 0, 60);
+    add(150, 350, 0);
+    TEST_ASSERT_EQUAL(2, set.count);
+    check(1, 100, 400);
+
+    add(500, 600, 0);
+    add(700, 800, 0);
+    add(900, 1000, 1);
+    TEST_ASSERT_EQUAL(4, set.count);
+    // A full set can still grow an existing interval.
+    add(790, 850, 0);
+    check(3, 700, 850);
+}
+
+void test_interval_remove(void) {
+    reset();
+    add(100, 400, 0);
+    add(500, 600, 0);
+    remove_span(200, 300, 0);
+    TEST_ASSERT_EQUAL(3, set.count);
+    check(0, 100, 200);
+    check(1, 300, 400);
+    remove_span(350, 550, 0);
+    check(1, 300, 350);
+    check(2, 550, 600);
+    remove_span(0, 1000, 0);
+    TEST_ASSERT_EQUAL(0, set.count);
+
+    add(0, 10, 0);
+    add(20, 30, 0);
+    add(40, 50, 0);
+    add(60, 70, 0);
+    remove_span(2, 4, 1);
+    TEST_ASSERT_EQUAL(4, set.count);
+    check(0, 0, 10);
+}
+
+void test_interval_query(void) {
+    tm_system_t t;
+    tm_interval_t span;
+    tm_system_t before = 150;
+
+    reset();
+    add(100, 200, 0);
+    add(300, 400, 0);
+    t = 99;
+    TEST_ASSERT_NULL(tm_interval_set_find(&set, &t));
+    t = 100;
+    TEST_ASSERT_EQUAL_PTR(&items[0], tm_interval_set_find(&set, &t));
+    t = 200;
+    TEST_ASSERT_NULL(tm_interval_set_find(&set, &t));
+    t = 399;
+    TEST_ASSERT_EQUAL_PTR(&items[1], tm_interval_set_find(&set, &t));
+
+    span.start = 200;
+    span.end = 300;
+    TEST_ASSERT_NULL(tm_interval_set_overlap(&set, &span));
+    span.end = 301;
+    TEST_ASSERT_EQUAL_PTR(&items[1], tm_interval_set_overlap(&set, &span));
+    span.start = 0;
+    TEST_ASSERT_EQUAL_PTR(&items[0], tm_interval_set_overlap(&set, &span));
+
+    tm_interval_set_expire(&set, &before);
+    TEST_ASSERT_EQUAL(2, set.count);
+    before = 200;
+    tm_interval_set_expire(&set, &before);
+    TEST_ASSERT_EQUAL(1, set.count);
+    check(0, 300, 400);
+}
+
+int main( int argc, char **argv) {
+    init();
+    UNITY_BEGIN();
+    RUN_TEST(test_interval_add);
+    RUN_TEST(test_interval_remove);
+    RUN_TEST(test_interval_query);
+    UNITY_END();
+}
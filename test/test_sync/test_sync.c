@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include <time/time.h>
+#include <time/sync.h>
+#include <time/systick_handler.h>
+#include <scaffold.h>
+
+/*
+ * Tests of the sync clock filter and servo. The offset error of the 
+ * filter is compared with that of applying each exchange as it is, over 
+ * a simulated transport whose one-way delays carry asymmetric random 
+ * spikes, as a delayed UART or USB transaction would. The servo is run 
+ * against a simulated local oscillator with a frequency error. The 
+ * telemetry registers are read after an exchange, and block mode 
+ * exchanges are made through the UCDM registers.
+ */
+
+#if TIME_ENABLE_SYNC && TIME_SYNC_FILTER_LEN
+
+#define SIM_EXCHANGES       400
+#define SIM_SETTLE          50
+
+static tm_sync_filter_t filter;
+static uint32_t seed;
+
+static void reset(void){
+    tm_sync_filter_reset(&filter);
+    seed = 12345;
+}
+
+static uint32_t sim_random(uint32_t range){
+    seed = seed * 1103515245UL + 12345;
+    return (seed >> 16) % range;
+}
+
+static tm_sdelta_t sim_delay(uint8_t spikes){
+    tm_sdelta_t delay = 2 + sim_random(2);
+    if (spikes && sim_random(4) == 0){
+        delay += sim_random(40);
+    }
+    return delay;
+}
+
+static tm_sdelta_t abs_delta(tm_sdelta_t value){
+    return (value < 0) ? -value : value;
+}
+
+static void reset_sync(void){
+    memset(&tm_sync_sm.telemetry, 0, sizeof(tm_sync_telemetry_t));
+    tm_sync_filter_reset(&tm_sync_sm.filter);
+    #if TIME_ENABLE_SYNC_SERVO
+    tm_sync_servo_reset(&tm_sync_clock.servo);
+    #endif
+    #if TIME_ENABLE_SYNC_BLOCK
+    tm_sync_sm.block_state = TM_SYNC_BLOCK_IDLE;
+    #endif
+    tm_current = 0;
+}
+
+static uint32_t read_u32(ucdm_addr_t address){
+    return ucdm_get_register(address) | 
+           ((uint32_t)ucdm_get_register(address + 1) << 16);
+}
+
+void test_sync_telemetry(void) {
+    ucdm_addr_t base = ucdm_addr_sync_telemetry;
+    ucdm_addr_t since = base + sizeof(tm_sync_telemetry_t) / 2;
+
+    tm_current = 0;
+    TEST_ASSERT_EQUAL_UINT32(0, read_u32(base + 6));
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, read_u32(since));
+
+    // The local clock is 10 ms ahead, with 3 ms of delay each way.
+    tm_sync_sm.t1 = 0;
+    tm_sync_sm.t1p = 13;
+    tm_sync_sm.t2 = 20;
+    tm_sync_sm.t2p = 13;
+    tm_sync_sm.state = TM_SYNC_STATE_WAIT_DELAY_IN;
+    tm_sync_handler(ucdm_addr_sync_telemetry - 1);
+    TEST_ASSERT_EQUAL(TM_SYNC_STATE_IDLE, tm_sync_sm.state);
+
+    TEST_ASSERT_EQUAL_INT32(10, (int32_t)read_u32(base));
+    TEST_ASSERT_EQUAL_INT32(3, (int32_t)read_u32(base + 2));
+    TEST_ASSERT_EQUAL_UINT32(0, read_u32(base + 4));
+    TEST_ASSERT_EQUAL_UINT32(1, read_u32(base + 6));
+    #if TIME_ENABLE_SYNC_SERVO
+    TEST_ASSERT_EQUAL(TM_SYNC_CLOCK_LOCKING, ucdm_get_register(base + 8));
+    #endif
+    TEST_ASSERT_EQUAL_UINT32(0, read_u32(since));
+    tm_current = 5000;
+    TEST_ASSERT_EQUAL_UINT32(5, read_u32(since));
+
+    reset_sync();
+}
+
+#if TIME_ENABLE_SYNC_BLOCK
+
+static tm_sdelta_t theta;
+
+/*
+ * One block mode exchange, with the local clock ahead of the host by 
+ * theta, and 3 ms of delay each way. Returns the t2p for the next one.
+ */
+static tm_system_t block_exchange(tm_system_t host, tm_system_t t2p){
+    tm_sync_block_t block = {host, t2p};
+    uint16_t words[sizeof(tm_sync_block_t) / 2];
+    memcpy(words, &block, sizeof(block));
+    tm_current = host + 3 + theta;
+    for (uint8_t i = 0; i < sizeof(tm_sync_block_t) / 2; i++){
+        ucdm_set_register(ucdm_addr_sync_block + i, words[i]);
+    }
+    theta = tm_current - (host + 3);
+    tm_current = host + 5 + theta;
+    ucdm_get_register(ucdm_addr_sync_block - 1);
+    return host + 8;
+}
+
+void test_sync_block(void) {
+    ucdm_addr_t base = ucdm_addr_sync_telemetry;
+    tm_system_t t2p;
+
+    reset_sync();
+    theta = 10;
+    t2p = block_exchange(1000, 0);
+    TEST_ASSERT_EQUAL_UINT32(0, read_u32(base + 6));
+    t2p = block_exchange(2000, t2p);
+    TEST_ASSERT_EQUAL_UINT32(1, read_u32(base + 6));
+    TEST_ASSERT_EQUAL_INT32(10, (int32_t)read_u32(base));
+    TEST_ASSERT_EQUAL_INT32(3, (int32_t)read_u32(base + 2));
+
+    // A stepped correction also applies to the exchange in progress.
+    reset_sync();
+    theta = 500;
+    t2p = block_exchange(1000, 0);
+    t2p = block_exchange(2000, t2p);
+    TEST_ASSERT_EQUAL_INT32(500, (int32_t)read_u32(base));
+    TEST_ASSERT_EQUAL_INT64(0, theta);
+    t2p = block_exchange(3000, t2p);
+    TEST_ASSERT_EQUAL_INT32(0, (int32_t)read_u32(base));
+    TEST_ASSERT_EQUAL_INT32(3, (int32_t)read_u32(base + 2));
+
+    // Without a delay measurement, nothing is applied.
+    t2p = block_exchange(4000, 0);
+    TEST_ASSERT_EQUAL_UINT32(2, read_u32(base + 6));
+    reset_sync();
+}
+
+#endif
+
+void test_sync_filter_select(void) {
+    tm_sdelta_t correction = 0;
+
+    reset();
+    // The first sample is applied as it is. The local clock is 100 ms 
+    // ahead of the host, with 4 ms of delay each way.
+    TEST_ASSERT_EQUAL(1, tm_sync_filter_add(&filter, 104, -96, &correction));
+    TEST_ASSERT_EQUAL_INT64(-100, correction);
+    TEST_ASSERT_EQUAL_INT64(8, filter.delay);
+
+    // A delayed exchange is not selected while a faster one is held.
+    TEST_ASSERT_EQUAL(0, tm_sync_filter_add(&filter, 34, 4, &correction));
+    TEST_ASSERT_EQUAL_INT64(8, filter.delay);
+    TEST_ASSERT_EQUAL(1, filter.held);
+
+    // A faster exchange is selected and applied, but only once.
+    TEST_ASSERT_EQUAL(1, tm_sync_filter_add(&filter, 3, 1, &correction));
+    TEST_ASSERT_EQUAL_INT64(-1, correction);
+    TEST_ASSERT_EQUAL_INT64(4, filter.delay);
+    TEST_ASSERT_EQUAL(0, tm_sync_filter_add(&filter, 6, 6, &correction));
+    TEST_ASSERT_EQUAL(2, filter.held);
+}
+
+void test_sync_filter_consistency(void) {
+    tm_sdelta_t correction = 0;
+
+    reset();
+    TEST_ASSERT_EQUAL(1, tm_sync_filter_add(&filter, 2, 2, &correction));
+    TEST_ASSERT_EQUAL(0, tm_sync_filter_add(&filter, 3, 3, &correction));
+    TEST_ASSERT_EQUAL(0, tm_sync_filter_add(&filter, 3, 3, &correction));
+
+    // A fast exchange which disagrees with most of the ring is held.
+    TEST_ASSERT_EQUAL(0, tm_sync_filter_add(&filter, 51, -49, &correction));
+    TEST_ASSERT_EQUAL_INT64(2, filter.delay);
+    TEST_ASSERT_EQUAL_INT64(50, filter.offset);
+    TEST_ASSERT_EQUAL(3, filter.held);
+
+    // Once the step has been confirmed by most of the ring, it is applied.
+    for (uint8_t i = 0; i < 2; i++){
+        TEST_ASSERT_EQUAL(0, tm_sync_filter_add(&filter, 53, -47, &correction));
+    }
+    TEST_ASSERT_EQUAL(1, tm_sync_filter_add(&filter, 53, -47, &correction));
+    TEST_ASSERT_EQUAL_INT64(-50, correction);
+}
+
+void test_sync_filter_jitter(void) {
+    char buffer[100];
+    tm_sdelta_t correction;
+    tm_sdelta_t d1, d2, offset;
+    tm_sdelta_t naive = 0, filtered = 0;
+    tm_sdelta_t naive_max = 0, filtered_max = 0;
+    tm_sdelta_t naive_err = 0, filtered_err = 0;
+
+    reset();
+    for (uint16_t i = 0; i < SIM_EXCHANGES; i++){
+        // Only the host to device direction sees spikes.
+        d1 = sim_delay(1);
+        d2 = sim_delay(0);
+
+        // Each exchange is applied as it is.
+        offset = ((naive + d1) - (-naive + d2)) / 2;
+        naive -= offset;
+
+        if (tm_sync_filter_add(&filter, filtered + d1, -filtered + d2, &correction)){
+            filtered += correction;
+        }
+
+        if (i >= SIM_SETTLE){
+            naive_err += abs_delta(naive);
+            filtered_err += abs_delta(filtered);
+            if (abs_delta(naive) > naive_max){
+                naive_max = abs_delta(naive);
+            }
+            if (abs_delta(filtered) > filtered_max){
+                filtered_max = abs_delta(filtered);
+            }
+        }
+    }
+
+    snprintf(buffer, sizeof(buffer), "naive    : mean error %4lu us, max %3ld ms",
+             (unsigned long)(naive_err * 1000 / (SIM_EXCHANGES - SIM_SETTLE)),
+             (long)naive_max);
+    TEST_MESSAGE(buffer);
+    snprintf(buffer, sizeof(buffer), "filtered : mean error %4lu us, max %3ld ms",
+             (unsigned long)(filtered_err * 1000 / (SIM_EXCHANGES - SIM_SETTLE)),
+             (long)filtered_max);
+    TEST_MESSAGE(buffer);
+    TEST_ASSERT_TRUE(filtered_max <= 1);
+    TEST_ASSERT_TRUE(filtered_err * 4 < naive_err);
+}
+
+#if TIME_ENABLE_SYNC_SERVO
+
+#define SIM_DRIFT_TICKS     5000
+#define SIM_SYNC_INTERVAL   10000
+#define SIM_DURATION        1200000L
+
+static tm_sync_servo_t servo;
+static tm_system_t sim_host;
+static tm_sdelta_t sim_max_jump;
+
+/*
+ * Run the local clock against the host for a while, exchanging with the 
+ * host every SIM_SYNC_INTERVAL ms if `sync` is set. The local oscillator 
+ * runs 200 ppm fast. Returns the offset of the local clock at the end.
+ */
+static tm_sdelta_t sim_run(tm_sdelta_t duration, uint8_t sync){
+    tm_sdelta_t correction, offset;
+    tm_system_t last = tm_current;
+    tm_system_t end = sim_host + duration;
+
+    for (sim_host++; sim_host <= end; sim_host++){
+        time_systick_handler();
+        if (sim_host % SIM_DRIFT_TICKS == 0){
+            time_systick_handler();
+        }
+        if (tm_current - last > sim_max_jump){
+            sim_max_jump = tm_current - last;
+        }
+        TEST_ASSERT_TRUE(tm_current >= last);
+        if (sync && sim_host % SIM_SYNC_INTERVAL == 0){
+            offset = tm_current - sim_host;
+            if (!tm_sync_filter_add(&filter, offset + sim_delay(0), 
+                                    -offset + sim_delay(0), &correction)){
+                tm_sync_servo_hold(&servo);
+            }
+            else if (tm_sync_servo_update(&servo, &correction)){
+                tm_apply_sdelta((tm_system_t *)&tm_current, &correction);
+            }
+        }
+        last = tm_current;
+    }
+    sim_host = end;
+    return tm_current - sim_host;
+}
+
+static void sim_reset(void){
+    reset();
+    tm_sync_servo_reset(&servo);
+    sim_host = 0;
+    sim_max_jump = 0;
+}
+
+void test_sync_servo(void) {
+    char buffer[100];
+    tm_sdelta_t offset;
+
+    sim_reset();
+    // The local clock starts 300 ms ahead.
+    tm_current = 300;
+    TEST_ASSERT_EQUAL(TM_SYNC_CLOCK_UNSYNCED, tm_sync_servo_state(&servo));
+    offset = sim_run(SIM_SYNC_INTERVAL, 1);
+    TEST_ASSERT_EQUAL(TM_SYNC_CLOCK_LOCKING, tm_sync_servo_state(&servo));
+    offset = sim_run(SIM_DURATION, 1);
+
+    snprintf(buffer, sizeof(buffer), "servo    : offset %ld ms, frequency %ld ppb, %lu slews",
+             (long)offset, (long)tm_slew.freq, (unsigned long)servo.slews);
+    TEST_MESSAGE(buffer);
+    // Only the initial offset is stepped. Slewed time advances by at 
+    // most two ticks at a time.
+    TEST_ASSERT_EQUAL(1, servo.steps);
+    TEST_ASSERT_TRUE(sim_max_jump <= 3);
+    TEST_ASSERT_TRUE(offset <= 1 && offset >= -1);
+    TEST_ASSERT_INT_WITHIN(20000, -200000, tm_slew.freq);
+    TEST_ASSERT_EQUAL(TM_SYNC_CLOCK_LOCKED, tm_sync_servo_state(&servo));
+
+    tm_sync_servo_reset(&servo);
+    tm_current = 0;
+}
+
+void test_sync_holdover(void) {
+    char buffer[100];
+    tm_sdelta_t offset;
+
+    sim_reset();
+    sim_run(SIM_DURATION, 1);
+    TEST_ASSERT_EQUAL(TM_SYNC_CLOCK_LOCKED, tm_sync_servo_state(&servo));
+    TEST_ASSERT_INT_WITHIN(10000, -200000, servo.drift);
+
+    // The host goes away. The drift estimate continues to be applied, 
+    // where the free running oscillator would gain 200 ms over 1000 s.
+    sim_run((tm_sdelta_t)TIME_SYNC_HOLDOVER_TIMEOUT * 1000 - SIM_SYNC_INTERVAL, 0);
+    TEST_ASSERT_EQUAL(TM_SYNC_CLOCK_LOCKED, tm_sync_servo_state(&servo));
+    sim_run(2 * SIM_SYNC_INTERVAL, 0);
+    TEST_ASSERT_EQUAL(TM_SYNC_CLOCK_HOLDOVER, tm_sync_servo_state(&servo));
+    TEST_ASSERT_EQUAL(servo.drift, tm_slew.freq);
+    offset = sim_run(1000000L - (tm_sdelta_t)TIME_SYNC_HOLDOVER_TIMEOUT * 1000 - 
+                     SIM_SYNC_INTERVAL, 0);
+    snprintf(buffer, sizeof(buffer), "holdover : offset %ld ms after 1000 s, drift %ld ppb",
+             (long)offset, (long)servo.drift);
+    TEST_MESSAGE(buffer);
+    TEST_ASSERT_TRUE(offset <= 10 && offset >= -10);
+
+    // The host returns. 
+    sim_run(10 * SIM_SYNC_INTERVAL, 1);
+    TEST_ASSERT_EQUAL(TM_SYNC_CLOCK_LOCKED, tm_sync_servo_state(&servo));
+    TEST_ASSERT_EQUAL(0, servo.steps);
+
+    tm_sync_servo_reset(&servo);
+    tm_current = 0;
+}
+
+#endif
+
+#endif
+
+int main( int argc, char **argv) {
+    init();
+    UNITY_BEGIN();
+    #if TIME_ENABLE_SYNC && TIME_SYNC_FILTER_LEN
+    RUN_TEST(test_sync_telemetry);
+    #if TIME_ENABLE_SYNC_BLOCK
+    RUN_TEST(test_sync_block);
+    #endif
+    RUN_TEST(test_sync_filter_select);
+    RUN_TEST(test_sync_filter_consistency);
+    RUN_TEST(test_sync_filter_jitter);
+    #if TIME_ENABLE_SYNC_SERVO
+    RUN_TEST(test_sync_servo);
+    RUN_TEST(test_sync_holdover);
+    #endif
+    #endif
+    UNITY_END();
+}
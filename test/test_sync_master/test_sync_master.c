@@ -0,0 +1,461 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include <time/time.h>
+#include <time/sync.h>
+#include <time/sync_master.h>
+#include <time/systick_handler.h>
+#include <scaffold.h>
+
+/*
+ * Runs the reference sync master against the sync implementation of this
+ * build, over a simulated loopback transport. The transport delays each
+ * transaction in each direction by a latency, an additional asymmetry
+ * towards the device, and a random jitter. The simulated local oscillator
+ * runs with a frequency error. Both clocks are advanced tick by tick as
+ * the transactions take time.
+ *
+ * The device may additionally take time to get to each request after it
+ * arrives, and to get each response out after it is handled. When the
+ * link captures, the transport timestamps of `sync.h` are latched as 
+ * frames arrive and leave. 
+ *
+ * A second link, to a second sync instance, can be run alongside, as 
+ * with a main bus and a debug link to the same device. 
+ *
+ * Each scenario reports the final offset error of the local clock, and
+ * the convergence time, ie, the time after which the error stays within
+ * the bound the asymmetry and jitter allow.
+ */
+
+#if TIME_ENABLE_SYNC_MASTER
+
+#define SIM_OFFSET          100
+#define SIM_INTERVAL        1000
+#define SIM_EXCHANGES       1200
+#define SIM_TOLERANCE       2
+
+typedef struct SIM_LINK_t{
+    tm_sdelta_t latency;
+    tm_sdelta_t asymmetry;
+    tm_sdelta_t jitter;
+    int32_t drift_ppm;
+    tm_sdelta_t rx_handling;
+    tm_sdelta_t tx_handling;
+    uint8_t capture;
+} sim_link_t;
+
+static sim_link_t link;
+static tm_system_t sim_host;
+static uint32_t sim_drift_count;
+static uint32_t seed;
+
+static tm_sync_master_t master;
+
+static uint32_t sim_random(uint32_t range){
+    seed = seed * 1103515245UL + 12345;
+    return (seed >> 16) % range;
+}
+
+static void sim_advance(tm_sdelta_t ms){
+    uint32_t drift_ticks = link.drift_ppm ? 
+                           1000000UL / (uint32_t)abs(link.drift_ppm) : 0;
+    while (ms-- > 0){
+        sim_host ++;
+        if (drift_ticks && ++sim_drift_count >= drift_ticks){
+            sim_drift_count = 0;
+            if (link.drift_ppm > 0){
+                time_systick_handler();
+                time_systick_handler();
+            }
+            continue;
+        }
+        time_systick_handler();
+    }
+}
+
+static void sim_transit(sim_link_t * link_p, uint8_t to_device){
+    tm_sdelta_t delay = link_p->latency;
+    if (to_device){
+        delay += link_p->asymmetry;
+    }
+    if (link_p->jitter){
+        delay += sim_random(link_p->jitter + 1);
+    }
+    sim_advance(delay);
+}
+
+static void sim_receive(sim_link_t * link_p){
+    sim_transit(link_p, 1);
+    if (link_p->capture){
+        tm_sync_capture_rx(0);
+    }
+    sim_advance(link_p->rx_handling);
+}
+
+static void sim_respond(sim_link_t * link_p){
+    sim_advance(link_p->tx_handling);
+    if (link_p->capture){
+        tm_sync_capture_tx(0);
+    }
+    sim_transit(link_p, 0);
+}
+
+static void sim_write(void * ctx, ucdm_addr_t address,
+                      const uint16_t * words, uint8_t count){
+    sim_receive((sim_link_t *)ctx);
+    for (uint8_t i = 0; i < count; i++){
+        ucdm_set_register(address + i, words[i]);
+    }
+    sim_respond((sim_link_t *)ctx);
+}
+
+static void sim_read(void * ctx, ucdm_addr_t address,
+                     uint16_t * words, uint8_t count){
+    sim_receive((sim_link_t *)ctx);
+    for (uint8_t i = 0; i < count; i++){
+        words[i] = ucdm_get_register(address + i);
+    }
+    sim_respond((sim_link_t *)ctx);
+}
+
+static void sim_now(void * ctx, tm_system_t * time_p){
+    (void)ctx;
+    *time_p = sim_host;
+}
+
+static const tm_sync_transport_t transport = {
+    &sim_write, &sim_read, &sim_now, &link
+};
+
+static void reset_instance(tm_sync_sm_t * sm_p){
+    sm_p->state = TM_SYNC_STATE_IDLE;
+    sm_p->t1 = 0;
+    memset(&sm_p->telemetry, 0, sizeof(tm_sync_telemetry_t));
+    #if TIME_SYNC_FILTER_LEN
+    tm_sync_filter_reset(&sm_p->filter);
+    #endif
+    #if TIME_ENABLE_SYNC_BLOCK
+    sm_p->block_state = TM_SYNC_BLOCK_IDLE;
+    #endif
+}
+
+static void reset(void){
+    reset_instance(&tm_sync_sm);
+    tm_sync_clock.selected = NULL;
+    tm_sync_clock.candidate = NULL;
+    #if TIME_ENABLE_SYNC_SERVO
+    tm_sync_servo_reset(&tm_sync_clock.servo);
+    #endif
+    #if TIME_SYNC_ERROR_BUDGET
+    tm_sync_auto_reset(&tm_sync_clock.autosync);
+    #endif
+    ucdm_exception_status &= ~UCDM_EXST_TIMESYNC_REQ;
+    sim_host = 100000;
+    sim_drift_count = 0;
+    seed = 12345;
+    tm_current = sim_host + SIM_OFFSET;
+}
+
+/*
+ * Run a scenario, and check that the local clock converges to the bound
+ * the asymmetry and jitter of the link allow, around the given bias. 
+ * Returns the final error.
+ */
+static tm_sdelta_t sim_run_biased(uint8_t mode, tm_sdelta_t latency, 
+                                  tm_sdelta_t asymmetry, tm_sdelta_t jitter, 
+                                  int32_t drift_ppm, tm_sdelta_t bias){
+    char buffer[120];
+    tm_sync_telemetry_t telemetry;
+    tm_system_t start, next, converged;
+    tm_sdelta_t error = 0;
+    tm_sdelta_t bound = (asymmetry + jitter) / 2 + SIM_TOLERANCE;
+
+    link.latency = latency;
+    link.asymmetry = asymmetry;
+    link.jitter = jitter;
+    link.drift_ppm = drift_ppm;
+    reset();
+    tm_sync_master_init(&master, &transport, 
+                        ucdm_addr_sync_telemetry - TM_SYNC_UCDM_TELEMETRY, mode);
+
+    start = sim_host;
+    converged = sim_host;
+    for (uint16_t i = 0; i < SIM_EXCHANGES; i++){
+        next = sim_host + SIM_INTERVAL;
+        tm_sync_master_exchange(&master);
+        sim_advance(next - sim_host);
+        error = tm_current - sim_host;
+        if (error - bias > bound || error - bias < -bound){
+            converged = sim_host;
+        }
+    }
+    tm_sync_master_telemetry(&master, &telemetry);
+
+    snprintf(buffer, sizeof(buffer),
+             "mode %u, %2ld+%ld~%ld ms, %4ld ppm : error %3ld ms, converged in %4ld s, %lu transactions",
+             mode, (long)latency, (long)asymmetry, (long)jitter, (long)drift_ppm,
+             (long)error, (long)((converged - start) / 1000),
+             (unsigned long)(master.transactions / master.exchanges));
+    TEST_MESSAGE(buffer);
+
+    TEST_ASSERT_TRUE(error - bias <= bound && error - bias >= -bound);
+    TEST_ASSERT_TRUE(converged - start < (tm_sdelta_t)SIM_EXCHANGES * SIM_INTERVAL / 2);
+    TEST_ASSERT_TRUE(telemetry.samples > 0);
+    TEST_ASSERT_EQUAL(TM_SYNC_STATE_IDLE, tm_sync_sm.state);
+    return error;
+}
+
+static void sim_run(uint8_t mode, tm_sdelta_t latency, tm_sdelta_t asymmetry,
+                    tm_sdelta_t jitter, int32_t drift_ppm){
+    sim_run_biased(mode, latency, asymmetry, jitter, drift_ppm, 0);
+}
+
+void test_sync_master_one_step(void) {
+    sim_run(TM_SYNC_MASTER_ONE_STEP, 2, 0, 0, 0);
+    sim_run(TM_SYNC_MASTER_ONE_STEP, 2, 0, 0, 100);
+    sim_run(TM_SYNC_MASTER_ONE_STEP, 5, 2, 4, -150);
+}
+
+void test_sync_master_two_step(void) {
+    sim_run(TM_SYNC_MASTER_TWO_STEP, 2, 0, 0, 100);
+    sim_run(TM_SYNC_MASTER_TWO_STEP, 5, 2, 4, -150);
+}
+
+#if TIME_ENABLE_SYNC_BLOCK
+void test_sync_master_block(void) {
+    sim_run(TM_SYNC_MASTER_BLOCK, 2, 0, 0, 100);
+    sim_run(TM_SYNC_MASTER_BLOCK, 5, 2, 4, -150);
+}
+#endif
+
+/*
+ * Time spent by the device getting to a request is seen as path delay 
+ * towards the device, and time spent getting the response out as path 
+ * delay away from it. Either biases the offset by half of it, unless 
+ * the transport captures timestamps.
+ */
+void test_sync_master_capture(void) {
+    uint8_t modes[] = {TM_SYNC_MASTER_ONE_STEP, TM_SYNC_MASTER_TWO_STEP, 
+                       #if TIME_ENABLE_SYNC_BLOCK
+                       TM_SYNC_MASTER_BLOCK, 
+                       #endif
+                       };
+    for (uint8_t i = 0; i < sizeof(modes); i++){
+        link.rx_handling = 8;
+        link.tx_handling = 0;
+        link.capture = 0;
+        sim_run_biased(modes[i], 2, 0, 0, 100, -4);
+        link.capture = 1;
+        sim_run(modes[i], 2, 0, 0, 100);
+        
+        link.rx_handling = 0;
+        link.tx_handling = 8;
+        link.capture = 0;
+        sim_run_biased(modes[i], 2, 0, 0, 100, 4);
+        link.capture = 1;
+        sim_run(modes[i], 2, 0, 0, 100);
+    }
+    link.tx_handling = 0;
+    link.capture = 0;
+}
+
+static tm_sync_sm_t debug_sm;
+static sim_link_t debug_link;
+static tm_sync_master_t debug_master;
+
+static const tm_sync_transport_t debug_transport = {
+    &sim_write, &sim_read, &sim_now, &debug_link
+};
+
+/*
+ * Sync through a good main link and a poor debug link at once. The main 
+ * link is selected, and the debug link only collects statistics, until 
+ * the main link goes quiet for longer than the holdover timeout.
+ */
+void test_sync_master_instances(void) {
+    char buffer[120];
+    tm_system_t next;
+    tm_sdelta_t error = 0;
+    uint32_t switches;
+
+    link.latency = 2;
+    link.asymmetry = 0;
+    link.jitter = 0;
+    link.drift_ppm = 100;
+    debug_link.latency = 10;
+    debug_link.asymmetry = 12;
+    debug_link.jitter = 6;
+    reset();
+    reset_instance(&debug_sm);
+    tm_sync_master_init(&master, &transport, tm_sync_sm.address, 
+                        TM_SYNC_MASTER_ONE_STEP);
+    tm_sync_master_init(&debug_master, &debug_transport, debug_sm.address, 
+                        TM_SYNC_MASTER_ONE_STEP);
+
+    for (uint16_t i = 0; i < SIM_EXCHANGES / 2; i++){
+        next = sim_host + SIM_INTERVAL;
+        tm_sync_master_exchange(&master);
+        tm_sync_master_exchange(&debug_master);
+        sim_advance(next - sim_host);
+    }
+    error = tm_current - sim_host;
+    snprintf(buffer, sizeof(buffer),
+             "main and debug : error %ld ms, delay %ld and %ld ms, jitter %lu and %lu ms",
+             (long)error, (long)tm_sync_sm.telemetry.delay, 
+             (long)debug_sm.telemetry.delay, 
+             (unsigned long)tm_sync_sm.telemetry.jitter, 
+             (unsigned long)debug_sm.telemetry.jitter);
+    TEST_MESSAGE(buffer);
+    TEST_ASSERT_EQUAL_PTR(&tm_sync_sm, tm_sync_selected());
+    TEST_ASSERT_TRUE(error <= SIM_TOLERANCE && error >= -SIM_TOLERANCE);
+    TEST_ASSERT_EQUAL(SIM_EXCHANGES / 2, debug_sm.telemetry.samples);
+    TEST_ASSERT_EQUAL(TM_SYNC_STATE_IDLE, debug_sm.state);
+
+    // The debug link takes over once the main link has been lost.
+    switches = tm_sync_clock.switches;
+    for (uint16_t i = 0; i < SIM_EXCHANGES / 2; i++){
+        next = sim_host + SIM_INTERVAL;
+        tm_sync_master_exchange(&debug_master);
+        sim_advance(next - sim_host);
+    }
+    error = tm_current - sim_host;
+    snprintf(buffer, sizeof(buffer), "debug only : error %ld ms", (long)error);
+    TEST_MESSAGE(buffer);
+    TEST_ASSERT_EQUAL_PTR(&debug_sm, tm_sync_selected());
+    TEST_ASSERT_EQUAL(switches + 1, tm_sync_clock.switches);
+    TEST_ASSERT_TRUE(error <= (debug_link.asymmetry + debug_link.jitter) / 2 + SIM_TOLERANCE && 
+                     error >= -((debug_link.asymmetry + debug_link.jitter) / 2 + SIM_TOLERANCE));
+
+    // And hands back when the main link returns.
+    for (uint16_t i = 0; i < 60; i++){
+        next = sim_host + SIM_INTERVAL;
+        tm_sync_master_exchange(&master);
+        tm_sync_master_exchange(&debug_master);
+        sim_advance(next - sim_host);
+    }
+    TEST_ASSERT_EQUAL_PTR(&tm_sync_sm, tm_sync_selected());
+    TEST_ASSERT_EQUAL(switches + 2, tm_sync_clock.switches);
+}
+
+void test_sync_master_hysteresis(void) {
+    char buffer[80];
+    tm_system_t next;
+    uint32_t switches;
+
+    // Two links of about the same quality.
+    link.latency = 2;
+    link.asymmetry = 0;
+    link.jitter = 2;
+    link.drift_ppm = 100;
+    debug_link.latency = 2;
+    debug_link.asymmetry = 0;
+    debug_link.jitter = 2;
+    reset();
+    reset_instance(&debug_sm);
+    tm_sync_master_init(&master, &transport, tm_sync_sm.address, 
+                        TM_SYNC_MASTER_ONE_STEP);
+    tm_sync_master_init(&debug_master, &debug_transport, debug_sm.address, 
+                        TM_SYNC_MASTER_ONE_STEP);
+
+    switches = tm_sync_clock.switches;
+    for (uint16_t i = 0; i < SIM_EXCHANGES / 2; i++){
+        next = sim_host + SIM_INTERVAL;
+        tm_sync_master_exchange(&master);
+        tm_sync_master_exchange(&debug_master);
+        sim_advance(next - sim_host);
+    }
+    snprintf(buffer, sizeof(buffer), "similar links : %lu switches",
+             (unsigned long)(tm_sync_clock.switches - switches));
+    TEST_MESSAGE(buffer);
+    TEST_ASSERT_EQUAL_PTR(&tm_sync_sm, tm_sync_selected());
+    TEST_ASSERT_EQUAL(switches, tm_sync_clock.switches);
+}
+
+#if TIME_SYNC_ERROR_BUDGET
+
+#define SIM_AUTO_SPAN       (6UL * 3600)
+#define SIM_AUTO_SETTLE     (1UL * 3600)
+
+/*
+ * Let the device decide when to sync. The master only runs an exchange 
+ * when the sync request is raised, and the error of the local clock is 
+ * checked every second once the servo has settled. 
+ */
+static uint32_t sim_run_auto(tm_sdelta_t jitter, int32_t drift_ppm){
+    char buffer[120];
+    tm_sdelta_t error, worst = 0;
+    uint32_t exchanges = 0;
+
+    link.latency = 2;
+    link.asymmetry = 0;
+    link.jitter = jitter;
+    link.drift_ppm = drift_ppm;
+    reset();
+    tm_sync_master_init(&master, &transport, 
+                        ucdm_addr_sync_telemetry - TM_SYNC_UCDM_TELEMETRY, 
+                        TM_SYNC_MASTER_ONE_STEP);
+
+    for (uint32_t s = 0; s < SIM_AUTO_SPAN; s++){
+        tm_sync_auto_poll();
+        if (ucdm_exception_status & UCDM_EXST_TIMESYNC_REQ){
+            tm_sync_master_exchange(&master);
+            exchanges ++;
+        }
+        sim_advance(SIM_INTERVAL - (sim_host % SIM_INTERVAL));
+        error = tm_current - sim_host;
+        if (error < 0){
+            error = -error;
+        }
+        if (s > SIM_AUTO_SETTLE && error > worst){
+            worst = error;
+        }
+    }
+
+    snprintf(buffer, sizeof(buffer),
+             "jitter %ld ms, %4ld ppm : %lu exchanges in %lu s, interval %lu s, worst error %ld ms",
+             (long)jitter, (long)drift_ppm, (unsigned long)exchanges, 
+             (unsigned long)SIM_AUTO_SPAN, 
+             (unsigned long)tm_sync_auto_interval(), (long)worst);
+    TEST_MESSAGE(buffer);
+
+    TEST_ASSERT_TRUE(worst <= TIME_SYNC_ERROR_BUDGET);
+    TEST_ASSERT_EQUAL(exchanges, tm_sync_clock.autosync.requests);
+    return exchanges;
+}
+
+void test_sync_master_auto(void) {
+    uint32_t exchanges;
+    // A steady clock backs off well below one exchange per minimum 
+    // interval. 
+    exchanges = sim_run_auto(0, 100);
+    TEST_ASSERT_TRUE(exchanges < SIM_AUTO_SPAN / TIME_SYNC_INTERVAL_MIN / 10);
+    TEST_ASSERT_TRUE(tm_sync_auto_interval() > 16 * TIME_SYNC_INTERVAL_MIN);
+    // A noisy link needs more exchanges, but stays within the budget.
+    sim_run_auto(2, -150);
+}
+
+#endif
+
+#endif
+
+int main( int argc, char **argv) {
+    init();
+    UNITY_BEGIN();
+    #if TIME_ENABLE_SYNC_MASTER
+    RUN_TEST(test_sync_master_one_step);
+    RUN_TEST(test_sync_master_two_step);
+    #if TIME_ENABLE_SYNC_BLOCK
+    RUN_TEST(test_sync_master_block);
+    #endif
+    RUN_TEST(test_sync_master_capture);
+    tm_sync_instance_init(&debug_sm, tm_sync_sm.end);
+    RUN_TEST(test_sync_master_instances);
+    RUN_TEST(test_sync_master_hysteresis);
+    #if TIME_SYNC_ERROR_BUDGET
+    RUN_TEST(test_sync_master_auto);
+    #endif
+    #endif
+    UNITY_END();
+}
@@ -29,6 +29,42 @@ void test_systick_basic(void) {
 }
 #endif
 
+#if TIME_ENABLE_SLEW && (defined __linux__ || defined _WIN32)
+void test_systick_slew(void) {
+    tm_sdelta_t sdelta = 3;
+    tm_system_t last;
+
+    tm_current = 0;
+    tm_slew_time(&sdelta);
+    for (int32_t i=0; i<4*TM_SLEW_INTERVAL; i++){
+        time_systick_handler();
+    }
+    TEST_ASSERT_EQUAL(4*TM_SLEW_INTERVAL + 3, tm_current);
+    TEST_ASSERT_EQUAL(0, tm_slew.phase);
+
+    // Dropped ticks hold time, and never take it backwards.
+    sdelta = -3;
+    tm_slew_time(&sdelta);
+    tm_slew_frequency(-TM_SLEW_FREQ_MAX);
+    last = tm_current;
+    for (int32_t i=0; i<4*TM_SLEW_INTERVAL; i++){
+        time_systick_handler();
+        TEST_ASSERT_TRUE(tm_current >= last);
+        last = tm_current;
+    }
+    TEST_ASSERT_EQUAL(0, tm_slew.phase);
+
+    tm_current = 0;
+    tm_slew_frequency(100000);
+    for (int32_t i=0; i<100000; i++){
+        time_systick_handler();
+    }
+    TEST_ASSERT_EQUAL(100010, tm_current);
+    tm_slew_frequency(0);
+    tm_current = 0;
+}
+#endif
+
 void test_systick_read(void) {
     tm_system_t ts1, ts2;
     
@@ -52,5 +88,8 @@ int main( int argc, char **argv) {
     UNITY_BEGIN();
     RUN_TEST(test_systick_read);
     RUN_TEST(test_systick_basic);
+    #if TIME_ENABLE_SLEW && (defined __linux__ || defined _WIN32)
+    RUN_TEST(test_systick_slew);
+    #endif
     UNITY_END();
 }